@@ -0,0 +1,103 @@
+/**
+ Micro benchmark comparing the locked and the lock-free DispatchQueue modes.
+
+ Build and run from the repository root:
+
+   g++ -std=c++17 -O2 -pthread -Icpp/dispatch -Icpp/base \
+     benchmarks/WKTDispatchQueueBenchmark.cpp cpp/dispatch/WKTDispatchQueue.cpp \
+     cpp/dispatch/WKTDispatchThread.cpp \
+     -o /tmp/dispatch_queue_benchmark && /tmp/dispatch_queue_benchmark
+
+ Each run posts a number of tiny tasks from one or more producer threads and
+ measures the time until the queue's thread has run all of them.
+ */
+#include "WKTDispatchQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace RNWorklet;
+
+static double run(DispatchQueueMode mode, int producers, int tasksPerProducer) {
+  auto queue = std::make_unique<DispatchQueue>("benchmark", mode);
+  std::atomic<int> remaining{producers * tasksPerProducer};
+  std::mutex mu;
+  std::condition_variable cond;
+  bool done = false;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < tasksPerProducer; i++) {
+        queue->dispatch([&]() {
+          if (--remaining == 0) {
+            std::lock_guard<std::mutex> lock(mu);
+            done = true;
+            cond.notify_one();
+          }
+        });
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::unique_lock<std::mutex> lock(mu);
+  cond.wait(lock, [&]() { return done; });
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Posts one task at a time and waits for it, like a setImmediate chain
+static double runPingPong(DispatchQueueMode mode, int tasks) {
+  auto queue = std::make_unique<DispatchQueue>("benchmark", mode);
+  std::atomic<int> remaining{tasks};
+  std::mutex mu;
+  std::condition_variable cond;
+  bool done = false;
+
+  std::function<void()> next = [&]() {
+    if (--remaining == 0) {
+      std::lock_guard<std::mutex> lock(mu);
+      done = true;
+      cond.notify_one();
+    } else {
+      queue->dispatch(next);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  queue->dispatch(next);
+  std::unique_lock<std::mutex> lock(mu);
+  cond.wait(lock, [&]() { return done; });
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main() {
+  const int tasks = 200000;
+  const int producerCounts[] = {1, 2, 4, 8};
+
+  std::printf("%-24s %12s %12s\n", "scenario", "locked ms", "lock-free ms");
+  for (auto producers : producerCounts) {
+    auto locked = run(DispatchQueueMode::Locked, producers, tasks / producers);
+    auto lockFree =
+        run(DispatchQueueMode::LockFree, producers, tasks / producers);
+    std::printf("%d producer(s) %10s %12.2f %12.2f\n", producers, "", locked,
+                lockFree);
+  }
+
+  auto locked = runPingPong(DispatchQueueMode::Locked, tasks);
+  auto lockFree = runPingPong(DispatchQueueMode::LockFree, tasks);
+  std::printf("%-24s %12.2f %12.2f\n", "chained", locked, lockFree);
+  return 0;
+}
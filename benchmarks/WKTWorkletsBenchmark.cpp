@@ -0,0 +1,486 @@
+/**
+ Benchmarks for wrapping values, passing arguments, dispatching work and
+ calling worklets between contexts, run against a headless JS runtime created
+ with makeJSIRuntime.
+
+ Build and run from the repository root against a Hermes build (HERMES_SRC is
+ the Hermes checkout, HERMES_BUILD its cmake build directory):
+
+   g++ -std=c++17 -O2 -pthread -DJS_RUNTIME_HERMES=1 \
+     -I$HERMES_SRC/API -I$HERMES_SRC/API/jsi -I$HERMES_SRC/public \
+     $(find cpp -type d | sed 's/^/-I/') \
+     benchmarks/WKTWorkletsBenchmark.cpp $(find cpp -name '*.cpp') \
+     $HERMES_SRC/API/jsi/jsi/jsi.cpp \
+     -L$HERMES_BUILD/API/hermes -lhermes -o /tmp/worklets_benchmark
+   /tmp/worklets_benchmark results.json
+
+ Leave out -DJS_RUNTIME_HERMES=1 and link JavaScriptCore with the React
+ Native JSCRuntime instead to benchmark JSC.
+
+ Results are written as JSON to the file given as the first argument, or to
+ stdout. Each result has the number of measured iterations and the mean time
+ per iteration in microseconds, latency results also have percentiles.
+ */
+#include "WKTArgumentsWrapper.h"
+#include "WKTDispatchQueue.h"
+#include "WKTJsRuntimeFactory.h"
+#include "WKTJsiWorklet.h"
+#include "WKTJsiWorkletContext.h"
+#include "WKTJsiWrapper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace RNWorklet;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedUs(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+struct Result {
+  std::string name;
+  size_t iterations;
+  double meanUs;
+  // Only set for latency samples
+  bool hasPercentiles;
+  double p50Us;
+  double p99Us;
+};
+
+static std::mutex resultsMutex;
+static std::vector<Result> results;
+
+static void addResult(const std::string &name, size_t iterations,
+                      double totalUs) {
+  std::lock_guard<std::mutex> lock(resultsMutex);
+  results.push_back({name, iterations, totalUs / iterations, false, 0, 0});
+}
+
+static void addSamples(const std::string &name, std::vector<double> samples) {
+  std::sort(samples.begin(), samples.end());
+  double total = 0;
+  for (auto sample : samples) {
+    total += sample;
+  }
+  std::lock_guard<std::mutex> lock(resultsMutex);
+  results.push_back({name, samples.size(), total / samples.size(), true,
+                     samples[samples.size() / 2],
+                     samples[samples.size() * 99 / 100]});
+}
+
+// Runs the function a tenth of the iterations to warm up, then measures it
+template <typename Fn>
+static void measure(const std::string &name, size_t iterations, Fn &&fn) {
+  for (size_t i = 0; i < iterations / 10; i++) {
+    fn();
+  }
+  auto start = Clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    fn();
+  }
+  addResult(name, iterations, elapsedUs(start));
+}
+
+/**
+ Stands in for the React JS thread: the main thread runs the functions posted
+ to the JS call invoker while waiting for a benchmark to finish.
+ */
+class JsThread {
+public:
+  void invoke(std::function<void()> &&fp) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _tasks.push_back(std::move(fp));
+    }
+    _cond.notify_one();
+  }
+
+  /**
+   Runs posted functions until done is set. Set done from a posted function
+   so that the wait wakes up.
+   */
+  void runUntil(const bool &done) {
+    while (!done) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [this]() { return !_tasks.empty(); });
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  /**
+   Runs the functions posted so far
+   */
+  void drain() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_tasks.empty()) {
+          return;
+        }
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  std::deque<std::function<void()>> _tasks;
+};
+
+static jsi::Function evaluateFunction(jsi::Runtime &runtime,
+                                      const std::string &code) {
+  return runtime
+      .evaluateJavaScript(
+          std::make_shared<const jsi::StringBuffer>("(" + code + "\n)"),
+          "benchmark")
+      .asObject(runtime)
+      .asFunction(runtime);
+}
+
+/**
+ Creates a function decorated like the worklets babel plugin does
+ */
+static jsi::Value makeWorklet(jsi::Runtime &runtime, const std::string &code,
+                              const std::string &hash) {
+  auto func = evaluateFunction(runtime, code);
+  auto initData = jsi::Object(runtime);
+  initData.setProperty(runtime, PropNameWorkletInitDataCode,
+                       jsi::String::createFromUtf8(runtime, code));
+  initData.setProperty(runtime, PropNameWorkletInitDataLocation,
+                       jsi::String::createFromUtf8(runtime, "benchmark"));
+  func.setProperty(runtime, PropNameWorkletHash,
+                   jsi::String::createFromUtf8(runtime, hash));
+  func.setProperty(runtime, PropNameWorkletInitData, initData);
+  func.setProperty(runtime, PropNameWorkletClosure, jsi::Object(runtime));
+  return jsi::Value(runtime, func);
+}
+
+static void benchmarkWrapping(jsi::Runtime &runtime) {
+  auto makeNumbers = evaluateFunction(
+      runtime, "function (n) { var a = []; for (var i = 0; i < n; i++) "
+               "{ a.push(i * 0.5); } return a; }");
+  auto makeObjects = evaluateFunction(
+      runtime, "function (n) { var a = []; for (var i = 0; i < n; i++) "
+               "{ a.push({ x: i, y: i * 2, label: 'marker' + i, tags: "
+               "[i, i + 1] }); } return a; }");
+  auto makeObject = evaluateFunction(
+      runtime, "function (n) { var o = {}; for (var i = 0; i < n; i++) "
+               "{ o['key' + i] = { value: i, nested: { flag: i % 2 === 0 } "
+               "}; } return o; }");
+
+  measure("wrap.number", 100000,
+          [&]() { JsiWrapper::wrap(runtime, jsi::Value(42.0)); });
+  auto text = jsi::Value(runtime, jsi::String::createFromUtf8(
+                                      runtime, "a short string value"));
+  measure("wrap.string", 100000, [&]() { JsiWrapper::wrap(runtime, text); });
+  auto numberWrapper = JsiWrapper::wrap(runtime, jsi::Value(42.0));
+  measure("unwrap.number", 100000,
+          [&]() { JsiWrapper::unwrap(runtime, numberWrapper); });
+
+  const size_t sizes[] = {10, 100, 1000};
+  for (auto size : sizes) {
+    auto iterations = std::max<size_t>(100000 / size, 20);
+    auto suffix = "." + std::to_string(size);
+    std::pair<std::string, jsi::Value> values[] = {
+        {"numberArray", makeNumbers.call(runtime, static_cast<double>(size))},
+        {"objectArray", makeObjects.call(runtime, static_cast<double>(size))},
+        {"nestedObject", makeObject.call(runtime, static_cast<double>(size))}};
+    for (auto &value : values) {
+      measure("wrap." + value.first + suffix, iterations,
+              [&]() { JsiWrapper::wrap(runtime, value.second); });
+      auto wrapper = JsiWrapper::wrap(runtime, value.second);
+      measure("unwrap." + value.first + suffix, iterations,
+              [&]() { JsiWrapper::unwrap(runtime, wrapper); });
+    }
+  }
+}
+
+static void benchmarkArguments(jsi::Runtime &runtime) {
+  auto makeArguments = evaluateFunction(
+      runtime, "function () { var a = []; for (var i = 0; i < 100; i++) "
+               "{ a.push(i); } return [42, 'text', { x: 1, y: 2, nested: "
+               "{ z: 3 } }, a]; }");
+  auto array = makeArguments.call(runtime).asObject(runtime).asArray(runtime);
+  std::vector<jsi::Value> arguments;
+  for (size_t i = 0; i < array.size(runtime); i++) {
+    arguments.push_back(array.getValueAtIndex(runtime, i));
+  }
+
+  std::pair<std::string, TransferMode> modes[] = {
+      {"wrap", TransferMode::Wrap}, {"serialize", TransferMode::Serialize}};
+  for (auto &mode : modes) {
+    measure("arguments.create." + mode.first, 10000, [&]() {
+      ArgumentsWrapper(runtime, arguments.data(), arguments.size(),
+                       mode.second);
+    });
+    ArgumentsWrapper wrapper(runtime, arguments.data(), arguments.size(),
+                             mode.second);
+    measure("arguments.get." + mode.first, 10000,
+            [&]() { wrapper.getArguments(runtime); });
+  }
+}
+
+// Time from dispatch until the task starts running on the queue's thread
+static std::vector<double> dispatchLatencies(DispatchQueue &queue,
+                                             size_t count,
+                                             std::chrono::microseconds idle) {
+  std::vector<double> samples;
+  samples.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    if (idle.count() > 0) {
+      std::this_thread::sleep_for(idle);
+    }
+    std::atomic<bool> ran = {false};
+    auto start = Clock::now();
+    queue.dispatch([&]() {
+      samples.push_back(elapsedUs(start));
+      ran.store(true, std::memory_order_release);
+    });
+    while (!ran.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+  return samples;
+}
+
+static void benchmarkDispatchQueue() {
+  std::pair<std::string, DispatchQueueMode> modes[] = {
+      {"locked", DispatchQueueMode::Locked},
+      {"lockFree", DispatchQueueMode::LockFree}};
+  for (auto &mode : modes) {
+    DispatchQueue queue("benchmark", mode.second);
+    // Back to back tasks find the thread awake, tasks after a pause find it
+    // parked
+    addSamples("dispatchQueue.latency.busy." + mode.first,
+               dispatchLatencies(queue, 10000, std::chrono::microseconds(0)));
+    addSamples(
+        "dispatchQueue.latency.idle." + mode.first,
+        dispatchLatencies(queue, 200, std::chrono::microseconds(2000)));
+  }
+}
+
+/**
+ Calls the function n times after warming up, each call waiting for the
+ previous one. Calls returning a settled promise continue in a loop instead
+ of recursing.
+ */
+static const char *CallDriverCode =
+    "function (call, warmup, n, begin, done) {"
+    "  var i = 0;"
+    "  function next() {"
+    "    while (i < warmup + n) {"
+    "      if (i === warmup) { begin(); }"
+    "      i++;"
+    "      var settled = false;"
+    "      var sync = true;"
+    "      var result = call(i);"
+    "      if (result && typeof result.then === 'function') {"
+    "        result.then(function () { settled = true; if (!sync) next(); });"
+    "        sync = false;"
+    "        if (!settled) { return; }"
+    "      }"
+    "    }"
+    "    done();"
+    "  }"
+    "  next();"
+    "}";
+
+/**
+ Measures round trips of a function created with createCallInContext
+ @param caller Context making the calls, or nullptr for the JS thread
+ @param target Context the calls run in, or nullptr for the JS thread
+ */
+static void benchmarkCall(JsThread &jsThread, jsi::Runtime &jsRuntime,
+                          const std::string &name,
+                          std::shared_ptr<JsiWorkletContext> caller,
+                          std::shared_ptr<JsiWorkletContext> target) {
+  const size_t warmup = 100;
+  const size_t count = 2000;
+  bool done = false;
+  Clock::time_point start;
+
+  auto run = [&](jsi::Runtime &runtime) {
+    auto worklet =
+        makeWorklet(runtime, "function (x) { return x + 1; }", "callTarget");
+    auto call = jsi::Function::createFromHostFunction(
+        runtime, jsi::PropNameID::forAscii(runtime, "call"), 1,
+        JsiWorkletContext::createCallInContext(runtime, worklet,
+                                               target.get()));
+    auto begin = jsi::Function::createFromHostFunction(
+        runtime, jsi::PropNameID::forAscii(runtime, "begin"), 0,
+        [&](jsi::Runtime &, const jsi::Value &, const jsi::Value *, size_t) {
+          start = Clock::now();
+          return jsi::Value::undefined();
+        });
+    auto finish = jsi::Function::createFromHostFunction(
+        runtime, jsi::PropNameID::forAscii(runtime, "done"), 0,
+        [&](jsi::Runtime &, const jsi::Value &, const jsi::Value *, size_t) {
+          addResult(name, count, elapsedUs(start));
+          jsThread.invoke([&]() { done = true; });
+          return jsi::Value::undefined();
+        });
+    evaluateFunction(runtime, CallDriverCode)
+        .call(runtime, call, static_cast<double>(warmup),
+              static_cast<double>(count), begin, finish);
+  };
+
+  if (caller == nullptr) {
+    run(jsRuntime);
+  } else {
+    caller->invokeOnWorkletThread(
+        [&](JsiWorkletContext *, jsi::Runtime &runtime) { run(runtime); });
+  }
+  jsThread.runUntil(done);
+}
+
+static void benchmarkCallingConventions(JsThread &jsThread,
+                                        jsi::Runtime &jsRuntime,
+                                        std::shared_ptr<JsiWorkletContext> a,
+                                        std::shared_ptr<JsiWorkletContext> b) {
+  benchmarkCall(jsThread, jsRuntime, "call.JsToJs", nullptr, nullptr);
+  benchmarkCall(jsThread, jsRuntime, "call.JsToCtx", nullptr, b);
+  benchmarkCall(jsThread, jsRuntime, "call.CtxToJs", a, nullptr);
+  benchmarkCall(jsThread, jsRuntime, "call.WithinCtx", a, a);
+  benchmarkCall(jsThread, jsRuntime, "call.CtxToCtx", a, b);
+}
+
+/**
+ Compares the first call of worklet invokers in a context, with and without
+ the worklet's code already evaluated there, with calls to a warm invoker
+ */
+static void benchmarkWorkletInvoker(JsThread &jsThread,
+                                    jsi::Runtime &jsRuntime,
+                                    std::shared_ptr<JsiWorkletContext> ctx) {
+  const size_t count = 200;
+  const size_t warmCount = 10000;
+  std::vector<std::shared_ptr<WorkletInvoker>> uncached;
+  std::vector<std::shared_ptr<WorkletInvoker>> cached;
+  for (size_t i = 0; i < count; i++) {
+    auto index = std::to_string(i);
+    uncached.push_back(std::make_shared<WorkletInvoker>(
+        jsRuntime,
+        makeWorklet(jsRuntime, "function (x) { return x + " + index + "; }",
+                    "invokerUncached" + index)));
+    cached.push_back(std::make_shared<WorkletInvoker>(
+        jsRuntime, makeWorklet(jsRuntime, "function (x) { return x * 2; }",
+                               "invokerCached")));
+  }
+
+  bool done = false;
+  ctx->invokeOnWorkletThread([&](JsiWorkletContext *, jsi::Runtime &runtime) {
+    jsi::Value argument(1.0);
+    auto thisValue = jsi::Value::undefined();
+
+    auto start = Clock::now();
+    for (auto &invoker : uncached) {
+      invoker->call(runtime, thisValue, &argument, 1);
+    }
+    addResult("invoker.firstCall.uncachedCode", count, elapsedUs(start));
+
+    // The first invoker evaluates the shared code, the others find it cached
+    cached[0]->call(runtime, thisValue, &argument, 1);
+    start = Clock::now();
+    for (size_t i = 1; i < count; i++) {
+      cached[i]->call(runtime, thisValue, &argument, 1);
+    }
+    addResult("invoker.firstCall.cachedCode", count - 1, elapsedUs(start));
+
+    start = Clock::now();
+    for (size_t i = 0; i < warmCount; i++) {
+      cached[0]->call(runtime, thisValue, &argument, 1);
+    }
+    addResult("invoker.warmCall", warmCount, elapsedUs(start));
+    jsThread.invoke([&]() { done = true; });
+  });
+  jsThread.runUntil(done);
+}
+
+static std::string formatNumber(double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+  return buffer;
+}
+
+static std::string resultsToJson() {
+#if JS_RUNTIME_HERMES
+  std::string runtimeName = "hermes";
+#else
+  std::string runtimeName = "jsc";
+#endif
+  std::string json = "{\n  \"runtime\": \"" + runtimeName +
+                     "\",\n  \"timestamp\": " +
+                     std::to_string(static_cast<long long>(std::time(nullptr))) +
+                     ",\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    auto &result = results[i];
+    json += std::string(i > 0 ? "," : "") + "\n    {\"name\": \"" +
+            result.name +
+            "\", \"iterations\": " + std::to_string(result.iterations) +
+            ", \"meanUs\": " + formatNumber(result.meanUs);
+    if (result.hasPercentiles) {
+      json += ", \"p50Us\": " + formatNumber(result.p50Us) +
+              ", \"p99Us\": " + formatNumber(result.p99Us);
+    }
+    json += "}";
+  }
+  return json + "\n  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+  JsThread jsThread;
+  auto jsRuntime = makeJSIRuntime();
+  JsiWorkletContext::getDefaultInstance()->initialize(
+      "default", jsRuntime.get(),
+      [&](std::function<void()> &&fp) { jsThread.invoke(std::move(fp)); });
+
+  benchmarkWrapping(*jsRuntime);
+  benchmarkArguments(*jsRuntime);
+  benchmarkDispatchQueue();
+  {
+    auto a = std::make_shared<JsiWorkletContext>("benchmarkA");
+    auto b = std::make_shared<JsiWorkletContext>("benchmarkB");
+    benchmarkCallingConventions(jsThread, *jsRuntime, a, b);
+    benchmarkWorkletInvoker(jsThread, *jsRuntime, a);
+    jsThread.drain();
+  }
+  jsThread.drain();
+  JsiWorkletContext::invalidateDefaultInstance();
+
+  auto json = resultsToJson();
+  if (argc > 1) {
+    auto file = std::fopen(argv[1], "w");
+    if (file == nullptr) {
+      std::fprintf(stderr, "Could not open %s\n", argv[1]);
+      return 1;
+    }
+    std::fputs(json.c_str(), file);
+    std::fclose(file);
+  } else {
+    std::fputs(json.c_str(), stdout);
+  }
+  return 0;
+}
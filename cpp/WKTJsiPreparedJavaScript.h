@@ -0,0 +1,168 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if JS_RUNTIME_HERMES
+#include <hermes/hermes.h>
+#endif
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Buffer holding bytes decoded from a base64 string
+ */
+class JsiByteBuffer : public jsi::Buffer {
+public:
+  explicit JsiByteBuffer(std::vector<uint8_t> bytes)
+      : _bytes(std::move(bytes)) {}
+
+  size_t size() const override { return _bytes.size(); }
+  const uint8_t *data() const override { return _bytes.data(); }
+
+  /**
+   Decodes a base64 string. Returns an empty buffer if the string is not
+   valid base64.
+   */
+  static std::shared_ptr<JsiByteBuffer> fromBase64(const std::string &base64) {
+    std::vector<uint8_t> bytes;
+    bytes.reserve(base64.size() / 4 * 3);
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (char c : base64) {
+      int value;
+      if (c >= 'A' && c <= 'Z') {
+        value = c - 'A';
+      } else if (c >= 'a' && c <= 'z') {
+        value = c - 'a' + 26;
+      } else if (c >= '0' && c <= '9') {
+        value = c - '0' + 52;
+      } else if (c == '+') {
+        value = 62;
+      } else if (c == '/') {
+        value = 63;
+      } else if (c == '=') {
+        break;
+      } else {
+        return std::make_shared<JsiByteBuffer>(std::vector<uint8_t>());
+      }
+      accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+      bits += 6;
+      if (bits >= 8) {
+        bits -= 8;
+        bytes.push_back(static_cast<uint8_t>((accumulator >> bits) & 0xFF));
+      }
+    }
+    return std::make_shared<JsiByteBuffer>(std::move(bytes));
+  }
+
+private:
+  std::vector<uint8_t> _bytes;
+};
+
+/**
+ Process wide cache of prepared worklet code. All worklet runtimes are created
+ by makeJSIRuntime and use the same engine, so a worklet is parsed (or its
+ bytecode loaded) once and the prepared code is evaluated in every worklet
+ runtime that needs it. Worklets are part of the app's code, so the cache is
+ not bounded.
+ */
+class JsiPreparedJavaScriptCache {
+public:
+  /**
+   Returns the prepared code for the worklet with the given hash, preparing it
+   in the runtime if needed.
+   @param runtime Worklet runtime to prepare the code in
+   @param hash Key identifying the worklet's code
+   @param code Source of the worklet function
+   @param bytecode Optional base64 encoded Hermes bytecode of the wrapped
+   source, used instead of the source when it can be loaded by the runtime.
+   @param location Source location for the worklet
+   */
+  static std::shared_ptr<const jsi::PreparedJavaScript>
+  prepare(jsi::Runtime &runtime, const std::string &hash,
+          const std::string &code, const std::string &bytecode,
+          const std::string &location) {
+    {
+      std::lock_guard<std::mutex> lock(getMutex());
+      auto it = getCache().find(hash);
+      if (it != getCache().end()) {
+        return it->second;
+      }
+    }
+
+    // Prepare outside of the lock so that other runtimes can keep going, if
+    // two runtimes prepare the same worklet the first one wins.
+    std::shared_ptr<const jsi::PreparedJavaScript> prepared;
+    if (!bytecode.empty()) {
+      prepared = prepareBytecode(runtime, bytecode, location);
+    }
+    if (prepared == nullptr) {
+      auto codeBuffer = std::make_shared<const jsi::StringBuffer>(
+          "(" + code + std::string("\n)"));
+      prepared = runtime.prepareJavaScript(codeBuffer, location);
+    }
+
+    std::lock_guard<std::mutex> lock(getMutex());
+    return getCache().emplace(hash, std::move(prepared)).first->second;
+  }
+
+private:
+  /**
+   Prepares the precompiled bytecode, returns nullptr if the bytecode can't be
+   used by this runtime so that we can fall back to the source.
+   */
+  static std::shared_ptr<const jsi::PreparedJavaScript>
+  prepareBytecode(jsi::Runtime &runtime, const std::string &bytecode,
+                  const std::string &location) {
+#if JS_RUNTIME_HERMES
+    auto buffer = JsiByteBuffer::fromBase64(bytecode);
+    if (!facebook::hermes::HermesRuntime::isHermesBytecode(buffer->data(),
+                                                           buffer->size())) {
+      return nullptr;
+    }
+
+    // The bytecode version follows the 8 byte magic in the file header. It
+    // must match the Hermes version we're linked with.
+    uint32_t version = 0;
+    if (buffer->size() < 12) {
+      return nullptr;
+    }
+    std::memcpy(&version, buffer->data() + 8, sizeof(version));
+    if (version != facebook::hermes::HermesRuntime::getBytecodeVersion()) {
+      return nullptr;
+    }
+
+    try {
+      return runtime.prepareJavaScript(buffer, location);
+    } catch (const jsi::JSIException &) {
+      return nullptr;
+    }
+#else
+    return nullptr;
+#endif
+  }
+
+  static std::map<std::string, std::shared_ptr<const jsi::PreparedJavaScript>> &
+  getCache() {
+    static std::map<std::string, std::shared_ptr<const jsi::PreparedJavaScript>>
+        cache;
+    return cache;
+  }
+
+  static std::mutex &getMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+};
+} // namespace RNWorklet
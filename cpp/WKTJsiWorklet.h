@@ -2,27 +2,29 @@
 
 #include <jsi/jsi.h>
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <cctype>
-#include <cstdio>
+#include <cstdint>
 
 #include "WKTJsiHostObject.h"
+#include "WKTJsiPreparedJavaScript.h"
 #include "WKTJsiWorkletContext.h"
 #include "WKTJsiWrapper.h"
+#include "WKTLog.h"
 
 namespace RNWorklet {
 
-#ifndef WKT_LOG
-#define WKT_LOG(fmt, ...) std::printf("[RNWorklets] " fmt "\n", ##__VA_ARGS__)
-#endif
-
 static const char *PropNameWorkletHash = "__workletHash";
 static const char *PropNameWorkletInitData = "__initData";
 static const char *PropNameWorkletInitDataCode = "code";
+static const char *PropNameWorkletInitDataBytecode = "bytecode";
 
 static const char *PropNameJsThis = "jsThis";
 
@@ -58,22 +60,32 @@ private:
 };
 
 /**
-  Class for wrapping jsThis when executing worklets
+  Class for wrapping jsThis when executing worklets. Calling the same worklet
+  again leaves global untouched: the previous value is only restored when
+  there was one, so nested calls still see their own jsThis afterwards.
   */
 class JsThisWrapper {
 public:
   JsThisWrapper(jsi::Runtime &runtime, const jsi::Object &thisValue) {
-    _oldThis = runtime.global().getProperty(runtime, PropNameJsThis);
-    runtime.global().setProperty(runtime, PropNameJsThis, thisValue);
+    auto global = runtime.global();
+    _oldThis = global.getProperty(runtime, PropNameJsThis);
+    if (_oldThis.isObject() &&
+        jsi::Value::strictEquals(runtime, _oldThis,
+                                 jsi::Value(runtime, thisValue))) {
+      return;
+    }
+    global.setProperty(runtime, PropNameJsThis, thisValue);
     _runtime = &runtime;
   }
   ~JsThisWrapper() {
-    _runtime->global().setProperty(*_runtime, PropNameJsThis, _oldThis);
+    if (_runtime != nullptr && !_oldThis.isUndefined()) {
+      _runtime->global().setProperty(*_runtime, PropNameJsThis, _oldThis);
+    }
   }
 
 private:
   jsi::Value _oldThis;
-  jsi::Runtime *_runtime;
+  jsi::Runtime *_runtime = nullptr;
 };
 
 /**
@@ -122,6 +134,12 @@ public:
    */
   const std::string &getLocation() { return _location; }
 
+  /**
+   Returns the key identifying the worklet's code - the worklet hash from the
+   babel plugin, or the code itself if the worklet has no hash.
+   */
+  const std::string &getHash() { return _hash; }
+
   /**
   Returns true if the provided function is decorated with worklet info
   @runtime Runtime
@@ -151,7 +169,7 @@ public:
   static bool isDecoratedAsWorklet(jsi::Runtime &runtime,
                                    std::shared_ptr<jsi::Function> func) {
     auto hashProp = func->getProperty(runtime, PropNameWorkletHash);
-    if (hashProp.isString()) {
+    if (hashProp.isString() || hashProp.isNumber()) {
       return true;
     }
 
@@ -187,8 +205,9 @@ public:
   std::shared_ptr<jsi::Function>
   createWorkletJsFunction(jsi::Runtime &runtime) {
     auto makeNoop = [&runtime, this]() {
-      WKT_LOG("createWorkletJsFunction: returning NO-OP function for '%s'",
-              _location.c_str());
+      WKT_LOG_WARN(
+          "createWorkletJsFunction: returning NO-OP function for '%s'",
+          _location.c_str());
       auto func = jsi::Function::createFromHostFunction(
           runtime,
           jsi::PropNameID::forAscii(runtime, "noopWorklet"),
@@ -202,82 +221,101 @@ public:
       return std::make_shared<jsi::Function>(std::move(func));
     };
 
+    // Reuse the function if the worklet has already been evaluated in this
+    // runtime. The closure is passed in when calling, so the evaluated
+    // function can be shared between all worklets with the same code.
+    auto context = JsiWorkletContext::getCurrent(runtime);
+    auto cache = context != nullptr ? context->getWorkletCache(runtime)
+                                    : nullptr;
+    if (cache != nullptr) {
+      auto cachedFunction = cache->get(_hash);
+      if (cachedFunction != nullptr) {
+        return cachedFunction;
+      }
+    }
+
     jsi::Value evaluatedFunction;
 
     try {
       evaluatedFunction = evaluteJavascriptInWorkletRuntime(runtime, _code);
     } catch (const jsi::JSError &error) {
-      WKT_LOG("createWorkletJsFunction: eval JSError at '%s': %s",
-              _location.c_str(), error.getMessage().c_str());
+      WKT_LOG_ERROR("createWorkletJsFunction: eval JSError at '%s': %s",
+                    _location.c_str(), error.getMessage().c_str());
       return makeNoop();
     }
 
     if (!evaluatedFunction.isObject()) {
-      WKT_LOG("createWorkletJsFunction: eval did not return object at '%s'",
-              _location.c_str());
+      WKT_LOG_WARN(
+          "createWorkletJsFunction: eval did not return object at '%s'",
+          _location.c_str());
       return makeNoop();
     }
 
     auto obj = evaluatedFunction.asObject(runtime);
     if (!obj.isFunction(runtime)) {
-      WKT_LOG(
+      WKT_LOG_WARN(
           "createWorkletJsFunction: eval returned non-function object at '%s'",
           _location.c_str());
       return makeNoop();
     }
 
-    WKT_LOG("createWorkletJsFunction: created REAL worklet function at '%s'",
-            _location.c_str());
-    return std::make_shared<jsi::Function>(obj.asFunction(runtime));
+    WKT_LOG_DEBUG(
+        "createWorkletJsFunction: created REAL worklet function at '%s'",
+        _location.c_str());
+    auto function = std::make_shared<jsi::Function>(obj.asFunction(runtime));
+    if (cache != nullptr) {
+      cache->add(_hash, function);
+    }
+    return function;
   }
 
+  /**
+   Closure of the worklet unwrapped in one runtime and the object passed as
+   this. Reused between calls in that runtime until the closure changes, must
+   only be used and released on the runtime's thread.
+   */
+  struct PreparedClosure {
+    size_t version = 0;
+    jsi::Value closure;
+    std::unique_ptr<jsi::Object> thisObject;
+  };
+
   /**
    Calls the Worklet function with the given arguments.
    */
   jsi::Value call(std::shared_ptr<jsi::Function> workletFunction,
                   jsi::Runtime &runtime, const jsi::Value &thisValue,
                   const jsi::Value *arguments, size_t count) {
+    PreparedClosure prepared;
+    return call(workletFunction, prepared, runtime, thisValue, arguments,
+                count);
+  }
 
-    // Unwrap closure if we have one; otherwise use undefined.
-    jsi::Value unwrappedClosure;
-    if (_closureWrapper) {
-      unwrappedClosure = JsiWrapper::unwrap(runtime, _closureWrapper);
-    } else {
-      unwrappedClosure = jsi::Value::undefined();
-    }
+  /**
+   Calls the Worklet function with the given arguments, unwrapping the
+   closure into prepared only if it is empty or out of date.
+   */
+  jsi::Value call(std::shared_ptr<jsi::Function> workletFunction,
+                  PreparedClosure &prepared, jsi::Runtime &runtime,
+                  const jsi::Value &thisValue, const jsi::Value *arguments,
+                  size_t count) {
+    prepareClosure(runtime, prepared);
 
     if (_isRea30Compat) {
-      // Resolve this Value
-      std::unique_ptr<jsi::Object> resolvedThisValue;
       if (!thisValue.isObject()) {
-        resolvedThisValue = std::make_unique<jsi::Object>(runtime);
-      } else {
-        resolvedThisValue =
-            std::make_unique<jsi::Object>(thisValue.asObject(runtime));
+        return workletFunction->callWithThis(runtime, *prepared.thisObject,
+                                             arguments, count);
       }
 
-      // For Reanimated 3 / VisionCamera, generated worklet often reads
-      // from this._closure, but some legacy code may still expect __closure.
-      if (!unwrappedClosure.isUndefined() && !unwrappedClosure.isNull()) {
-        resolvedThisValue->setProperty(
-            runtime, PropNameWorkletClosure, unwrappedClosure);        // _closure
-        resolvedThisValue->setProperty(
-            runtime, PropNameWorkletClosureLegacy, unwrappedClosure);  // __closure
-      }
-
-      return workletFunction->callWithThis(
-          runtime, *resolvedThisValue, arguments, count);
+      // A this object from the caller gets the closure on every call
+      auto resolvedThisValue = thisValue.asObject(runtime);
+      setClosure(runtime, resolvedThisValue, prepared.closure);
+      return workletFunction->callWithThis(runtime, resolvedThisValue,
+                                           arguments, count);
 
     } else {
-      // Legacy mode: prepare jsThis
-      jsi::Object jsThis(runtime);
-      if (!unwrappedClosure.isUndefined() && !unwrappedClosure.isNull()) {
-        // Set both for maximum compatibility.
-        jsThis.setProperty(runtime, PropNameWorkletClosure, unwrappedClosure);
-        jsThis.setProperty(runtime, PropNameWorkletClosureLegacy,
-                           unwrappedClosure);
-      }
-      JsThisWrapper thisWrapper(runtime, jsThis);
+      // Legacy mode: the closure is read from global jsThis
+      JsThisWrapper thisWrapper(runtime, *prepared.thisObject);
 
       if (thisValue.isObject()) {
         return workletFunction->callWithThis(
@@ -289,6 +327,39 @@ public:
   }
 
 private:
+  /**
+   Unwraps the closure into prepared unless it already holds the current
+   version
+   */
+  void prepareClosure(jsi::Runtime &runtime, PreparedClosure &prepared) {
+    auto version = _closureVersion->load(std::memory_order_acquire);
+    if (prepared.thisObject != nullptr && prepared.version == version) {
+      return;
+    }
+
+    // Read the version first, a change while unwrapping is picked up on the
+    // next call
+    prepared.version = version;
+    prepared.closure = _closureWrapper
+                           ? JsiWrapper::unwrap(runtime, _closureWrapper)
+                           : jsi::Value::undefined();
+    prepared.thisObject = std::make_unique<jsi::Object>(runtime);
+    setClosure(runtime, *prepared.thisObject, prepared.closure);
+  }
+
+  /**
+   Sets the closure on the this object. Generated worklets read _closure, some
+   legacy code still expects __closure, so both are set.
+   */
+  static void setClosure(jsi::Runtime &runtime, jsi::Object &thisObject,
+                         const jsi::Value &closure) {
+    if (closure.isUndefined() || closure.isNull()) {
+      return;
+    }
+    thisObject.setProperty(runtime, PropNameWorkletClosure, closure);
+    thisObject.setProperty(runtime, PropNameWorkletClosureLegacy, closure);
+  }
+
   /**
    Installs the worklet function into the worklet runtime
   */
@@ -312,7 +383,11 @@ private:
     _isRea30Compat = false;
     _code.clear();
     _location.clear();
+    _bytecode.clear();
+    _hash.clear();
+    _workletHash = 0;
     _closureWrapper.reset();
+    _closureVersion->fetch_add(1, std::memory_order_release);
 
     // 1) New style: __initData from worklets-core / Reanimated 3
     jsi::Value initDataProp =
@@ -335,6 +410,13 @@ private:
       }
       _code = codeProp.asString(runtime).utf8(runtime);
 
+      // Optional precompiled Hermes bytecode from the babel plugin
+      jsi::Value bytecodeProp =
+          initDataObj.getProperty(runtime, PropNameWorkletInitDataBytecode);
+      if (bytecodeProp.isString()) {
+        _bytecode = bytecodeProp.asString(runtime).utf8(runtime);
+      }
+
       _isRea30Compat = true;
 
     } else {
@@ -353,10 +435,11 @@ private:
       _isRea30Compat = false;
     }
 
-    WKT_LOG("createWorklet: isRea30Compat=%d location='%s' codeLen=%zu",
-            _isRea30Compat ? 1 : 0, _location.c_str(), _code.size());
+    WKT_LOG_DEBUG("createWorklet: isRea30Compat=%d location='%s' codeLen=%zu",
+                  _isRea30Compat ? 1 : 0, _location.c_str(), _code.size());
     if (_code.size() > 0) {
-      WKT_LOG("createWorklet code (first 80 chars): %.80s", _code.c_str());
+      WKT_LOG_VERBOSE("createWorklet code (first 80 chars): %.80s",
+                      _code.c_str());
     }
     
     // 3) Validate code length / content, avoid "()" crashes
@@ -392,11 +475,27 @@ private:
 
     if (!closure.isUndefined() && !closure.isNull()) {
       _closureWrapper = JsiWrapper::wrap(runtime, closure);
+      // Prepared closures are unwrapped again after the closure changed
+      _closureWrapper->addListener(std::make_shared<JsiWrapperListener>(
+          [version = _closureVersion](const std::vector<std::string> &) {
+            version->fetch_add(1, std::memory_order_release);
+          }));
     } else {
       _closureWrapper.reset();
     }
 
-    // 5) Name (optional)
+    // 5) Hash (optional) - identifies the code for caching
+    auto hashProp = func->getProperty(runtime, PropNameWorkletHash);
+    if (hashProp.isNumber()) {
+      _workletHash = hashProp.getNumber();
+      _hash = std::to_string(static_cast<uint64_t>(_workletHash));
+    } else if (hashProp.isString()) {
+      _hash = hashProp.asString(runtime).utf8(runtime);
+    } else {
+      _hash = _code;
+    }
+
+    // 6) Name (optional)
     auto nameProp = func->getProperty(runtime, PropFunctionName);
     if (nameProp.isString()) {
       _name = nameProp.asString(runtime).utf8(runtime);
@@ -418,30 +517,37 @@ private:
     }
 
     if (isEmpty || code.size() <= 3) {
-      WKT_LOG(
+      WKT_LOG_WARN(
           "evaluteJavascriptInWorkletRuntime: EMPTY/TINY code (len=%zu) at "
           "'%s', skipping eval",
           code.size(), _location.c_str());
       return jsi::Value::undefined();
     }
 
-    std::string wrappedCode = "(" + code + std::string("\n)");
-
-    WKT_LOG(
+    WKT_LOG_DEBUG(
         "evaluteJavascriptInWorkletRuntime: evaluating codeLen=%zu "
-        "wrappedLen=%zu location='%s'",
-        code.size(), wrappedCode.size(), _location.c_str());
-
-    auto codeBuffer = std::make_shared<const jsi::StringBuffer>(wrappedCode);
+        "location='%s'",
+        code.size(), _location.c_str());
 
     try {
+      // Worklet runtimes share the prepared code, so each worklet is only
+      // parsed once. The JS runtime can use another engine configuration, so
+      // there we evaluate the source directly.
+      if (JsiWorkletContext::getCurrent(runtime) != nullptr) {
+        auto prepared = JsiPreparedJavaScriptCache::prepare(
+            runtime, _hash, code, _bytecode, _location);
+        return runtime.evaluatePreparedJavaScript(prepared);
+      }
+
+      auto codeBuffer = std::make_shared<const jsi::StringBuffer>(
+          "(" + code + std::string("\n)"));
       return runtime.evaluateJavaScript(codeBuffer, _location);
     } catch (const jsi::JSError &error) {
-      WKT_LOG("evaluteJavascriptInWorkletRuntime: JSError at '%s': %s",
-              _location.c_str(), error.getMessage().c_str());
+      WKT_LOG_ERROR("evaluteJavascriptInWorkletRuntime: JSError at '%s': %s",
+                    _location.c_str(), error.getMessage().c_str());
       return jsi::Value::undefined();
     } catch (...) {
-      WKT_LOG(
+      WKT_LOG_ERROR(
           "evaluteJavascriptInWorkletRuntime: UNKNOWN exception at '%s'",
           _location.c_str());
       return jsi::Value::undefined();
@@ -450,9 +556,13 @@ private:
 
   bool _isWorklet = false;
   std::shared_ptr<JsiWrapper> _closureWrapper;
+  // Shared with the closure wrapper's listener
+  std::shared_ptr<std::atomic<size_t>> _closureVersion =
+      std::make_shared<std::atomic<size_t>>(1);
   std::string _location = "";
   std::string _code = "";
   std::string _name = "fn";
+  std::string _bytecode;
   std::string _hash;
   bool _isRea30Compat = false;
   double _workletHash = 0;
@@ -466,47 +576,47 @@ public:
       : WorkletInvoker(std::make_shared<JsiWorklet>(runtime, value)) {}
 
   ~WorkletInvoker() {
-    if (_workletFunction) {
-      auto tmp = _workletFunction;
-      _workletFunction = nullptr;
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto &entry : _workletFunctions) {
+      auto tmp = std::make_pair(std::move(entry.second.function),
+                                std::move(entry.second.closure));
+      auto &owningContext = entry.second.owningContext;
 
-      if (_owningContext == nullptr) {
+      if (owningContext == nullptr) {
         JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
-            [tmp = std::move(tmp)](jsi::Runtime &) mutable { tmp = nullptr; });
+            [tmp = std::move(tmp)](jsi::Runtime &) mutable {
+              tmp.first = nullptr;
+              tmp.second = nullptr;
+            });
       } else {
-        _owningContext->invokeOnWorkletThread(
-            [tmp = std::move(tmp)](JsiWorkletContext *,
-                                   jsi::Runtime &) mutable { tmp = nullptr; });
+        // The function must be released on the runtime that created it
+        owningContext->invokeOnWorkletRuntime(
+            *entry.first, [tmp = std::move(tmp)](JsiWorkletContext *,
+                                                 jsi::Runtime &) mutable {
+              tmp.first = nullptr;
+              tmp.second = nullptr;
+            });
       }
     }
   }
 
   jsi::Value call(jsi::Runtime &runtime, const jsi::Value &thisValue,
                   const jsi::Value *arguments, size_t count) {
-    if (_workletFunction == nullptr) {
-      WKT_LOG("WorkletInvoker::call: creating worklet function for '%s'",
-              _worklet->getLocation().c_str());
-      _workletFunction = _worklet->createWorkletJsFunction(runtime);
-      auto owningContext = JsiWorkletContext::getCurrent(runtime);
-      if (owningContext) {
-        _owningContext = owningContext->shared_from_this();
-      } else {
-        _owningContext = nullptr;
-      }
-    }
+    auto &workletFunction = getWorkletFunction(runtime);
 
-    WKT_LOG("WorkletInvoker::call: invoking worklet '%s'",
-            _worklet->getLocation().c_str());
+    WKT_LOG_VERBOSE("WorkletInvoker::call: invoking worklet '%s'",
+                    _worklet->getLocation().c_str());
 
     try {
-      return _worklet->call(_workletFunction, runtime, thisValue, arguments,
-                            count);
+      return _worklet->call(workletFunction.function, *workletFunction.closure,
+                            runtime, thisValue, arguments, count);
     } catch (const jsi::JSError &error) {
-      WKT_LOG("WorkletInvoker::call: JSError while invoking '%s': %s",
-              _worklet->getLocation().c_str(), error.getMessage().c_str());
+      WKT_LOG_ERROR("WorkletInvoker::call: JSError while invoking '%s': %s",
+                    _worklet->getLocation().c_str(),
+                    error.getMessage().c_str());
       return jsi::Value::undefined();
     } catch (...) {
-      WKT_LOG(
+      WKT_LOG_ERROR(
           "WorkletInvoker::call: UNKNOWN exception while invoking '%s'",
           _worklet->getLocation().c_str());
       return jsi::Value::undefined();
@@ -514,9 +624,46 @@ public:
   }
 
 private:
-  std::shared_ptr<JsiWorkletContext> _owningContext;
+  struct WorkletFunction {
+    std::shared_ptr<JsiWorkletContext> owningContext;
+    std::shared_ptr<jsi::Function> function;
+    std::shared_ptr<JsiWorklet::PreparedClosure> closure;
+  };
+
+  /**
+   Returns the worklet function and prepared closure for the given runtime,
+   creating them on first use. Pooled contexts can call the same invoker from
+   several runtimes, so each runtime gets its own. The entry is only used on
+   the runtime's thread and stays in place until the invoker is destroyed.
+   */
+  WorkletFunction &getWorkletFunction(jsi::Runtime &runtime) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto it = _workletFunctions.find(&runtime);
+      if (it != _workletFunctions.end()) {
+        return it->second;
+      }
+    }
+
+    // Evaluate outside of the lock, other runtimes can keep calling
+    WKT_LOG_DEBUG("WorkletInvoker::call: creating worklet function for '%s'",
+                  _worklet->getLocation().c_str());
+    WorkletFunction workletFunction;
+    workletFunction.function = _worklet->createWorkletJsFunction(runtime);
+    workletFunction.closure = std::make_shared<JsiWorklet::PreparedClosure>();
+    auto owningContext = JsiWorkletContext::getCurrent(runtime);
+    if (owningContext) {
+      workletFunction.owningContext = owningContext->shared_from_this();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto result = _workletFunctions.emplace(&runtime, std::move(workletFunction));
+    return result.first->second;
+  }
+
   std::shared_ptr<JsiWorklet> _worklet;
-  std::shared_ptr<jsi::Function> _workletFunction;
+  std::mutex _mutex;
+  std::map<jsi::Runtime *, WorkletFunction> _workletFunctions;
 };
 
 } // namespace RNWorklet
@@ -35,8 +35,41 @@ void JsiWorkletApi::installApi(jsi::Runtime &runtime) {
 }
 
 std::shared_ptr<JsiWorkletContext>
-JsiWorkletApi::createWorkletContext(const std::string &name) {
-  return std::make_shared<JsiWorkletContext>(name);
+JsiWorkletApi::createWorkletContext(
+    const std::string &name, const DispatchThreadOptions &threadOptions) {
+  // Pre-warmed contexts already run on threads with the default options
+  if (threadOptions.isDefault()) {
+    std::lock_guard<std::mutex> lock(_prewarmedContextsMutex);
+    if (!_prewarmedContexts.empty()) {
+      auto context = _prewarmedContexts.back();
+      _prewarmedContexts.pop_back();
+      context->setName(name);
+      return context;
+    }
+  }
+  auto context = std::make_shared<JsiWorkletContext>(name, threadOptions);
+  context->warmUp();
+  return context;
+}
+
+std::shared_ptr<JsiWorkletContext>
+JsiWorkletApi::createWorkletContext(
+    const std::string &name, size_t poolSize,
+    const DispatchThreadOptions &threadOptions) {
+  auto context =
+      std::make_shared<JsiWorkletContext>(name, poolSize, threadOptions);
+  context->warmUp();
+  return context;
+}
+
+void JsiWorkletApi::prewarmContexts(size_t count) {
+  std::lock_guard<std::mutex> lock(_prewarmedContextsMutex);
+  while (_prewarmedContexts.size() < count) {
+    // Named on hand-out, the context id keeps the thread names unique
+    auto context = std::make_shared<JsiWorkletContext>("prewarmed");
+    context->warmUp();
+    _prewarmedContexts.push_back(context);
+  }
 }
 
 std::shared_ptr<JsiWorkletApi> JsiWorkletApi::getInstance() {
@@ -3,21 +3,43 @@
 #include <jsi/jsi.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "WKTJsiBlockPool.h"
+#include "WKTJsiChannel.h"
+#include "WKTJsiConsoleDecorator.h"
 #include "WKTJsiHostObject.h"
 #include "WKTJsiJsDecorator.h"
+#include "WKTJsiMemoryStats.h"
+#include "WKTJsiNotificationBatch.h"
 #include "WKTJsiPromiseWrapper.h"
+#include "WKTJsiSharedFloat32Vector.h"
+#include "WKTJsiSharedNumber.h"
 #include "WKTJsiSharedValue.h"
 #include "WKTJsiWorklet.h"
 #include "WKTJsiWorkletContext.h"
+#include "WKTJsiWorkletPipeline.h"
+#include "WKTJsiWorkletTrace.h"
 #include "WKTJsiWrapper.h"
 
 namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
 
+static const char *PropNameTransfer = "transfer";
+static const char *PropNameTimeout = "timeout";
+static const char *PropNameRawResult = "rawResult";
+static const char *PropNamePriority = "priority";
+static const char *PropNameNativePromise = "nativePromise";
+static const char *PropNamePoolSize = "poolSize";
+static const char *PropNameThreadName = "threadName";
+static const char *PropNameQoS = "qos";
+static const char *PropNameNice = "nice";
+static const char *PropNameStackSize = "stackSize";
+static const char *PropNameAffinity = "affinity";
+
 class JsiWorkletApi : public JsiHostObject {
 public:
   // Name of the Worklet API member (where to install on global)
@@ -51,8 +73,27 @@ public:
     }
 
     auto nameStr = arguments[0].asString(runtime).utf8(runtime);
-    return jsi::Object::createFromHostObject(runtime,
-                                             createWorkletContext(nameStr));
+
+    // Optional number of threads in the context, or an options object with
+    // the pool size and scheduling options
+    size_t poolSize = 1;
+    DispatchThreadOptions threadOptions;
+    if (count > 1 && arguments[1].isObject()) {
+      auto options = arguments[1].asObject(runtime);
+      poolSize = getPoolSize(runtime, options.getProperty(runtime,
+                                                          PropNamePoolSize));
+      threadOptions = getThreadOptions(runtime, options);
+    } else if (count > 1) {
+      poolSize = getPoolSize(runtime, arguments[1]);
+    }
+
+    if (poolSize > 1) {
+      return jsi::Object::createFromHostObject(
+          runtime, createWorkletContext(nameStr, poolSize, threadOptions));
+    }
+
+    return jsi::Object::createFromHostObject(
+        runtime, createWorkletContext(nameStr, threadOptions));
   };
 
   JSI_HOST_FUNCTION(createSharedValue) {
@@ -62,6 +103,34 @@ public:
             arguments[0], JsiWorkletContext::getDefaultInstance()));
   };
 
+  JSI_HOST_FUNCTION(createSharedNumber) {
+    auto value = 0.0;
+    if (count > 0 && !arguments[0].isUndefined()) {
+      if (!arguments[0].isNumber()) {
+        throw jsi::JSError(runtime,
+                           "createSharedNumber expects a number as its "
+                           "initial value.");
+      }
+      value = arguments[0].getNumber();
+    }
+    return jsi::Object::createFromHostObject(
+        runtime, std::make_shared<JsiSharedNumber>(value));
+  }
+
+  JSI_HOST_FUNCTION(createSharedFloat32Vector) {
+    if (count == 0 || !arguments[0].isNumber() || arguments[0].asNumber() < 0) {
+      throw jsi::JSError(runtime, "createSharedFloat32Vector expects the "
+                                  "number of elements as a non-negative "
+                                  "number.");
+    }
+    auto vector = std::make_shared<JsiSharedFloat32Vector>(
+        static_cast<size_t>(arguments[0].asNumber()));
+    if (count > 1 && !arguments[1].isUndefined()) {
+      vector->write(runtime, arguments[1]);
+    }
+    return jsi::Object::createFromHostObject(runtime, vector);
+  }
+
   JSI_HOST_FUNCTION(createRunInJsFn) {
     if (count == 0) {
       throw jsi::JSError(runtime, "createRunInJsFn expects one parameter.");
@@ -99,7 +168,7 @@ public:
 
     // Get the active context
     auto activeContext =
-        count == 2 && arguments[1].isObject()
+        count >= 2 && arguments[1].isObject()
             ? arguments[1].asObject(runtime).getHostObject<JsiWorkletContext>(
                   runtime)
             : JsiWorkletContext::getDefaultInstance();
@@ -109,8 +178,12 @@ public:
                          "createRunInContextFn called with invalid context.");
     }
 
-    auto caller = JsiWorkletContext::createCallInContext(runtime, arguments[0],
-                                                         activeContext.get());
+    // Get the call options
+    auto options = count >= 3 ? getCallOptions(runtime, arguments[2])
+                              : CallOptions();
+
+    auto caller = JsiWorkletContext::createCallInContext(
+        runtime, arguments[0], activeContext.get(), options);
 
     // Now let us create the caller function.
     return jsi::Function::createFromHostFunction(
@@ -120,10 +193,210 @@ public:
         });
   }
 
+  JSI_HOST_FUNCTION(createRunInContextSyncFn) {
+    if (count == 0) {
+      throw jsi::JSError(
+          runtime, "createRunInContextSyncFn expects at least one parameter.");
+    }
+
+    // Get the active context
+    auto activeContext =
+        count >= 2 && arguments[1].isObject()
+            ? arguments[1].asObject(runtime).getHostObject<JsiWorkletContext>(
+                  runtime)
+            : JsiWorkletContext::getDefaultInstance();
+
+    if (activeContext == nullptr) {
+      throw jsi::JSError(
+          runtime, "createRunInContextSyncFn called with invalid context.");
+    }
+
+    // Get the call options
+    auto options = count >= 3 ? getCallOptions(runtime, arguments[2])
+                              : CallOptions();
+
+    auto caller = JsiWorkletContext::createCallInContextSync(
+        runtime, arguments[0], activeContext.get(), options);
+
+    // Now let us create the caller function.
+    return jsi::Function::createFromHostFunction(
+        runtime, jsi::PropNameID::forAscii(runtime, "runInContextSyncFn"), 0,
+        JSI_HOST_FUNCTION_LAMBDA {
+          return caller(runtime, thisValue, arguments, count);
+        });
+  }
+
+  JSI_HOST_FUNCTION(createPipelineStage) {
+    if (count == 0) {
+      throw jsi::JSError(
+          runtime, "createPipelineStage expects at least one parameter.");
+    }
+
+    // Stages without a context run on the JS thread
+    std::shared_ptr<JsiWorkletContext> context;
+    if (count >= 2 && arguments[1].isObject()) {
+      context =
+          arguments[1].asObject(runtime).getHostObject<JsiWorkletContext>(
+              runtime);
+      if (context == nullptr) {
+        throw jsi::JSError(runtime,
+                           "createPipelineStage called with invalid context.");
+      }
+    }
+
+    auto options = count >= 3
+                       ? JsiPipelineStage::getOptions(runtime, arguments[2])
+                       : PipelineStageOptions();
+
+    return jsi::Object::createFromHostObject(
+        runtime, std::make_shared<JsiPipelineStage>(runtime, arguments[0],
+                                                    context, options));
+  }
+
+  JSI_HOST_FUNCTION(createChannel) {
+    if (count == 0 || !arguments[0].isNumber() || arguments[0].asNumber() < 1) {
+      throw jsi::JSError(runtime, "createChannel expects the capacity as a "
+                                  "positive number.");
+    }
+    auto capacity = static_cast<size_t>(arguments[0].asNumber());
+
+    auto mode = RingBufferMode::MultiProducerMultiConsumer;
+    if (count >= 2 && !arguments[1].isUndefined()) {
+      auto modeStr = arguments[1].isString()
+                         ? arguments[1].asString(runtime).utf8(runtime)
+                         : "";
+      if (modeStr == "spsc") {
+        mode = RingBufferMode::SingleProducerSingleConsumer;
+      } else if (modeStr != "mpmc") {
+        throw jsi::JSError(runtime, "createChannel expects the mode as "
+                                    "\"spsc\" or \"mpmc\".");
+      }
+    }
+
+    return jsi::Object::createFromHostObject(
+        runtime, std::make_shared<JsiChannel>(capacity, mode));
+  }
+
+  JSI_HOST_FUNCTION(prewarmContexts) {
+    if (count == 0 || !arguments[0].isNumber() || arguments[0].asNumber() < 0) {
+      throw jsi::JSError(runtime, "prewarmContexts expects the number of "
+                                  "contexts as a non-negative number.");
+    }
+    prewarmContexts(static_cast<size_t>(arguments[0].asNumber()));
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(isCancelled) {
+    // Token of the call running on this thread
+    auto token = CancellationToken::getCurrent();
+    return token != nullptr && token->isCancelled();
+  }
+
+  JSI_HOST_FUNCTION(batch) {
+    if (count == 0 || !arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime,
+                         "batch expects a function as its parameter.");
+    }
+
+    // Listeners are notified once with all changed paths when the outermost
+    // batch on this thread ends
+    JsiNotificationBatch::Scope scope;
+    return arguments[0].asObject(runtime).asFunction(runtime).call(runtime);
+  }
+
+  JSI_HOST_FUNCTION(getMemoryStats) {
+    // Same order as JsiWrapperType
+    static const char *typeNames[] = {
+        "undefined", "null",    "bool",       "number",       "string",
+        "array",     "object",  "promise",    "hostObject",   "hostFunction",
+        "arrayBuffer"};
+    static_assert(sizeof(typeNames) / sizeof(typeNames[0]) ==
+                      JsiWrapperTypeCount,
+                  "typeNames must have a name for each JsiWrapperType");
+
+    auto toObject = [&](const JsiMemoryCounter &counter) {
+      jsi::Object result(runtime);
+      result.setProperty(
+          runtime, "count",
+          static_cast<double>(counter.count.load(std::memory_order_relaxed)));
+      result.setProperty(
+          runtime, "bytes",
+          static_cast<double>(counter.bytes.load(std::memory_order_relaxed)));
+      return result;
+    };
+
+    jsi::Object byType(runtime);
+    double wrapperCount = 0;
+    double wrapperBytes = 0;
+    for (size_t i = 0; i < JsiWrapperTypeCount; i++) {
+      auto &counter = JsiMemoryStats::getWrapperCounter(i);
+      wrapperCount += counter.count.load(std::memory_order_relaxed);
+      wrapperBytes += counter.bytes.load(std::memory_order_relaxed);
+      byType.setProperty(runtime, typeNames[i], toObject(counter));
+    }
+    jsi::Object wrappers(runtime);
+    wrappers.setProperty(runtime, "count", wrapperCount);
+    wrappers.setProperty(runtime, "bytes", wrapperBytes);
+    wrappers.setProperty(runtime, "byType", byType);
+
+    jsi::Object hostObjects(runtime);
+    hostObjects.setProperty(
+        runtime, "count",
+        static_cast<double>(JsiMemoryStats::getHostObjectCounter().count.load(
+            std::memory_order_relaxed)));
+
+    std::vector<jsi::Value> contextEntries;
+    JsiMemoryStats::forEachContextCounter(
+        [&](const JsiMemoryStats::ContextCounter &context) {
+          auto entry = toObject(context.counter);
+          entry.setProperty(runtime, "contextId",
+                            static_cast<double>(context.contextId));
+          entry.setProperty(runtime, "name", context.name);
+          contextEntries.push_back(std::move(entry));
+        });
+    auto contexts = jsi::Array(runtime, contextEntries.size());
+    for (size_t i = 0; i < contextEntries.size(); i++) {
+      contexts.setValueAtIndex(runtime, i, contextEntries[i]);
+    }
+
+    auto &poolStats = JsiBlockPoolStats::get();
+    jsi::Object pool(runtime);
+    pool.setProperty(runtime, "pooledBlocks",
+                     static_cast<double>(poolStats.pooledBlocks.load(
+                         std::memory_order_relaxed)));
+    pool.setProperty(runtime, "pooledBytes",
+                     static_cast<double>(poolStats.pooledBytes.load(
+                         std::memory_order_relaxed)));
+    pool.setProperty(
+        runtime, "hits",
+        static_cast<double>(poolStats.hits.load(std::memory_order_relaxed)));
+    pool.setProperty(
+        runtime, "misses",
+        static_cast<double>(poolStats.misses.load(std::memory_order_relaxed)));
+
+    jsi::Object result(runtime);
+    result.setProperty(runtime, "wrappers", wrappers);
+    result.setProperty(runtime, "hostObjects", hostObjects);
+    result.setProperty(runtime, "contexts", contexts);
+    result.setProperty(runtime, "pool", pool);
+    return result;
+  }
+
   JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiWorkletApi, createSharedValue),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createSharedNumber),
+                       JSI_EXPORT_FUNC(JsiWorkletApi,
+                                       createSharedFloat32Vector),
                        JSI_EXPORT_FUNC(JsiWorkletApi, createContext),
                        JSI_EXPORT_FUNC(JsiWorkletApi, createRunInContextFn),
-                       JSI_EXPORT_FUNC(JsiWorkletApi, createRunInJsFn))
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createRunInJsFn),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createRunInContextSyncFn),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createPipelineStage),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, createChannel),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, prewarmContexts),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, batch),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, getMemoryStats),
+                       JSI_EXPORT_FUNC(JsiWorkletApi, isCancelled))
 
   JSI_PROPERTY_GET(defaultContext) {
     return jsi::Object::createFromHostObject(
@@ -137,20 +410,238 @@ public:
         runtime, current->shared_from_this());
   }
 
+  JSI_PROPERTY_GET(tracingEnabled) { return JsiWorkletTrace::isEnabled(); }
+
+  JSI_PROPERTY_SET(tracingEnabled) {
+    if (!value.isBool()) {
+      throw jsi::JSError(runtime, "tracingEnabled expects a boolean.");
+    }
+    JsiWorkletTrace::setEnabled(value.getBool());
+  }
+
+  JSI_PROPERTY_GET(consoleLevel) {
+    auto level = JsiConsoleImpl::getLevel().load();
+    for (size_t i = 0; i < ConsoleLevelNames.size(); i++) {
+      if (ConsoleLevelNames[i].first == level) {
+        return jsi::String::createFromAscii(runtime,
+                                            ConsoleLevelNames[i].second);
+      }
+    }
+    return jsi::Value::undefined();
+  }
+
+  JSI_PROPERTY_SET(consoleLevel) {
+    if (value.isString()) {
+      auto name = value.asString(runtime).utf8(runtime);
+      for (size_t i = 0; i < ConsoleLevelNames.size(); i++) {
+        if (name == ConsoleLevelNames[i].second) {
+          JsiConsoleImpl::setLevel(ConsoleLevelNames[i].first);
+          return;
+        }
+      }
+    }
+    throw jsi::JSError(runtime, "consoleLevel expects one of \"log\", "
+                                "\"info\", \"warn\", \"error\" or "
+                                "\"none\".");
+  }
+
   JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiWorkletApi,
                                                   defaultContext),
                               JSI_EXPORT_PROP_GET(JsiWorkletApi,
-                                                  currentContext))
+                                                  currentContext),
+                              JSI_EXPORT_PROP_GET(JsiWorkletApi,
+                                                  tracingEnabled),
+                              JSI_EXPORT_PROP_GET(JsiWorkletApi,
+                                                  consoleLevel))
+
+  JSI_EXPORT_PROPERTY_SETTERS(JSI_EXPORT_PROP_SET(JsiWorkletApi,
+                                                  tracingEnabled),
+                              JSI_EXPORT_PROP_SET(JsiWorkletApi,
+                                                  consoleLevel))
 
   /**
    Creates a new worklet context
    @name Name of the context
+   @threadOptions Scheduling options for the context's thread. Pre-warmed
+   contexts are only handed out for the default options.
+   @returns A new worklet context that has been initialized and decorated.
+   */
+  std::shared_ptr<JsiWorkletContext>
+  createWorkletContext(const std::string &name,
+                       const DispatchThreadOptions &threadOptions = {});
+
+  /**
+   Creates a new worklet context backed by a pool of threads
+   @name Name of the context
+   @poolSize Number of threads and worklet runtimes in the context
+   @threadOptions Scheduling options for the pool's threads
    @returns A new worklet context that has been initialized and decorated.
    */
   std::shared_ptr<JsiWorkletContext>
-  createWorkletContext(const std::string &name);
+  createWorkletContext(const std::string &name, size_t poolSize,
+                       const DispatchThreadOptions &threadOptions = {});
+
+  /**
+   Creates contexts with their runtimes built and decorated on background
+   threads, handed out by createWorkletContext (single threaded contexts
+   only). Call early, for example at app start, to keep the runtime creation
+   off the critical path.
+   @count Number of contexts to keep ready
+   */
+  void prewarmContexts(size_t count);
 
 private:
+  std::mutex _prewarmedContextsMutex;
+  std::vector<std::shared_ptr<JsiWorkletContext>> _prewarmedContexts;
+
+  /**
+   Reads the optional pool size passed to createContext
+   */
+  static size_t getPoolSize(jsi::Runtime &runtime, const jsi::Value &value) {
+    if (value.isUndefined()) {
+      return 1;
+    }
+    if (!value.isNumber() || value.asNumber() < 1) {
+      throw jsi::JSError(runtime, "createWorkletContext expects the pool size "
+                                  "parameter as a positive number.");
+    }
+    return static_cast<size_t>(value.asNumber());
+  }
+
+  /**
+   Reads the scheduling options from a createContext options object
+   */
+  static DispatchThreadOptions getThreadOptions(jsi::Runtime &runtime,
+                                                const jsi::Object &options) {
+    DispatchThreadOptions threadOptions;
+    auto threadName = options.getProperty(runtime, PropNameThreadName);
+    if (threadName.isString()) {
+      threadOptions.name = threadName.asString(runtime).utf8(runtime);
+    } else if (!threadName.isUndefined()) {
+      throw jsi::JSError(runtime, "The threadName option must be a string.");
+    }
+
+    auto qos = options.getProperty(runtime, PropNameQoS);
+    if (qos.isString()) {
+      auto qosStr = qos.asString(runtime).utf8(runtime);
+      if (qosStr == "background") {
+        threadOptions.qos = DispatchQoS::Background;
+      } else if (qosStr == "utility") {
+        threadOptions.qos = DispatchQoS::Utility;
+      } else if (qosStr == "userInitiated") {
+        threadOptions.qos = DispatchQoS::UserInitiated;
+      } else if (qosStr == "userInteractive") {
+        threadOptions.qos = DispatchQoS::UserInteractive;
+      } else if (qosStr != "default") {
+        throw jsi::JSError(runtime, "Invalid qos option \"" + qosStr +
+                                        "\", expected \"background\", "
+                                        "\"utility\", \"default\", "
+                                        "\"userInitiated\" or "
+                                        "\"userInteractive\".");
+      }
+    } else if (!qos.isUndefined()) {
+      throw jsi::JSError(runtime, "The qos option must be a string.");
+    }
+
+    auto nice = options.getProperty(runtime, PropNameNice);
+    if (nice.isNumber()) {
+      threadOptions.nice = static_cast<int>(nice.asNumber());
+    } else if (!nice.isUndefined()) {
+      throw jsi::JSError(runtime, "The nice option must be a number.");
+    }
+
+    auto stackSize = options.getProperty(runtime, PropNameStackSize);
+    if (stackSize.isNumber() && stackSize.asNumber() >= 0) {
+      threadOptions.stackSize = static_cast<size_t>(stackSize.asNumber());
+    } else if (!stackSize.isUndefined()) {
+      throw jsi::JSError(
+          runtime, "The stackSize option must be a non-negative number.");
+    }
+
+    auto affinity = options.getProperty(runtime, PropNameAffinity);
+    if (affinity.isObject() && affinity.asObject(runtime).isArray(runtime)) {
+      auto cores = affinity.asObject(runtime).asArray(runtime);
+      for (size_t i = 0; i < cores.size(runtime); i++) {
+        auto core = cores.getValueAtIndex(runtime, i);
+        if (!core.isNumber() || core.asNumber() < 0 ||
+            core.asNumber() >= 64) {
+          throw jsi::JSError(runtime, "The affinity option expects core "
+                                      "indexes from 0 to 63.");
+        }
+        threadOptions.affinityMask |= uint64_t(1)
+                                      << static_cast<int>(core.asNumber());
+      }
+    } else if (!affinity.isUndefined()) {
+      throw jsi::JSError(runtime,
+                         "The affinity option must be an array of core "
+                         "indexes.");
+    }
+    return threadOptions;
+  }
+
+  /**
+   Reads the call options from a javascript options object
+   */
+  static CallOptions getCallOptions(jsi::Runtime &runtime,
+                                    const jsi::Value &value) {
+    CallOptions options;
+    if (value.isUndefined() || value.isNull()) {
+      return options;
+    }
+    if (!value.isObject()) {
+      throw jsi::JSError(runtime, "createRunInContextFn expects the options "
+                                  "parameter as an object.");
+    }
+    auto transfer =
+        value.asObject(runtime).getProperty(runtime, PropNameTransfer);
+    if (transfer.isString()) {
+      auto transferStr = transfer.asString(runtime).utf8(runtime);
+      if (transferStr == "serialize") {
+        options.transferMode = TransferMode::Serialize;
+      } else if (transferStr != "wrap") {
+        throw jsi::JSError(runtime, "Invalid transfer option \"" +
+                                        transferStr +
+                                        "\", expected \"wrap\" or "
+                                        "\"serialize\".");
+      }
+    } else if (!transfer.isUndefined()) {
+      throw jsi::JSError(runtime, "The transfer option must be a string.");
+    }
+    auto priority =
+        value.asObject(runtime).getProperty(runtime, PropNamePriority);
+    if (priority.isString()) {
+      auto priorityStr = priority.asString(runtime).utf8(runtime);
+      if (priorityStr == "high") {
+        options.priority = DispatchPriority::High;
+      } else if (priorityStr == "low") {
+        options.priority = DispatchPriority::Low;
+      } else if (priorityStr != "normal") {
+        throw jsi::JSError(runtime, "Invalid priority option \"" +
+                                        priorityStr +
+                                        "\", expected \"high\", "
+                                        "\"normal\" or \"low\".");
+      }
+    } else if (!priority.isUndefined()) {
+      throw jsi::JSError(runtime, "The priority option must be a string.");
+    }
+    auto rawResult =
+        value.asObject(runtime).getProperty(runtime, PropNameRawResult);
+    options.rawResult = rawResult.isBool() && rawResult.getBool();
+    auto nativePromise =
+        value.asObject(runtime).getProperty(runtime, PropNameNativePromise);
+    options.nativePromise = nativePromise.isBool() && nativePromise.getBool();
+    auto timeout =
+        value.asObject(runtime).getProperty(runtime, PropNameTimeout);
+    if (timeout.isNumber() && timeout.asNumber() >= 0) {
+      options.timeout = std::chrono::milliseconds(
+          static_cast<int64_t>(timeout.asNumber()));
+    } else if (!timeout.isUndefined()) {
+      throw jsi::JSError(runtime,
+                         "The timeout option must be a non-negative number.");
+    }
+    return options;
+  }
+
   // Instance/singletong
   static std::shared_ptr<JsiWorkletApi> instance;
 };
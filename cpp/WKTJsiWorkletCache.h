@@ -0,0 +1,109 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Default number of evaluated worklet functions kept per worklet runtime
+ */
+static const size_t DefaultWorkletCacheSize = 256;
+
+/**
+ Least recently used cache of evaluated worklet functions in a single worklet
+ runtime, keyed by the worklet hash. The functions in the cache belong to the
+ runtime, so the cache must only be read from and added to on the runtime's
+ thread - changing the max size from another thread is safe, the cache is
+ trimmed the next time a function is added.
+ */
+class JsiWorkletCache {
+public:
+  explicit JsiWorkletCache(size_t maxSize = DefaultWorkletCacheSize)
+      : _maxSize(maxSize) {}
+
+  /**
+   Returns the function for the given worklet hash, or nullptr if the worklet
+   has not been evaluated in the runtime.
+   */
+  std::shared_ptr<jsi::Function> get(const std::string &hash) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _lookup.find(hash);
+    if (it == _lookup.end()) {
+      return nullptr;
+    }
+    // Move to front as the most recently used
+    _entries.splice(_entries.begin(), _entries, it->second);
+    return it->second->second;
+  }
+
+  /**
+   Adds the function for the given worklet hash, evicting the least recently
+   used functions if the cache is full.
+   */
+  void add(const std::string &hash, std::shared_ptr<jsi::Function> function) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_maxSize == 0) {
+      trim();
+      return;
+    }
+    auto it = _lookup.find(hash);
+    if (it != _lookup.end()) {
+      it->second->second = std::move(function);
+      _entries.splice(_entries.begin(), _entries, it->second);
+    } else {
+      _entries.emplace_front(hash, std::move(function));
+      _lookup.emplace(hash, _entries.begin());
+    }
+    trim();
+  }
+
+  /**
+   Returns the max number of functions in the cache
+   */
+  size_t getMaxSize() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _maxSize;
+  }
+
+  /**
+   Sets the max number of functions in the cache. Zero disables the cache.
+   */
+  void setMaxSize(size_t maxSize) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _maxSize = maxSize;
+  }
+
+  /**
+   Returns the number of functions in the cache
+   */
+  size_t size() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+  }
+
+private:
+  void trim() {
+    while (_entries.size() > _maxSize) {
+      _lookup.erase(_entries.back().first);
+      _entries.pop_back();
+    }
+  }
+
+  typedef std::list<std::pair<std::string, std::shared_ptr<jsi::Function>>>
+      entries_t;
+
+  std::mutex _mutex;
+  size_t _maxSize;
+  entries_t _entries;
+  std::unordered_map<std::string, entries_t::iterator> _lookup;
+};
+} // namespace RNWorklet
@@ -3,6 +3,8 @@
 #include "WKTJsiWorkletApi.h"
 
 #include "WKTArgumentsWrapper.h"
+#include "WKTCancellationToken.h"
+#include "WKTDispatchPool.h"
 #include "WKTDispatchQueue.h"
 #include "WKTJsRuntimeFactory.h"
 #include "WKTJsiHostObject.h"
@@ -12,7 +14,10 @@
 #include "WKTJsiJsDecorator.h"
 #include "WKTJsiPerformanceDecorator.h"
 #include "WKTJsiSetImmediateDecorator.h"
+#include "WKTJsiTimerDecorator.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -23,6 +28,7 @@
 
 #include <jsi/jsi.h>
 
+#ifdef ANDROID
 #include <fbjni/fbjni.h>
 #endif
 
@@ -32,15 +38,32 @@ const char *WorkletRuntimeFlag = "__rn_worklets_runtime_flag";
 const char *GlobalPropertyName = "global";
 
 std::shared_ptr<JsiWorkletContext> JsiWorkletContext::defaultInstance;
+std::shared_ptr<JsiWorkletContext> JsiWorkletContext::parallelInstance;
+std::mutex JsiWorkletContext::parallelInstanceMutex;
 std::map<void *, JsiWorkletContext *> JsiWorkletContext::runtimeMappings;
-size_t JsiWorkletContext::contextIdNumber = 1000;
+std::mutex JsiWorkletContext::runtimeMappingsMutex;
+std::mutex JsiWorkletContext::waitForMutex;
+std::multimap<JsiWorkletContext *, JsiWorkletContext *>
+    JsiWorkletContext::waitForGraph;
+std::atomic<size_t> JsiWorkletContext::contextIdNumber{1000};
 
 namespace jsi = facebook::jsi;
 
-JsiWorkletContext::JsiWorkletContext(const std::string &name) {
+JsiWorkletContext::JsiWorkletContext(
+    const std::string &name, const DispatchThreadOptions &threadOptions) {
+  // Initialize context
+  initialize(name, JsiWorkletContext::getDefaultInstance()->_jsRuntime,
+             JsiWorkletContext::getDefaultInstance()->_jsCallInvoker,
+             threadOptions);
+}
+
+JsiWorkletContext::JsiWorkletContext(
+    const std::string &name, size_t poolSize,
+    const DispatchThreadOptions &threadOptions) {
   // Initialize context
   initialize(name, JsiWorkletContext::getDefaultInstance()->_jsRuntime,
-             JsiWorkletContext::getDefaultInstance()->_jsCallInvoker);
+             JsiWorkletContext::getDefaultInstance()->_jsCallInvoker, poolSize,
+             threadOptions);
 }
 
 JsiWorkletContext::JsiWorkletContext(
@@ -62,60 +85,250 @@ JsiWorkletContext::JsiWorkletContext(
 
 JsiWorkletContext::~JsiWorkletContext() {
   // Remove from thread contexts
-  runtimeMappings.erase(&_workletRuntime);
+  std::lock_guard<std::mutex> lock(runtimeMappingsMutex);
+  for (auto &workletRuntime : _workletRuntimes) {
+    if (workletRuntime) {
+      runtimeMappings.erase(workletRuntime.get());
+      // Cached names and proxies must be released before the runtime is
+      // destroyed
+      JsiPropNameCache::clear(*workletRuntime);
+      JsiProxyCache::clear(*workletRuntime);
+    }
+  }
 }
 
 void JsiWorkletContext::initialize(
     const std::string &name, jsi::Runtime *jsRuntime,
     std::function<void(std::function<void()> &&)> jsCallInvoker,
     std::function<void(std::function<void()> &&)> workletCallInvoker) {
-  _name = name;
+  {
+    std::lock_guard<std::mutex> lock(_nameMutex);
+    _name = name;
+  }
   _jsRuntime = jsRuntime;
   _jsCallInvoker = jsCallInvoker;
   _workletCallInvoker = workletCallInvoker;
-  _contextId = ++contextIdNumber;
+  _memoryCounter = JsiMemoryStats::getContextCounter(_contextId, name);
 
   _jsThreadId = std::this_thread::get_id();
-  runtimeMappings.emplace(&getWorkletRuntime(), this);
+
+  // One worklet runtime per thread in the pool. The runtimes are created on
+  // their own threads, either by warmUp or on first use.
+  auto runtimeCount = _dispatchPool ? _dispatchPool->getSize() : 1;
+  _workletRuntimes.resize(runtimeCount);
+  _workletRuntimePointers =
+      std::vector<std::atomic<jsi::Runtime *>>(runtimeCount);
+  _pendingDecorators.resize(runtimeCount);
+  _appliedDecoratorGenerations =
+      std::vector<std::atomic<size_t>>(runtimeCount);
+
+  // One cache of evaluated worklets per worklet runtime
+  _workletCaches.resize(_workletRuntimes.size());
+  for (auto &cache : _workletCaches) {
+    if (!cache) {
+      cache = std::make_shared<JsiWorkletCache>(_workletCacheSize);
+    }
+  }
+
+  // Timers are per runtime as well, since their callbacks live in it
+  _workletTimers.resize(_workletRuntimes.size());
+  for (auto &timers : _workletTimers) {
+    if (!timers) {
+      timers = std::make_shared<JsiWorkletTimers>();
+    }
+  }
 
   // Add default decorators
   addDecorator(std::make_shared<JsiSetImmediateDecorator>());
   addDecorator(std::make_shared<JsiPerformanceDecorator>());
   addDecorator(std::make_shared<JsiConsoleDecorator>());
+  addDecorator(std::make_shared<JsiTimerDecorator>());
+  addDecorator(std::make_shared<JsiAnimationFrameDecorator>());
+
+  // Contexts being constructed are warmed up by their creator, since we
+  // can't hand out references to ourselves yet.
+  if (!weak_from_this().expired()) {
+    warmUp();
+  }
+}
+
+void JsiWorkletContext::setName(const std::string &name) {
+  {
+    std::lock_guard<std::mutex> lock(_nameMutex);
+    _name = name;
+  }
+  JsiMemoryStats::setContextName(_contextId, name);
+
+  // Threads with a name given in the thread options keep it
+  if (!_threadOptions.name.empty()) {
+    return;
+  }
+  // Each thread renames itself, not all platforms can rename other threads
+  if (_dispatchPool) {
+    auto poolName = getThreadName(name, "dispatch_pool");
+    for (size_t i = 0; i < _dispatchPool->getSize(); i++) {
+      auto threadName = poolName + "_" + std::to_string(i);
+      _dispatchPool->dispatch(i, [threadName]() {
+        DispatchThread::setCurrentThreadName(threadName);
+      });
+    }
+  } else if (_dispatchQueue) {
+    auto threadName = getThreadName(name, "dispatch_queue");
+    _dispatchQueue->dispatch(
+        [threadName]() { DispatchThread::setCurrentThreadName(threadName); },
+        DispatchPriority::High);
+  }
+  std::shared_ptr<DispatchTimer> dispatchTimer;
+  {
+    std::lock_guard<std::mutex> lock(_dispatchTimerMutex);
+    dispatchTimer = _dispatchTimer;
+  }
+  if (dispatchTimer) {
+    auto threadName = getThreadName(name, "timer");
+    dispatchTimer->dispatchAt(DispatchTimer::Clock::now(), [threadName]() {
+      DispatchThread::setCurrentThreadName(threadName);
+    });
+  }
+}
+
+std::shared_ptr<JsiWorkletContext> JsiWorkletContext::getParallelInstance() {
+  std::lock_guard<std::mutex> lock(parallelInstanceMutex);
+  if (parallelInstance == nullptr) {
+    auto poolSize =
+        std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                 static_cast<size_t>(2));
+    parallelInstance =
+        std::make_shared<JsiWorkletContext>("parallel", poolSize);
+    parallelInstance->warmUp();
+  }
+  return parallelInstance;
+}
+
+void JsiWorkletContext::warmUp() {
+  for (size_t i = 0; i < _workletRuntimes.size(); i++) {
+    auto warmUpRuntime = [i, weakSelf = weak_from_this()]() {
+      auto self = weakSelf.lock();
+      if (self) {
+        self->getWorkletRuntime(i);
+      }
+    };
+    if (_dispatchPool) {
+      _dispatchPool->dispatch(i, std::move(warmUpRuntime));
+    } else {
+      _workletCallInvoker(std::move(warmUpRuntime));
+    }
+  }
 }
 
 void JsiWorkletContext::initialize(
     const std::string &name, jsi::Runtime *jsRuntime,
-    std::function<void(std::function<void()> &&)> jsCallInvoker) {
-  // Create queue
-  auto dispatchQueue = std::make_shared<DispatchQueue>(
-      name + "_worklet_dispatch_queue_" + std::to_string(_contextId));
+    std::function<void(std::function<void()> &&)> jsCallInvoker,
+    const DispatchThreadOptions &threadOptions) {
+  _threadOptions = threadOptions;
+
+  // Create queue - worklet threads see lots of small tasks (setImmediate
+  // chains, listener notifications) so we use the lock-free queue here.
+  _dispatchQueue = std::make_shared<DispatchQueue>(
+      getThreadName(name, "dispatch_queue"),
+      DispatchQueueMode::LockFree, threadOptions);
 
   // Initialize invoker
-  initialize(
-      name, jsRuntime, jsCallInvoker,
-      [dispatchQueue = std::move(dispatchQueue)](std::function<void()> &&f) {
-        dispatchQueue->dispatch(std::move(f));
-      });
+  initialize(name, jsRuntime, jsCallInvoker,
+             [dispatchQueue = _dispatchQueue](std::function<void()> &&f) {
+               dispatchQueue->dispatch(std::move(f));
+             });
+}
+
+void JsiWorkletContext::initialize(
+    const std::string &name, jsi::Runtime *jsRuntime,
+    std::function<void(std::function<void()> &&)> jsCallInvoker,
+    size_t poolSize, const DispatchThreadOptions &threadOptions) {
+  if (poolSize <= 1) {
+    initialize(name, jsRuntime, jsCallInvoker, threadOptions);
+    return;
+  }
+
+  _threadOptions = threadOptions;
+
+  // Create pool
+  _dispatchPool = std::make_shared<DispatchPool>(
+      getThreadName(name, "dispatch_pool"),
+      poolSize, threadOptions);
+
+  // Initialize invoker - work dispatched through the invoker can be picked up
+  // by any of the threads in the pool.
+  initialize(name, jsRuntime, jsCallInvoker,
+             [dispatchPool = _dispatchPool](std::function<void()> &&f) {
+               dispatchPool->dispatch(std::move(f));
+             });
 }
 
 jsi::Runtime &JsiWorkletContext::getWorkletRuntime() {
-  if (!_workletRuntime) {
+  if (_dispatchPool) {
+    auto index = _dispatchPool->getCurrentWorkerIndex();
+    if (index >= 0) {
+      return getWorkletRuntime(static_cast<size_t>(index));
+    }
+  }
+  return getWorkletRuntime(0);
+}
+
+jsi::Runtime &JsiWorkletContext::getWorkletRuntime(size_t index) {
+  auto &workletRuntime = _workletRuntimes.at(index);
+  if (!workletRuntime) {
     // Lazy initialization of the worklet runtime
-    _workletRuntime = makeJSIRuntime();
-    _workletRuntime->global().setProperty(*_workletRuntime, WorkletRuntimeFlag,
-                                          true);
+    workletRuntime = makeJSIRuntime();
+    workletRuntime->global().setProperty(*workletRuntime, WorkletRuntimeFlag,
+                                         true);
 
     // Copy global which is expected to be found instead of the globalThis
     // object.
-    _workletRuntime->global().setProperty(*_workletRuntime, GlobalPropertyName,
-                                          _workletRuntime->global());
+    workletRuntime->global().setProperty(*workletRuntime, GlobalPropertyName,
+                                         workletRuntime->global());
+
+    {
+      std::lock_guard<std::mutex> lock(runtimeMappingsMutex);
+      runtimeMappings.emplace(workletRuntime.get(), this);
+    }
+    _workletRuntimePointers[index].store(workletRuntime.get(),
+                                         std::memory_order_release);
 
     // Install the WorkletAPI into the new runtime
-    JsiWorkletApi::installApi(*_workletRuntime);
+    JsiWorkletApi::installApi(*workletRuntime);
+  }
+
+  // Apply decorators added since the last call on this runtime
+  if (_appliedDecoratorGenerations[index].load(std::memory_order_relaxed) !=
+      _decoratorGeneration.load(std::memory_order_acquire)) {
+    applyPendingDecorators(index);
+  }
+
+  return *workletRuntime;
+}
+
+void JsiWorkletContext::applyPendingDecorators(size_t index) {
+  std::vector<std::shared_ptr<JsiBaseDecorator>> decorators;
+  {
+    std::lock_guard<std::mutex> lock(_decoratorsMutex);
+    decorators.swap(_pendingDecorators.at(index));
+    _appliedDecoratorGenerations[index].store(
+        _decoratorGeneration.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
   }
+  for (auto &decorator : decorators) {
+    decorator->decorateRuntime(*_workletRuntimes.at(index));
+  }
+}
 
-  return *_workletRuntime;
+size_t JsiWorkletContext::getWorkletRuntimeIndex(jsi::Runtime &runtime) {
+  for (size_t i = 0; i < _workletRuntimePointers.size(); i++) {
+    if (_workletRuntimePointers[i].load(std::memory_order_acquire) ==
+        &runtime) {
+      return i;
+    }
+  }
+  throw std::runtime_error("Runtime is not a worklet runtime in the context " +
+                           getName() + ".");
 }
 
 void JsiWorkletContext::invokeOnJsThread(
@@ -135,50 +348,116 @@ void JsiWorkletContext::invokeOnJsThread(
 
 void JsiWorkletContext::invokeOnWorkletThread(
     std::function<void(JsiWorkletContext *context, jsi::Runtime &runtime)>
-        &&fp) {
+        &&fp,
+    DispatchPriority priority) {
   if (_workletCallInvoker == nullptr) {
     throw std::runtime_error(
         "Expected Worklet context to have a worklet call invoker.");
   }
-  _workletCallInvoker([fp = std::move(fp), weakSelf = weak_from_this()]() {
+  auto op = [fp = std::move(fp), weakSelf = weak_from_this()]() {
     auto self = weakSelf.lock();
     if (self) {
+      JsiMemoryStats::Scope memoryScope(self->_memoryCounter);
       fp(self.get(), self->getWorkletRuntime());
     }
-  });
+  };
+  // Contexts with a custom invoker run everything in the invoker's order
+  if (_dispatchPool) {
+    _dispatchPool->dispatch(std::move(op), priority);
+  } else if (_dispatchQueue) {
+    _dispatchQueue->dispatch(std::move(op), priority);
+  } else {
+    _workletCallInvoker(std::move(op));
+  }
+}
+
+std::shared_ptr<JsiWorkletCache>
+JsiWorkletContext::getWorkletCache(jsi::Runtime &runtime) {
+  for (size_t i = 0; i < _workletRuntimePointers.size(); i++) {
+    if (_workletRuntimePointers[i].load(std::memory_order_acquire) ==
+        &runtime) {
+      return _workletCaches.at(i);
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<JsiWorkletTimers>
+JsiWorkletContext::getWorkletTimers(jsi::Runtime &runtime) {
+  for (size_t i = 0; i < _workletRuntimePointers.size(); i++) {
+    if (_workletRuntimePointers[i].load(std::memory_order_acquire) ==
+        &runtime) {
+      return _workletTimers.at(i);
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<DispatchTimer> JsiWorkletContext::getDispatchTimer() {
+  std::lock_guard<std::mutex> lock(_dispatchTimerMutex);
+  if (_dispatchTimer == nullptr) {
+    // Scheduled like the context's own threads, but the timer thread runs
+    // no JS and makes do with the default stack
+    auto threadOptions = _threadOptions;
+    threadOptions.name.clear();
+    threadOptions.stackSize = 0;
+    _dispatchTimer = std::make_shared<DispatchTimer>(
+        getThreadName(getName(), "timer"), threadOptions);
+  }
+  return _dispatchTimer;
+}
+
+void JsiWorkletContext::setWorkletCacheSize(size_t size) {
+  _workletCacheSize = size;
+  for (auto &cache : _workletCaches) {
+    cache->setMaxSize(size);
+  }
+}
+
+void JsiWorkletContext::invokeOnWorkletRuntime(
+    jsi::Runtime &runtime,
+    std::function<void(JsiWorkletContext *context, jsi::Runtime &runtime)>
+        &&fp) {
+  if (!_dispatchPool) {
+    invokeOnWorkletThread(std::move(fp));
+    return;
+  }
+  auto index = getWorkletRuntimeIndex(runtime);
+  _dispatchPool->dispatch(
+      index, [fp = std::move(fp), index, weakSelf = weak_from_this()]() {
+        auto self = weakSelf.lock();
+        if (self) {
+          JsiMemoryStats::Scope memoryScope(self->_memoryCounter);
+          fp(self.get(), self->getWorkletRuntime(index));
+        }
+      });
 }
 
 void JsiWorkletContext::addDecorator(
     std::shared_ptr<JsiBaseDecorator> decorator) {
-  std::mutex mu;
-  std::condition_variable cond;
-  bool isFinished = false;
-  std::unique_lock<std::mutex> lock(mu);
-
   decorator->initialize(*getJsRuntime());
 
-  // Execute decoration in context' worklet thread/runtime
-  _workletCallInvoker([&]() {
-    std::lock_guard<std::mutex> lock(mu);
-    decorator->decorateRuntime(getWorkletRuntime());
-    isFinished = true;
-    cond.notify_one();
-  });
-
-  // Wait untill the blocking code as finished
-  cond.wait(lock, [&]() { return isFinished; });
+  // Decorators are applied in a batch on each worklet runtime's own thread
+  // before it runs its next piece of work, so there is no need to block here.
+  std::lock_guard<std::mutex> lock(_decoratorsMutex);
+  for (auto &pending : _pendingDecorators) {
+    pending.push_back(decorator);
+  }
+  _decoratorGeneration.fetch_add(1, std::memory_order_release);
 }
 
 jsi::HostFunctionType
 JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
-                                       const jsi::Value &maybeFunc) {
-  return createCallInContext(runtime, maybeFunc, this);
+                                       const jsi::Value &maybeFunc,
+                                       const CallOptions &options) {
+  return createCallInContext(runtime, maybeFunc, this, options);
 }
 
 jsi::HostFunctionType
 JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
                                        const jsi::Value &maybeFunc,
-                                       JsiWorkletContext *ctx) {
+                                       JsiWorkletContext *ctx,
+                                       const CallOptions &options) {
 
   // Ensure that we are passing a function as the param.
   if (!maybeFunc.isObject() ||
@@ -201,83 +480,35 @@ JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
           : nullptr;
 
   // Now return the caller function as a hostfunction type.
-  return [workletInvoker, func,
-          ctx](jsi::Runtime &runtime, const jsi::Value &thisValue,
-               const jsi::Value *arguments, size_t count) -> jsi::Value {
+  return [workletInvoker, func, ctx,
+          options](jsi::Runtime &runtime, const jsi::Value &thisValue,
+                   const jsi::Value *arguments, size_t count) -> jsi::Value {
     auto callingCtx = getCurrent(runtime);
     auto convention = getCallingConvention(callingCtx, ctx);
+    auto transferMode = options.transferMode;
 
-    // Start by wrapping the arguments
-    ArgumentsWrapper argsWrapper(runtime, arguments, count);
-
-    // Wrap the this value
-    auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
+    // Calls into the JS context are traced in the default context
+    auto targetCtx = ctx != nullptr ? ctx : getDefaultInstance().get();
+    auto trace = JsiCallTrace::start(targetCtx->getLatencyHistograms(),
+                                     targetCtx->getContextId());
 
     // If we are calling directly from/to the JS context or within the same
-    // context, we can just dispatch everything directly.
+    // context the values never leave the runtime - pass them straight through
+    // without wrapping and return a native promise (or the raw value).
     if (convention == CallingConvention::JsToJs ||
         convention == CallingConvention::WithinCtx) {
+      return callInRuntime(runtime, workletInvoker, func, thisValue, arguments,
+                           count, options, trace);
+    }
 
-      // Create promise
-      auto promise = JsiPromiseWrapper::createPromiseWrapper(
-          runtime,
-          [ctx, convention, workletInvoker, callingCtx, thisWrapper,
-           argsWrapper, func](jsi::Runtime &runtime,
-                              std::shared_ptr<PromiseParameter> promise) {
-            auto unwrappedThis = thisWrapper->unwrap(runtime);
-            auto args = argsWrapper.getArguments(runtime);
+    // Start by wrapping the arguments
+    ArgumentsWrapper argsWrapper(runtime, arguments, count, transferMode);
 
-            // We can resolve the result directly - we're in the same context.
-            try {
-              if (workletInvoker) {
-                auto retVal = workletInvoker->call(
-                    runtime, unwrappedThis, ArgumentsWrapper::toArgs(args),
-                    argsWrapper.getCount());
-                promise->resolve(runtime, retVal);
-              } else {
-                if (unwrappedThis.isObject()) {
-                  auto retVal = func->callWithThis(
-                      runtime, unwrappedThis.asObject(runtime),
-                      ArgumentsWrapper::toArgs(args), argsWrapper.getCount());
-                  promise->resolve(runtime, retVal);
-                } else {
-                  auto retVal =
-                      func->call(runtime, ArgumentsWrapper::toArgs(args),
-                                 argsWrapper.getCount());
-                  promise->resolve(runtime, retVal);
-                }
-              }
-            } catch (const jsi::JSError &err) {
-              // TODO: Handle Stack!!
-              promise->reject(runtime, jsi::String::createFromUtf8(
-                                           runtime, err.getMessage()));
-            } catch (const std::exception &err) {
-              std::string a = typeid(err).name();
-              std::string b = typeid(jsi::JSError).name();
-              if (a == b) {
-                const auto *jsError = static_cast<const jsi::JSError *>(&err);
-                auto message = jsError->getMessage();
-                // auto stack = jsError->getStack();
-                // TODO: JsErrorWrapper reason(message, stack);
-                promise->reject(runtime,
-                                jsi::String::createFromUtf8(runtime, message));
-              } else {
-                // TODO: JsErrorWrapper reason("Unknown error in promise",
-                // "[Uknown stack]");
-                promise->reject(runtime,
-                                jsi::String::createFromUtf8(
-                                    runtime, "Unknown error in promise"));
-              }
-            } catch (...) {
-              // TODO: JsErrorWrapper reason("Unknown error in promise",
-              // "[Uknown stack]");
-              promise->reject(runtime,
-                              jsi::String::createFromUtf8(
-                                  runtime, "Unknown error in promise"));
-            }
-          });
+    // Wrap the this value
+    auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
 
-      return jsi::Object::createFromHostObject(runtime, promise);
+    if (trace) {
+      trace->mark(TraceStage::ArgumentWrap);
     }
 
     // Now we are in a situation where we are calling cross context (js -> ctx,
@@ -291,18 +522,31 @@ JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
                                   "from/to JS from/to a context.");
     }
 
+    // Queued calls whose promise is cancelled are skipped, running calls can
+    // check the token through Worklets.isCancelled
+    auto cancellationToken = std::make_shared<CancellationToken>();
+    auto priority = options.priority;
+
     auto callIntoCorrectContext =
-        [&runtime, convention,
-         ctx](std::function<void(jsi::Runtime & runtime)> &&func) {
+        [&runtime, convention, ctx, cancellationToken,
+         priority](std::function<void(jsi::Runtime & runtime)> &&func) {
+          auto run = [func, cancellationToken](jsi::Runtime &rt) {
+            if (cancellationToken->isCancelled()) {
+              return;
+            }
+            CancellationToken::Scope scope(cancellationToken.get());
+            func(rt);
+          };
           switch (convention) {
           case CallingConvention::JsToCtx:
           case CallingConvention::CtxToCtx:
             ctx->invokeOnWorkletThread(
-                [func](JsiWorkletContext *, jsi::Runtime &rt) { func(rt); });
+                [run](JsiWorkletContext *, jsi::Runtime &rt) { run(rt); },
+                priority);
             break;
           case CallingConvention::CtxToJs:
             JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
-                [func](jsi::Runtime &rt) { func(rt); });
+                [run](jsi::Runtime &rt) { run(rt); });
             break;
           default:
             // Not used since the two last ones are only handling
@@ -319,41 +563,58 @@ JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
         JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
             [func](jsi::Runtime &rt) { func(rt); });
       } else {
-        callingCtx->invokeOnWorkletThread(
+        callingCtx->invokeOnWorkletRuntime(
+            runtime,
             [func](JsiWorkletContext *, jsi::Runtime &rt) { func(rt); });
       }
     };
 
     // Let's create a promise that can initialize and resolve / reject in the
     // correct contexts
-    auto promise = JsiPromiseWrapper::createPromiseWrapper(
-        runtime, [ctx, workletInvoker, convention, callingCtx, thisWrapper,
-                  argsWrapper, callIntoCorrectContext, callback,
-                  func](jsi::Runtime &runtime,
-                        std::shared_ptr<PromiseParameter> promise) {
+    PromiseComputationFunction computation =
+        [ctx, workletInvoker, convention, callingCtx, thisWrapper, argsWrapper,
+         callIntoCorrectContext, callback, func, transferMode,
+         trace](jsi::Runtime &runtime,
+                std::shared_ptr<PromiseParameter> promise) {
+          if (trace) {
+            trace->restart();
+          }
           // Create callback wrapper
           callIntoCorrectContext([callback, workletInvoker, thisWrapper,
-                                  argsWrapper, promise,
-                                  func](jsi::Runtime &runtime) {
+                                  argsWrapper, promise, func, transferMode,
+                                  trace](jsi::Runtime &runtime) {
+            if (trace) {
+              trace->mark(TraceStage::QueueWait);
+            }
             try {
 
               auto args = argsWrapper.getArguments(runtime);
 
               jsi::Value result;
-              if (workletInvoker != nullptr) {
-                result = workletInvoker->call(
-                    runtime, thisWrapper->unwrap(runtime),
-                    ArgumentsWrapper::toArgs(args), argsWrapper.getCount());
-              } else {
-                result = func->call(runtime, ArgumentsWrapper::toArgs(args),
-                                    argsWrapper.getCount());
+              {
+                JsiTraceSection section("worklet:execute");
+                if (workletInvoker != nullptr) {
+                  result = workletInvoker->call(
+                      runtime, thisWrapper->unwrap(runtime),
+                      ArgumentsWrapper::toArgs(args), argsWrapper.getCount());
+                } else {
+                  result = func->call(runtime, ArgumentsWrapper::toArgs(args),
+                                      argsWrapper.getCount());
+                }
+              }
+              if (trace) {
+                trace->mark(TraceStage::Execution);
               }
 
-              auto retVal = JsiWrapper::wrap(runtime, result);
+              // Pass the result the same way as the arguments
+              ArgumentsWrapper retVal(runtime, &result, 1, transferMode);
 
               // Callback with the results
-              callback([retVal, promise](jsi::Runtime &runtime) {
-                promise->resolve(runtime, retVal->unwrap(runtime));
+              callback([retVal, promise, trace](jsi::Runtime &runtime) {
+                promise->resolve(runtime, retVal.getArguments(runtime).at(0));
+                if (trace) {
+                  trace->finish(TraceStage::ResultResolve);
+                }
               });
             } catch (const jsi::JSError &err) {
               auto message = err.getMessage();
@@ -391,12 +652,259 @@ JsiWorkletContext::createCallInContext(jsi::Runtime &runtime,
               });
             }
           });
-        });
+        };
+
+    // Native promises stay in the calling runtime and are not cancellable
+    if (options.nativePromise) {
+      return JsiNativePromise::createPromise(runtime, computation);
+    }
 
+    auto promise = JsiPromiseWrapper::createPromiseWrapper(runtime, computation);
+    promise->setCancellationToken(cancellationToken);
     return jsi::Object::createFromHostObject(runtime, promise);
   };
 }
 
+jsi::Value JsiWorkletContext::callInRuntime(
+    jsi::Runtime &runtime, std::shared_ptr<WorkletInvoker> workletInvoker,
+    std::shared_ptr<jsi::Function> func, const jsi::Value &thisValue,
+    const jsi::Value *arguments, size_t count, const CallOptions &options,
+    std::shared_ptr<JsiCallTrace> trace) {
+  jsi::Value result;
+  std::string error;
+  try {
+    JsiTraceSection section("worklet:execute");
+    if (workletInvoker) {
+      result = workletInvoker->call(runtime, thisValue, arguments, count);
+    } else if (thisValue.isObject()) {
+      result = func->callWithThis(runtime, thisValue.asObject(runtime),
+                                  arguments, count);
+    } else {
+      result = func->call(runtime, arguments, count);
+    }
+  } catch (const jsi::JSError &err) {
+    if (options.rawResult) {
+      throw;
+    }
+    error = err.getMessage();
+  } catch (const std::exception &err) {
+    if (options.rawResult) {
+      throw;
+    }
+    error = err.what();
+  } catch (...) {
+    if (options.rawResult) {
+      throw;
+    }
+    error = "Unknown error in promise";
+  }
+
+  if (trace) {
+    trace->mark(TraceStage::Execution);
+  }
+
+  if (options.rawResult) {
+    if (trace) {
+      trace->finish(TraceStage::ResultResolve);
+    }
+    return result;
+  }
+
+  // Settle a native promise, same as JsiPromiseWrapper we reject with the
+  // error message.
+  auto promiseCtor = runtime.global().getPropertyAsObject(runtime, "Promise");
+  jsi::Value promise;
+  if (error.empty()) {
+    promise = promiseCtor.getPropertyAsFunction(runtime, "resolve")
+                  .callWithThis(runtime, promiseCtor, result);
+  } else {
+    promise = promiseCtor.getPropertyAsFunction(runtime, "reject")
+                  .callWithThis(runtime, promiseCtor,
+                                jsi::String::createFromUtf8(runtime, error));
+  }
+
+  if (trace) {
+    trace->finish(TraceStage::ResultResolve);
+  }
+  return promise;
+}
+
+bool JsiWorkletContext::addWaitFor(JsiWorkletContext *from,
+                                   JsiWorkletContext *to) {
+  std::lock_guard<std::mutex> lock(waitForMutex);
+
+  // Walk everything the target is waiting on, a path back to the caller
+  // means that the call can never complete.
+  std::vector<JsiWorkletContext *> pending = {to};
+  std::vector<JsiWorkletContext *> visited;
+  while (!pending.empty()) {
+    auto current = pending.back();
+    pending.pop_back();
+    if (current == from) {
+      return false;
+    }
+    if (std::find(visited.begin(), visited.end(), current) != visited.end()) {
+      continue;
+    }
+    visited.push_back(current);
+    auto range = waitForGraph.equal_range(current);
+    for (auto it = range.first; it != range.second; it++) {
+      pending.push_back(it->second);
+    }
+  }
+
+  waitForGraph.emplace(from, to);
+  return true;
+}
+
+void JsiWorkletContext::removeWaitFor(JsiWorkletContext *from,
+                                      JsiWorkletContext *to) {
+  std::lock_guard<std::mutex> lock(waitForMutex);
+  auto range = waitForGraph.equal_range(from);
+  for (auto it = range.first; it != range.second; it++) {
+    if (it->second == to) {
+      waitForGraph.erase(it);
+      return;
+    }
+  }
+}
+
+jsi::HostFunctionType
+JsiWorkletContext::createCallInContextSync(jsi::Runtime &runtime,
+                                           const jsi::Value &maybeFunc,
+                                           JsiWorkletContext *ctx,
+                                           const CallOptions &options) {
+  // Ensure that we are passing a function as the param.
+  if (!maybeFunc.isObject() ||
+      !maybeFunc.asObject(runtime).isFunction(runtime)) {
+    throw jsi::JSError(
+        runtime,
+        "Parameter to callInContextSync is not a valid Javascript function.");
+  }
+
+  auto func = std::make_shared<jsi::Function>(
+      maybeFunc.asObject(runtime).asFunction(runtime));
+
+  auto workletInvoker =
+      JsiWorklet::isDecoratedAsWorklet(runtime, func)
+          ? std::make_shared<WorkletInvoker>(runtime, maybeFunc)
+          : nullptr;
+
+  return [workletInvoker, func, ctx,
+          options](jsi::Runtime &runtime, const jsi::Value &thisValue,
+                   const jsi::Value *arguments, size_t count) -> jsi::Value {
+    auto callingCtx = getCurrent(runtime);
+    auto convention = getCallingConvention(callingCtx, ctx);
+
+    // Within the same runtime there is nothing to wait for - call inline.
+    if (convention == CallingConvention::JsToJs ||
+        convention == CallingConvention::WithinCtx) {
+      if (workletInvoker) {
+        return workletInvoker->call(runtime, thisValue, arguments, count);
+      }
+      if (thisValue.isObject()) {
+        return func->callWithThis(runtime, thisValue.asObject(runtime),
+                                  arguments, count);
+      }
+      return func->call(runtime, arguments, count);
+    }
+
+    if (workletInvoker == nullptr && convention != CallingConvention::CtxToJs) {
+      throw jsi::JSError(runtime, "In callInContextSync the function parameter "
+                                  "is not a valid worklet and "
+                                  "cannot be called between contexts or "
+                                  "from/to JS from/to a context.");
+    }
+
+    // State shared with the target thread. The call can outlive the wait if
+    // it times out, so nothing here refers to the calling stack.
+    struct SyncCallState {
+      std::mutex mu;
+      std::condition_variable cond;
+      bool done = false;
+      std::shared_ptr<ArgumentsWrapper> result;
+      std::string error;
+    };
+    auto state = std::make_shared<SyncCallState>();
+
+    auto transferMode = options.transferMode;
+    ArgumentsWrapper argsWrapper(runtime, arguments, count, transferMode);
+    auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
+
+    auto work = [state, workletInvoker, func, thisWrapper, argsWrapper,
+                 transferMode](jsi::Runtime &runtime) {
+      std::shared_ptr<ArgumentsWrapper> result;
+      std::string error;
+      try {
+        auto args = argsWrapper.getArguments(runtime);
+        jsi::Value retVal;
+        if (workletInvoker != nullptr) {
+          retVal = workletInvoker->call(
+              runtime, thisWrapper->unwrap(runtime),
+              ArgumentsWrapper::toArgs(args), argsWrapper.getCount());
+        } else {
+          retVal = func->call(runtime, ArgumentsWrapper::toArgs(args),
+                              argsWrapper.getCount());
+        }
+        result = std::make_shared<ArgumentsWrapper>(runtime, &retVal, 1,
+                                                    transferMode);
+      } catch (const jsi::JSError &err) {
+        error = err.getMessage();
+      } catch (const std::exception &err) {
+        error = err.what();
+      } catch (...) {
+        error = "Unknown error in synchronous call.";
+      }
+
+      std::lock_guard<std::mutex> lock(state->mu);
+      state->result = std::move(result);
+      state->error = std::move(error);
+      state->done = true;
+      state->cond.notify_one();
+    };
+
+    if (!addWaitFor(callingCtx, ctx)) {
+      throw jsi::JSError(runtime,
+                         "Deadlock detected in synchronous call: the target "
+                         "context is waiting for the calling context.");
+    }
+
+    // Same blocking pattern as in addDecorator
+    bool completed;
+    {
+      std::unique_lock<std::mutex> lock(state->mu);
+      try {
+        if (convention == CallingConvention::CtxToJs) {
+          getDefaultInstance()->invokeOnJsThread(std::move(work));
+        } else {
+          ctx->invokeOnWorkletThread(
+              [work = std::move(work)](JsiWorkletContext *,
+                                       jsi::Runtime &rt) { work(rt); },
+              options.priority);
+        }
+      } catch (...) {
+        lock.unlock();
+        removeWaitFor(callingCtx, ctx);
+        throw;
+      }
+      completed = state->cond.wait_for(lock, options.timeout,
+                                       [&]() { return state->done; });
+    }
+    removeWaitFor(callingCtx, ctx);
+
+    if (!completed) {
+      throw jsi::JSError(runtime, "Synchronous call timed out after " +
+                                      std::to_string(options.timeout.count()) +
+                                      " ms.");
+    }
+    if (state->result == nullptr) {
+      throw jsi::JSError(runtime, state->error);
+    }
+    auto results = state->result->getArguments(runtime);
+    return std::move(results.at(0));
+  };
+}
+
 jsi::HostFunctionType
 JsiWorkletContext::createInvoker(jsi::Runtime &runtime,
                                  const jsi::Value *maybeFunc) {
@@ -420,8 +928,8 @@ JsiWorkletContext::createInvoker(jsi::Runtime &runtime,
 
     if (ctx != nullptr) {
       // We are on a worklet thread
-      ctx->invokeOnWorkletThread(
-          [argsWrapper, rtPtr, func](JsiWorkletContext *,
+      ctx->invokeOnWorkletRuntime(
+          *rtPtr, [argsWrapper, rtPtr, func](JsiWorkletContext *,
                                      jsi::Runtime &runtime) {
             assert(&runtime == rtPtr && "Expected same runtime ptr!");
             auto args = argsWrapper.getArguments(runtime);
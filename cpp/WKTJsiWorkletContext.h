@@ -1,15 +1,27 @@
 
 #pragma once
 
+#include "WKTArgumentsWrapper.h"
+#include "WKTDispatchPool.h"
 #include "WKTDispatchQueue.h"
+#include "WKTDispatchThread.h"
+#include "WKTDispatchTimer.h"
 #include "WKTJsiBaseDecorator.h"
 #include "WKTJsiHostObject.h"
 #include "WKTJsiJsDecorator.h"
-
+#include "WKTJsiMemoryStats.h"
+#include "WKTJsiPropNameCache.h"
+#include "WKTJsiProxyCache.h"
+#include "WKTJsiWorkletCache.h"
+#include "WKTJsiWorkletTrace.h"
+
+#include <atomic>
+#include <chrono>
 #include <exception>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -19,6 +31,42 @@ namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
 
+class WorkletInvoker;
+class JsiWorkletTimers;
+
+/**
+ Options for functions created with createCallInContext
+ */
+struct CallOptions {
+  /**
+   How arguments and return values are passed between runtimes
+   */
+  TransferMode transferMode = TransferMode::Wrap;
+
+  /**
+   Max time a synchronous call blocks the calling thread
+   */
+  std::chrono::milliseconds timeout = std::chrono::milliseconds(1000);
+
+  /**
+   Calls that stay in the calling runtime return the result directly instead
+   of a promise, and throw instead of rejecting.
+   */
+  bool rawResult = false;
+
+  /**
+   Cross-context calls return an engine-native promise created in the calling
+   runtime instead of a JsiPromiseWrapper. Native promises can not be
+   cancelled or passed to other runtimes without being wrapped.
+   */
+  bool nativePromise = false;
+
+  /**
+   Priority lane the call is queued in, in contexts with their own queue
+   */
+  DispatchPriority priority = DispatchPriority::Normal;
+};
+
 class JsiWorkletContext
     : public JsiHostObject,
       public std::enable_shared_from_this<JsiWorkletContext> {
@@ -36,8 +84,22 @@ public:
    not copied from the default context is the worklet invoker which will be a
    default queue.
    @param name Name of the context
+   @param threadOptions Scheduling options for the context's thread
    */
-  explicit JsiWorkletContext(const std::string &name);
+  explicit JsiWorkletContext(const std::string &name,
+                             const DispatchThreadOptions &threadOptions = {});
+
+  /**
+   Constructs a new pooled worklet context using the same values and
+   configuration as the default context. The context owns one worklet runtime
+   per thread in its pool, and calls into the context are spread over the
+   threads.
+   @param name Name of the context
+   @param poolSize Number of threads / worklet runtimes in the pool
+   @param threadOptions Scheduling options for the pool's threads
+   */
+  JsiWorkletContext(const std::string &name, size_t poolSize,
+                    const DispatchThreadOptions &threadOptions = {});
 
   /**
    Constructs a new worklet context using the same values and configuration as
@@ -87,9 +149,24 @@ public:
    * @param name Name of the context
    * @param jsRuntime Runtime for the main javascript runtime.
    * @param jsCallInvoker Callback for running a function on the JS thread.
+   * @param threadOptions Scheduling options for the context's thread
+   */
+  void initialize(const std::string &name, jsi::Runtime *jsRuntime,
+                  std::function<void(std::function<void()> &&)> jsCallInvoker,
+                  const DispatchThreadOptions &threadOptions = {});
+
+  /**
+   * Initialializes the worklet context with a pool of worklet threads
+   * @param name Name of the context
+   * @param jsRuntime Runtime for the main javascript runtime.
+   * @param jsCallInvoker Callback for running a function on the JS thread.
+   * @param poolSize Number of threads / worklet runtimes in the pool
+   * @param threadOptions Scheduling options for the pool's threads
    */
   void initialize(const std::string &name, jsi::Runtime *jsRuntime,
-                  std::function<void(std::function<void()> &&)> jsCallInvoker);
+                  std::function<void(std::function<void()> &&)> jsCallInvoker,
+                  size_t poolSize,
+                  const DispatchThreadOptions &threadOptions = {});
 
   /**
    Static / singleton default context
@@ -101,14 +178,22 @@ public:
     return defaultInstance;
   }
 
+  /**
+   Shared pooled context with one thread per core, used for parallel work
+   when no context is given. Created on first use.
+   */
+  static std::shared_ptr<JsiWorkletContext> getParallelInstance();
+
   /**
    Returns the worklet context for the current thread. If called from the
    JS thread (or any other invalid context thread) nullptr is returned.
    */
   static JsiWorkletContext *getCurrent(jsi::Runtime &runtime) {
     auto rtPtr = static_cast<void *>(&runtime);
-    if (runtimeMappings.count(rtPtr) != 0) {
-      return runtimeMappings.at(rtPtr);
+    std::lock_guard<std::mutex> lock(runtimeMappingsMutex);
+    auto it = runtimeMappings.find(rtPtr);
+    if (it != runtimeMappings.end()) {
+      return it->second;
     }
     return nullptr;
   }
@@ -116,15 +201,42 @@ public:
   size_t getContextId() { return _contextId; }
 
   /**
-   Adds a global decorator. The decorator will be installed in the default
-   context.
+   Adds a global decorator. The decorator is initialized on the calling (JS)
+   thread and installed in each worklet runtime on its own thread before the
+   runtime runs any work dispatched after this call. Does not block.
    */
   void addDecorator(std::shared_ptr<JsiBaseDecorator> decorator);
 
+  /**
+   Creates and decorates the context's worklet runtimes on their threads in
+   the background, so that the first call into the context does not pay for
+   it. Called from initialize when possible, contexts initialized from their
+   constructor must be warmed up by their creator.
+   */
+  void warmUp();
+
+  /**
+   Renames the context, its memory counter and its threads. Used when
+   handing out pre-warmed contexts, safe to call while the context's threads
+   are running.
+   */
+  void setName(const std::string &name);
+
   /**
    Invalidates the instance
    */
-  static void invalidateDefaultInstance() { defaultInstance = nullptr; }
+  static void invalidateDefaultInstance() {
+    if (defaultInstance != nullptr &&
+        defaultInstance->getJsRuntime() != nullptr) {
+      // The JS runtime might already be torn down, so leak its cached names
+      // and proxies
+      JsiPropNameCache::clear(*defaultInstance->getJsRuntime(), false);
+      JsiProxyCache::clear(*defaultInstance->getJsRuntime(), false);
+    }
+    defaultInstance = nullptr;
+    std::lock_guard<std::mutex> lock(parallelInstanceMutex);
+    parallelInstance = nullptr;
+  }
 
   JSI_HOST_FUNCTION(addDecorator) {
     if (count != 2) {
@@ -148,13 +260,39 @@ public:
     return jsi::Value::undefined();
   }
 
-  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiWorkletContext, addDecorator))
+  JSI_HOST_FUNCTION(resetLatency) {
+    _latencyHistograms->reset();
+    return jsi::Value::undefined();
+  }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiWorkletContext, addDecorator),
+                       JSI_EXPORT_FUNC(JsiWorkletContext, resetLatency))
 
   JSI_PROPERTY_GET(name) {
     return jsi::String::createFromUtf8(runtime, getName());
   }
 
-  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiWorkletContext, name))
+  JSI_PROPERTY_GET(workletCacheSize) {
+    return static_cast<double>(getWorkletCacheSize());
+  }
+
+  JSI_PROPERTY_SET(workletCacheSize) {
+    if (!value.isNumber() || value.asNumber() < 0) {
+      throw jsi::JSError(runtime,
+                         "workletCacheSize expects a non-negative number.");
+    }
+    setWorkletCacheSize(static_cast<size_t>(value.asNumber()));
+  }
+
+  JSI_PROPERTY_GET(latency) { return _latencyHistograms->toJsi(runtime); }
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiWorkletContext, name),
+                              JSI_EXPORT_PROP_GET(JsiWorkletContext,
+                                                  workletCacheSize),
+                              JSI_EXPORT_PROP_GET(JsiWorkletContext, latency))
+
+  JSI_EXPORT_PROPERTY_SETTERS(JSI_EXPORT_PROP_SET(JsiWorkletContext,
+                                                  workletCacheSize))
 
   /**
    Returns the main javascript runtime
@@ -164,23 +302,84 @@ public:
   /**
    Returns the name of the context
    */
-  const std::string &getName() { return _name; }
+  std::string getName() {
+    std::lock_guard<std::mutex> lock(_nameMutex);
+    return _name;
+  }
 
   /**
-   Returns the worklet runtime. Lazy evaluated
+   Returns the worklet runtime. Lazy evaluated. For pooled contexts this is the
+   runtime owned by the calling worker thread.
    */
   jsi::Runtime &getWorkletRuntime();
 
+  /**
+   Returns the number of worklet threads / runtimes in the context
+   */
+  size_t getPoolSize() { return _workletRuntimes.size(); }
+
+  /**
+   Returns the cache of evaluated worklet functions for the given worklet
+   runtime, or nullptr if the runtime is not one of the context's worklet
+   runtimes.
+   */
+  std::shared_ptr<JsiWorkletCache> getWorkletCache(jsi::Runtime &runtime);
+
+  /**
+   Returns the timers of the given worklet runtime, or nullptr if the runtime
+   is not one of the context's worklet runtimes.
+   */
+  std::shared_ptr<JsiWorkletTimers> getWorkletTimers(jsi::Runtime &runtime);
+
+  /**
+   Returns the timer thread driving the context's timers, started on first
+   use
+   */
+  std::shared_ptr<DispatchTimer> getDispatchTimer();
+
+  /**
+   Returns the max number of evaluated worklets cached per worklet runtime
+   */
+  size_t getWorkletCacheSize() { return _workletCacheSize; }
+
+  /**
+   Sets the max number of evaluated worklets cached per worklet runtime. Zero
+   disables the cache.
+   */
+  void setWorkletCacheSize(size_t size);
+
+  /**
+   Returns the latency histograms for calls into the context. Only recorded
+   while tracing is enabled, see JsiWorkletTrace.
+   */
+  std::shared_ptr<JsiLatencyHistograms> getLatencyHistograms() {
+    return _latencyHistograms;
+  }
+
   /**
    Executes a function in the JS thread
    */
   void invokeOnJsThread(std::function<void(jsi::Runtime &runtime)> &&fp);
 
   /**
-   Executes a function in the worklet thread
+   Executes a function in the worklet thread. Queued work with a higher
+   priority runs first.
+   */
+  void invokeOnWorkletThread(
+      std::function<void(JsiWorkletContext *context, jsi::Runtime &runtime)>
+          &&fp,
+      DispatchPriority priority = DispatchPriority::Normal);
+
+  /**
+   Executes a function in the worklet thread owning the given worklet runtime.
+   Use this for work that touches values living in that runtime - in pooled
+   contexts work passed to invokeOnWorkletThread can run on any of the
+   context's runtimes.
    */
-  void invokeOnWorkletThread(std::function<void(JsiWorkletContext *context,
-                                                jsi::Runtime &runtime)> &&fp);
+  void invokeOnWorkletRuntime(
+      jsi::Runtime &runtime,
+      std::function<void(JsiWorkletContext *context, jsi::Runtime &runtime)>
+          &&fp);
 
   static jsi::HostFunctionType createInvoker(jsi::Runtime &runtime,
                                              const jsi::Value *maybeFunc);
@@ -192,12 +391,14 @@ public:
    @param maybeFunc Function to call - might be a worklet or might not - depends
    on wether we call cross context or not.
    @param ctx Context to call the function in
+   @param options Options for the call
    @returns A host function type that will return a promise calling the
    maybeFunc.
    */
-  static jsi::HostFunctionType createCallInContext(jsi::Runtime &runtime,
-                                                   const jsi::Value &maybeFunc,
-                                                   JsiWorkletContext *ctx);
+  static jsi::HostFunctionType
+  createCallInContext(jsi::Runtime &runtime, const jsi::Value &maybeFunc,
+                      JsiWorkletContext *ctx,
+                      const CallOptions &options = CallOptions());
 
   /**
    Calls a worklet function in a given context (or in the JS context if the ctx
@@ -205,11 +406,29 @@ public:
    @param runtime Runtime for the calling context
    @param maybeFunc Function to call - might be a worklet or might not - depends
    on wether we call cross context or not.
+   @param options Options for the call
    @returns A host function type that will return a promise calling the
    maybeFunc.
    */
-  jsi::HostFunctionType createCallInContext(jsi::Runtime &runtime,
-                                            const jsi::Value &maybeFunc);
+  jsi::HostFunctionType
+  createCallInContext(jsi::Runtime &runtime, const jsi::Value &maybeFunc,
+                      const CallOptions &options = CallOptions());
+
+  /**
+   Calls a worklet function in a given context (or in the JS context if the ctx
+   parameter is null) and blocks the calling thread until it returns. Calls
+   within the same context run inline. Calls that would wait on a thread
+   that is already waiting for the caller throw instead of deadlocking.
+   @param runtime Runtime for the calling context
+   @param maybeFunc Function to call
+   @param ctx Context to call the function in
+   @param options Options for the call, including the timeout
+   @returns A host function type that returns the result of the maybeFunc.
+   */
+  static jsi::HostFunctionType
+  createCallInContextSync(jsi::Runtime &runtime, const jsi::Value &maybeFunc,
+                          JsiWorkletContext *ctx,
+                          const CallOptions &options = CallOptions());
 
   // Resolve type of call we're about to do
   typedef enum {
@@ -247,17 +466,92 @@ public:
   }
 
 private:
+  /**
+   Returns the worklet runtime with the given index. Lazy evaluated
+   */
+  jsi::Runtime &getWorkletRuntime(size_t index);
+
+  /**
+   Returns the index of the worklet runtime
+   */
+  size_t getWorkletRuntimeIndex(jsi::Runtime &runtime);
+
+  /**
+   Returns the name of one of the context's threads
+   */
+  std::string getThreadName(const std::string &name, const char *kind) {
+    return name + "_worklet_" + kind + "_" + std::to_string(_contextId);
+  }
+
+  /**
+   Applies decorators added since the last call to the worklet runtime with
+   the given index. Must be called on the thread owning the runtime.
+   */
+  void applyPendingDecorators(size_t index);
+
+  /**
+   Calls the function in the calling runtime without wrapping any values
+   */
+  static jsi::Value callInRuntime(jsi::Runtime &runtime,
+                                  std::shared_ptr<WorkletInvoker> workletInvoker,
+                                  std::shared_ptr<jsi::Function> func,
+                                  const jsi::Value &thisValue,
+                                  const jsi::Value *arguments, size_t count,
+                                  const CallOptions &options,
+                                  std::shared_ptr<JsiCallTrace> trace);
+
+  /**
+   Registers that the from context (nullptr for the JS thread) is about to
+   block on the to context. Returns false if the to context is already
+   waiting, directly or through other contexts, for the from context.
+   */
+  static bool addWaitFor(JsiWorkletContext *from, JsiWorkletContext *to);
+
+  /**
+   Removes a wait registered with addWaitFor
+   */
+  static void removeWaitFor(JsiWorkletContext *from, JsiWorkletContext *to);
+
   jsi::Runtime *_jsRuntime;
-  std::unique_ptr<jsi::Runtime> _workletRuntime;
+  std::vector<std::unique_ptr<jsi::Runtime>> _workletRuntimes;
+  // Published when a runtime has been created, for lookups from any thread
+  std::vector<std::atomic<jsi::Runtime *>> _workletRuntimePointers;
+  std::mutex _decoratorsMutex;
+  std::vector<std::vector<std::shared_ptr<JsiBaseDecorator>>>
+      _pendingDecorators;
+  // Number of decorators added, and per runtime the number applied to it
+  std::atomic<size_t> _decoratorGeneration = {0};
+  std::vector<std::atomic<size_t>> _appliedDecoratorGenerations;
+  // Destroyed before the runtimes owning the cached functions
+  std::vector<std::shared_ptr<JsiWorkletCache>> _workletCaches;
+  std::atomic<size_t> _workletCacheSize{DefaultWorkletCacheSize};
+  // Destroyed before the runtimes owning the timer callbacks
+  std::vector<std::shared_ptr<JsiWorkletTimers>> _workletTimers;
+  std::mutex _dispatchTimerMutex;
+  std::shared_ptr<DispatchTimer> _dispatchTimer;
+  DispatchThreadOptions _threadOptions;
+  std::mutex _nameMutex;
   std::string _name;
   std::function<void(std::function<void()> &&)> _jsCallInvoker;
   std::function<void(std::function<void()> &&)> _workletCallInvoker;
-  size_t _contextId;
+  std::shared_ptr<DispatchPool> _dispatchPool;
+  std::shared_ptr<DispatchQueue> _dispatchQueue;
+  std::shared_ptr<JsiLatencyHistograms> _latencyHistograms =
+      std::make_shared<JsiLatencyHistograms>();
+  // Assigned on construction, before any queue, pool or timer is named
+  size_t _contextId = ++contextIdNumber;
+  // Wrappers created on the context's threads are counted here
+  JsiMemoryCounter *_memoryCounter = nullptr;
   std::thread::id _jsThreadId;
 
   static std::shared_ptr<JsiWorkletContext> defaultInstance;
+  static std::shared_ptr<JsiWorkletContext> parallelInstance;
+  static std::mutex parallelInstanceMutex;
   static std::map<void *, JsiWorkletContext *> runtimeMappings;
-  static size_t contextIdNumber;
+  static std::mutex runtimeMappingsMutex;
+  static std::mutex waitForMutex;
+  static std::multimap<JsiWorkletContext *, JsiWorkletContext *> waitForGraph;
+  static std::atomic<size_t> contextIdNumber;
 };
 
 } // namespace RNWorklet
@@ -0,0 +1,376 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "WKTArgumentsWrapper.h"
+#include "WKTJsiHostObject.h"
+#include "WKTJsiWorklet.h"
+#include "WKTJsiWorkletContext.h"
+#include "WKTLog.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+static const char *PropNameCapacity = "capacity";
+static const char *PropNameOverflow = "overflow";
+
+/**
+ What a pipeline stage does with values pushed while its queue is full
+ */
+enum class OverflowPolicy {
+  /**
+   Drops the oldest queued value to make room for the new one
+   */
+  DropOldest,
+  /**
+   Drops the new value
+   */
+  DropNewest,
+  /**
+   Blocks the pushing thread until there is room, or until the timeout
+   expires and the new value is dropped. Values pushed from a thread that
+   drains the stage itself are dropped right away, since waiting could
+   never make room.
+   */
+  Block
+};
+
+/**
+ Options for a pipeline stage
+ */
+struct PipelineStageOptions {
+  /**
+   Max number of values waiting in the stage's queue
+   */
+  size_t capacity = 1;
+
+  OverflowPolicy overflow = OverflowPolicy::DropOldest;
+
+  /**
+   How values are passed into the stage
+   */
+  TransferMode transferMode = TransferMode::Wrap;
+
+  /**
+   Max time a push blocks with the Block policy
+   */
+  std::chrono::milliseconds timeout = std::chrono::milliseconds(1000);
+};
+
+/**
+ A stage in a pipeline of worklets. Values pushed to the stage are queued in a
+ bounded queue and processed one at a time by the stage's worklet in the
+ stage's context (or on the JS thread if the stage has no context). Results
+ other than undefined are pushed straight to the connected stage from the
+ thread that produced them, without going through the JS thread.
+ */
+class JsiPipelineStage
+    : public JsiHostObject,
+      public std::enable_shared_from_this<JsiPipelineStage> {
+public:
+  /**
+   Constructor
+   @param runtime Calling runtime
+   @param worklet Worklet processing the values
+   @param context Context to run in, or nullptr for the JS thread
+   @param options Stage options
+   */
+  JsiPipelineStage(jsi::Runtime &runtime, const jsi::Value &worklet,
+                   std::shared_ptr<JsiWorkletContext> context,
+                   const PipelineStageOptions &options)
+      : _context(context), _options(options),
+        _statsStart(std::chrono::steady_clock::now()) {
+    if (!worklet.isObject() ||
+        !worklet.asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime,
+                         "createPipelineStage expects a worklet function.");
+    }
+    auto func = std::make_shared<jsi::Function>(
+        worklet.asObject(runtime).asFunction(runtime));
+    if (!JsiWorklet::isDecoratedAsWorklet(runtime, func)) {
+      throw jsi::JSError(runtime, "createPipelineStage expects a worklet "
+                                  "function, the function is not a worklet.");
+    }
+    _workletInvoker = std::make_shared<WorkletInvoker>(runtime, worklet);
+  }
+
+  /**
+   Pushes a value to the stage
+   @returns False if the value (and not an older one) was dropped
+   */
+  bool push(jsi::Runtime &runtime, const jsi::Value &value) {
+    auto wrapped =
+        std::make_shared<ArgumentsWrapper>(runtime, &value, 1,
+                                           _options.transferMode);
+    _received++;
+
+    bool schedule = false;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      if (_queue.size() >= _options.capacity) {
+        switch (_options.overflow) {
+        case OverflowPolicy::DropOldest:
+          _queue.pop_front();
+          _dropped++;
+          break;
+        case OverflowPolicy::DropNewest:
+          _dropped++;
+          return false;
+        case OverflowPolicy::Block:
+          // Pushing from the stage's own runtime (or from JS into a stage on
+          // the JS thread) would wait for a drain that needs this thread
+          if (JsiWorkletContext::getCurrent(runtime) == _context.get()) {
+            _dropped++;
+            return false;
+          }
+          if (!_spaceAvailable.wait_for(lock, _options.timeout, [this]() {
+                return _queue.size() < _options.capacity;
+              })) {
+            _dropped++;
+            return false;
+          }
+          break;
+        }
+      }
+      _queue.push_back(std::move(wrapped));
+      if (!_draining) {
+        _draining = true;
+        schedule = true;
+      }
+    }
+
+    if (schedule) {
+      scheduleDrain();
+    }
+    return true;
+  }
+
+  /**
+   Connects the output of this stage to the next stage
+   */
+  void connect(std::shared_ptr<JsiPipelineStage> next) {
+    std::atomic_store(&_next, std::move(next));
+  }
+
+  JSI_HOST_FUNCTION(push) {
+    if (count == 0) {
+      throw jsi::JSError(runtime, "push expects a value.");
+    }
+    return push(runtime, arguments[0]);
+  }
+
+  JSI_HOST_FUNCTION(connect) {
+    if (count == 0 || arguments[0].isUndefined() || arguments[0].isNull()) {
+      connect(nullptr);
+      return jsi::Value::undefined();
+    }
+    auto next = arguments[0].isObject()
+                    ? arguments[0].asObject(runtime).getHostObject<
+                          JsiPipelineStage>(runtime)
+                    : nullptr;
+    if (next == nullptr) {
+      throw jsi::JSError(runtime, "connect expects a pipeline stage.");
+    }
+    connect(next);
+    // Return the next stage so that connect calls can be chained
+    return arguments[0].asObject(runtime);
+  }
+
+  JSI_HOST_FUNCTION(resetStats) {
+    _received = 0;
+    _processed = 0;
+    _dropped = 0;
+    _errors = 0;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _statsStart = std::chrono::steady_clock::now();
+    return jsi::Value::undefined();
+  }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiPipelineStage, push),
+                       JSI_EXPORT_FUNC(JsiPipelineStage, connect),
+                       JSI_EXPORT_FUNC(JsiPipelineStage, resetStats))
+
+  JSI_PROPERTY_GET(stats) {
+    size_t queued;
+    std::chrono::duration<double> elapsed;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      queued = _queue.size();
+      elapsed = std::chrono::steady_clock::now() - _statsStart;
+    }
+    auto processed = static_cast<double>(_processed.load());
+    auto stats = jsi::Object(runtime);
+    stats.setProperty(runtime, "received", static_cast<double>(_received));
+    stats.setProperty(runtime, "processed", processed);
+    stats.setProperty(runtime, "dropped", static_cast<double>(_dropped));
+    stats.setProperty(runtime, "errors", static_cast<double>(_errors));
+    stats.setProperty(runtime, "queued", static_cast<double>(queued));
+    stats.setProperty(runtime, "throughput",
+                      elapsed.count() > 0 ? processed / elapsed.count() : 0);
+    return stats;
+  }
+
+  JSI_PROPERTY_GET(capacity) {
+    return static_cast<double>(_options.capacity);
+  }
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiPipelineStage, stats),
+                              JSI_EXPORT_PROP_GET(JsiPipelineStage, capacity))
+
+  /**
+   Reads the stage options from a javascript options object
+   */
+  static PipelineStageOptions getOptions(jsi::Runtime &runtime,
+                                         const jsi::Value &value) {
+    PipelineStageOptions options;
+    if (value.isUndefined() || value.isNull()) {
+      return options;
+    }
+    if (!value.isObject()) {
+      throw jsi::JSError(runtime, "createPipelineStage expects the options "
+                                  "parameter as an object.");
+    }
+    auto obj = value.asObject(runtime);
+    auto capacity = obj.getProperty(runtime, PropNameCapacity);
+    if (capacity.isNumber() && capacity.asNumber() >= 1) {
+      options.capacity = static_cast<size_t>(capacity.asNumber());
+    } else if (!capacity.isUndefined()) {
+      throw jsi::JSError(runtime,
+                         "The capacity option must be a positive number.");
+    }
+    auto overflow = obj.getProperty(runtime, PropNameOverflow);
+    if (overflow.isString()) {
+      auto overflowStr = overflow.asString(runtime).utf8(runtime);
+      if (overflowStr == "dropOldest") {
+        options.overflow = OverflowPolicy::DropOldest;
+      } else if (overflowStr == "dropNewest") {
+        options.overflow = OverflowPolicy::DropNewest;
+      } else if (overflowStr == "block") {
+        options.overflow = OverflowPolicy::Block;
+      } else {
+        throw jsi::JSError(runtime, "Invalid overflow option \"" +
+                                        overflowStr +
+                                        "\", expected \"dropOldest\", "
+                                        "\"dropNewest\" or \"block\".");
+      }
+    } else if (!overflow.isUndefined()) {
+      throw jsi::JSError(runtime, "The overflow option must be a string.");
+    }
+    auto transfer = obj.getProperty(runtime, "transfer");
+    if (transfer.isString()) {
+      auto transferStr = transfer.asString(runtime).utf8(runtime);
+      if (transferStr == "serialize") {
+        options.transferMode = TransferMode::Serialize;
+      } else if (transferStr != "wrap") {
+        throw jsi::JSError(runtime, "Invalid transfer option \"" +
+                                        transferStr +
+                                        "\", expected \"wrap\" or "
+                                        "\"serialize\".");
+      }
+    } else if (!transfer.isUndefined()) {
+      throw jsi::JSError(runtime, "The transfer option must be a string.");
+    }
+    auto timeout = obj.getProperty(runtime, "timeout");
+    if (timeout.isNumber() && timeout.asNumber() >= 0) {
+      options.timeout = std::chrono::milliseconds(
+          static_cast<int64_t>(timeout.asNumber()));
+    } else if (!timeout.isUndefined()) {
+      throw jsi::JSError(runtime,
+                         "The timeout option must be a non-negative number.");
+    }
+    return options;
+  }
+
+private:
+  void scheduleDrain() {
+    auto weakSelf = weak_from_this();
+    if (_context != nullptr) {
+      _context->invokeOnWorkletThread(
+          [weakSelf](JsiWorkletContext *, jsi::Runtime &runtime) {
+            auto self = weakSelf.lock();
+            if (self) {
+              self->drain(runtime);
+            }
+          });
+    } else {
+      JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
+          [weakSelf](jsi::Runtime &runtime) {
+            auto self = weakSelf.lock();
+            if (self) {
+              self->drain(runtime);
+            }
+          });
+    }
+  }
+
+  /**
+   Processes queued values until the queue is empty. Only one drain runs at a
+   time, so values are processed in order even in pooled contexts.
+   */
+  void drain(jsi::Runtime &runtime) {
+    while (true) {
+      std::shared_ptr<ArgumentsWrapper> value;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_queue.empty()) {
+          _draining = false;
+          return;
+        }
+        value = std::move(_queue.front());
+        _queue.pop_front();
+      }
+      _spaceAvailable.notify_one();
+
+      try {
+        auto args = value->getArguments(runtime);
+        auto result = _workletInvoker->call(runtime, jsi::Value::undefined(),
+                                            ArgumentsWrapper::toArgs(args),
+                                            value->getCount());
+        _processed++;
+
+        auto next = std::atomic_load(&_next);
+        if (next != nullptr && !result.isUndefined()) {
+          next->push(runtime, result);
+        }
+      } catch (const jsi::JSError &err) {
+        _errors++;
+        WKT_LOG_ERROR("Pipeline stage error: %s", err.getMessage().c_str());
+      } catch (const std::exception &err) {
+        _errors++;
+        WKT_LOG_ERROR("Pipeline stage error: %s", err.what());
+      } catch (...) {
+        _errors++;
+        WKT_LOG_ERROR("Unknown pipeline stage error.");
+      }
+    }
+  }
+
+  std::shared_ptr<JsiWorkletContext> _context;
+  std::shared_ptr<WorkletInvoker> _workletInvoker;
+  PipelineStageOptions _options;
+  std::shared_ptr<JsiPipelineStage> _next;
+
+  std::mutex _mutex;
+  std::condition_variable _spaceAvailable;
+  std::deque<std::shared_ptr<ArgumentsWrapper>> _queue;
+  bool _draining = false;
+
+  std::atomic<size_t> _received = {0};
+  std::atomic<size_t> _processed = {0};
+  std::atomic<size_t> _dropped = {0};
+  std::atomic<size_t> _errors = {0};
+  std::chrono::steady_clock::time_point _statsStart;
+};
+
+} // namespace RNWorklet
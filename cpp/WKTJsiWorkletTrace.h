@@ -0,0 +1,460 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(WKT_TRACE_SIGNPOSTS) && defined(__APPLE__)
+#include <os/signpost.h>
+#elif defined(WKT_TRACE_SIGNPOSTS) && defined(ANDROID)
+#include <android/trace.h>
+#endif
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Stages of a call between contexts
+ */
+enum class TraceStage : uint8_t {
+  /**
+   Wrapping the arguments in the calling runtime
+   */
+  ArgumentWrap = 0,
+  /**
+   Waiting in the target context's queue
+   */
+  QueueWait = 1,
+  /**
+   Running the worklet in the target runtime
+   */
+  Execution = 2,
+  /**
+   Wrapping the result and resolving the promise in the calling runtime
+   */
+  ResultResolve = 3,
+  /**
+   The whole call, from calling until the promise is resolved
+   */
+  Total = 4
+};
+
+static constexpr size_t TraceStageCount = 5;
+
+inline const char *getTraceStageName(TraceStage stage) {
+  switch (stage) {
+  case TraceStage::ArgumentWrap:
+    return "argumentWrap";
+  case TraceStage::QueueWait:
+    return "queueWait";
+  case TraceStage::Execution:
+    return "execution";
+  case TraceStage::ResultResolve:
+    return "resultResolve";
+  case TraceStage::Total:
+    return "total";
+  }
+  return "unknown";
+}
+
+/**
+ A traced stage of a call. Times are nanoseconds on the steady clock.
+ */
+struct TraceEvent {
+  uint64_t callId;
+  size_t contextId;
+  TraceStage stage;
+  int64_t startTime;
+  int64_t duration;
+};
+
+/**
+ Fixed size ring buffer of trace events. Writers never block or allocate, the
+ oldest events are overwritten when the buffer is full. Each slot is guarded by
+ its own sequence number so that readers can skip slots that are being written.
+ */
+class JsiTraceBuffer {
+public:
+  static constexpr size_t Capacity = 4096;
+
+  JsiTraceBuffer() {
+    for (auto &slot : _slots) {
+      slot.sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   Adds an event to the buffer
+   */
+  void add(const TraceEvent &event) {
+    auto index = _writeIndex.fetch_add(1, std::memory_order_relaxed);
+    auto &slot = _slots[index & (Capacity - 1)];
+
+    // Odd while writing, then two times index plus two when written
+    slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.callId.store(event.callId, std::memory_order_relaxed);
+    slot.contextId.store(event.contextId, std::memory_order_relaxed);
+    slot.stage.store(static_cast<uint8_t>(event.stage),
+                     std::memory_order_relaxed);
+    slot.startTime.store(event.startTime, std::memory_order_relaxed);
+    slot.duration.store(event.duration, std::memory_order_relaxed);
+    slot.sequence.store(index * 2 + 2, std::memory_order_release);
+  }
+
+  /**
+   Returns the events in the buffer, oldest first
+   */
+  std::vector<TraceEvent> getEvents() const {
+    std::vector<TraceEvent> events;
+    auto end = _writeIndex.load(std::memory_order_acquire);
+    auto begin = std::max(end > Capacity ? end - Capacity : 0,
+                          _clearIndex.load(std::memory_order_relaxed));
+    events.reserve(end - begin);
+    for (auto index = begin; index < end; index++) {
+      auto &slot = _slots[index & (Capacity - 1)];
+      auto sequence = slot.sequence.load(std::memory_order_acquire);
+      if (sequence != index * 2 + 2) {
+        // Being written or already overwritten
+        continue;
+      }
+      TraceEvent event;
+      event.callId = slot.callId.load(std::memory_order_relaxed);
+      event.contextId = slot.contextId.load(std::memory_order_relaxed);
+      event.stage =
+          static_cast<TraceStage>(slot.stage.load(std::memory_order_relaxed));
+      event.startTime = slot.startTime.load(std::memory_order_relaxed);
+      event.duration = slot.duration.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+        events.push_back(event);
+      }
+    }
+    return events;
+  }
+
+  /**
+   Drops all events currently in the buffer
+   */
+  void clear() {
+    _clearIndex.store(_writeIndex.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+  }
+
+private:
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> callId;
+    std::atomic<size_t> contextId;
+    std::atomic<uint8_t> stage;
+    std::atomic<int64_t> startTime;
+    std::atomic<int64_t> duration;
+  };
+
+  std::array<Slot, Capacity> _slots;
+  std::atomic<uint64_t> _writeIndex = {0};
+  std::atomic<uint64_t> _clearIndex = {0};
+};
+
+/**
+ Histogram of durations with power of two buckets, from one microsecond up to
+ about half a minute. Recording is lock-free, percentiles are approximated by
+ the upper bound of the bucket they fall in.
+ */
+class JsiLatencyHistogram {
+public:
+  static constexpr size_t BucketCount = 26;
+
+  /**
+   Records a duration in nanoseconds
+   */
+  void record(int64_t duration) {
+    auto micros = static_cast<uint64_t>(duration > 0 ? duration : 0) / 1000;
+    size_t bucket = 0;
+    while (bucket < BucketCount - 1 && micros >= (1ull << bucket)) {
+      bucket++;
+    }
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(duration, std::memory_order_relaxed);
+    auto max = _max.load(std::memory_order_relaxed);
+    while (duration > max && !_max.compare_exchange_weak(
+                                 max, duration, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t getCount() const { return _count.load(std::memory_order_relaxed); }
+
+  /**
+   Returns the mean duration in milliseconds
+   */
+  double getMean() const {
+    auto count = getCount();
+    return count == 0 ? 0
+                      : static_cast<double>(_sum.load(std::memory_order_relaxed)) /
+                            count / 1000000.0;
+  }
+
+  /**
+   Returns the max duration in milliseconds
+   */
+  double getMax() const {
+    return static_cast<double>(_max.load(std::memory_order_relaxed)) /
+           1000000.0;
+  }
+
+  /**
+   Returns the approximate percentile in milliseconds
+   @param percentile Percentile between 0 and 1
+   */
+  double getPercentile(double percentile) const {
+    auto count = getCount();
+    if (count == 0) {
+      return 0;
+    }
+    auto target = static_cast<uint64_t>(percentile * count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; i++) {
+      seen += _buckets[i].load(std::memory_order_relaxed);
+      if (seen > target) {
+        return std::min(static_cast<double>(1ull << i) / 1000.0, getMax());
+      }
+    }
+    return getMax();
+  }
+
+  void reset() {
+    for (auto &bucket : _buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   Returns the histogram as a javascript object
+   */
+  jsi::Object toJsi(jsi::Runtime &runtime) const {
+    jsi::Object result(runtime);
+    result.setProperty(runtime, "count", static_cast<double>(getCount()));
+    result.setProperty(runtime, "mean", getMean());
+    result.setProperty(runtime, "p50", getPercentile(0.5));
+    result.setProperty(runtime, "p90", getPercentile(0.9));
+    result.setProperty(runtime, "p99", getPercentile(0.99));
+    result.setProperty(runtime, "max", getMax());
+    return result;
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, BucketCount> _buckets = {};
+  std::atomic<uint64_t> _count = {0};
+  std::atomic<int64_t> _sum = {0};
+  std::atomic<int64_t> _max = {0};
+};
+
+/**
+ Latency histograms for each stage of calls into a context
+ */
+class JsiLatencyHistograms {
+public:
+  JsiLatencyHistogram &get(TraceStage stage) {
+    return _histograms[static_cast<size_t>(stage)];
+  }
+
+  void reset() {
+    for (auto &histogram : _histograms) {
+      histogram.reset();
+    }
+  }
+
+  jsi::Object toJsi(jsi::Runtime &runtime) {
+    jsi::Object result(runtime);
+    for (size_t i = 0; i < TraceStageCount; i++) {
+      auto stage = static_cast<TraceStage>(i);
+      result.setProperty(runtime, getTraceStageName(stage),
+                         get(stage).toJsi(runtime));
+    }
+    return result;
+  }
+
+private:
+  std::array<JsiLatencyHistogram, TraceStageCount> _histograms;
+};
+
+/**
+ Global tracing state
+ */
+class JsiWorkletTrace {
+public:
+  /**
+   Returns true if calls between contexts are traced. Off by default.
+   */
+  static bool isEnabled() {
+    return getEnabled().load(std::memory_order_relaxed);
+  }
+
+  static void setEnabled(bool enabled) {
+    getEnabled().store(enabled, std::memory_order_relaxed);
+  }
+
+  static JsiTraceBuffer &getBuffer() {
+    static JsiTraceBuffer buffer;
+    return buffer;
+  }
+
+  static uint64_t nextCallId() {
+    static std::atomic<uint64_t> callId = {0};
+    return ++callId;
+  }
+
+  static int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /**
+   Returns the events in the trace buffer as performance entries
+   */
+  static jsi::Array getEntries(jsi::Runtime &runtime) {
+    auto events = getBuffer().getEvents();
+    auto entries = jsi::Array(runtime, events.size());
+    for (size_t i = 0; i < events.size(); i++) {
+      auto &event = events[i];
+      jsi::Object entry(runtime);
+      entry.setProperty(runtime, "name",
+                        jsi::String::createFromAscii(
+                            runtime, getTraceStageName(event.stage)));
+      entry.setProperty(runtime, "entryType",
+                        jsi::String::createFromAscii(runtime, "worklet"));
+      entry.setProperty(runtime, "startTime",
+                        static_cast<double>(event.startTime) / 1000000.0);
+      entry.setProperty(runtime, "duration",
+                        static_cast<double>(event.duration) / 1000000.0);
+      entry.setProperty(runtime, "callId", static_cast<double>(event.callId));
+      entry.setProperty(runtime, "contextId",
+                        static_cast<double>(event.contextId));
+      entries.setValueAtIndex(runtime, i, std::move(entry));
+    }
+    return entries;
+  }
+
+private:
+  static std::atomic<bool> &getEnabled() {
+    static std::atomic<bool> enabled = {false};
+    return enabled;
+  }
+};
+
+/**
+ Marker for native profilers (os_signpost / systrace). Only emitted when
+ compiled with WKT_TRACE_SIGNPOSTS.
+ */
+class JsiTraceSection {
+public:
+  explicit JsiTraceSection(const char *name) {
+#if defined(WKT_TRACE_SIGNPOSTS) && defined(__APPLE__)
+    _id = os_signpost_id_generate(getLog());
+    os_signpost_interval_begin(getLog(), _id, "worklet", "%{public}s", name);
+#elif defined(WKT_TRACE_SIGNPOSTS) && defined(ANDROID)
+    ATrace_beginSection(name);
+#endif
+  }
+
+  ~JsiTraceSection() {
+#if defined(WKT_TRACE_SIGNPOSTS) && defined(__APPLE__)
+    os_signpost_interval_end(getLog(), _id, "worklet");
+#elif defined(WKT_TRACE_SIGNPOSTS) && defined(ANDROID)
+    ATrace_endSection();
+#endif
+  }
+
+  JsiTraceSection(const JsiTraceSection &) = delete;
+  JsiTraceSection &operator=(const JsiTraceSection &) = delete;
+
+private:
+#if defined(WKT_TRACE_SIGNPOSTS) && defined(__APPLE__)
+  static os_log_t getLog() {
+    static os_log_t log =
+        os_log_create("com.worklets.core", OS_LOG_CATEGORY_POINTS_OF_INTEREST);
+    return log;
+  }
+  os_signpost_id_t _id;
+#endif
+};
+
+/**
+ Traces the stages of a single call. Stages follow each other, each one lasts
+ from the previous mark until the next. The stages run on different threads,
+ but never at the same time.
+ */
+class JsiCallTrace {
+public:
+  /**
+   Starts tracing a call, returns nullptr when tracing is disabled
+   @param histograms Histograms of the target context
+   @param contextId Id of the target context
+   */
+  static std::shared_ptr<JsiCallTrace>
+  start(std::shared_ptr<JsiLatencyHistograms> histograms, size_t contextId) {
+    if (!JsiWorkletTrace::isEnabled() || histograms == nullptr) {
+      return nullptr;
+    }
+    return std::make_shared<JsiCallTrace>(std::move(histograms), contextId);
+  }
+
+  JsiCallTrace(std::shared_ptr<JsiLatencyHistograms> histograms,
+               size_t contextId)
+      : _histograms(std::move(histograms)), _contextId(contextId),
+        _callId(JsiWorkletTrace::nextCallId()),
+        _startTime(JsiWorkletTrace::now()), _lastTime(_startTime) {}
+
+  /**
+   Starts the next stage without recording the time since the last mark
+   */
+  void restart() { _lastTime = JsiWorkletTrace::now(); }
+
+  /**
+   Records the time since the last mark for the stage
+   */
+  void mark(TraceStage stage) {
+    auto time = JsiWorkletTrace::now();
+    record(stage, _lastTime, time - _lastTime);
+    _lastTime = time;
+  }
+
+  /**
+   Records the last stage and the total time of the call
+   */
+  void finish(TraceStage stage) {
+    mark(stage);
+    record(TraceStage::Total, _startTime, _lastTime - _startTime);
+  }
+
+private:
+  void record(TraceStage stage, int64_t startTime, int64_t duration) {
+    _histograms->get(stage).record(duration);
+    JsiWorkletTrace::getBuffer().add(
+        {_callId, _contextId, stage, startTime, duration});
+  }
+
+  std::shared_ptr<JsiLatencyHistograms> _histograms;
+  size_t _contextId;
+  uint64_t _callId;
+  int64_t _startTime;
+  int64_t _lastTime;
+};
+
+} // namespace RNWorklet
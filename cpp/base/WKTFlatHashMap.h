@@ -0,0 +1,99 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace RNWorklet {
+
+/**
+ Open addressing hash map with string keys and linear probing. Entries are
+ stored inline in a single array, lookups take a string_view so that callers
+ don't need to allocate a key. Supports insertion and lookup only.
+ */
+template <typename V> class FlatHashMap {
+public:
+  explicit FlatHashMap(size_t expectedSize = 0) {
+    size_t capacity = 8;
+    while (capacity < expectedSize * 2) {
+      capacity *= 2;
+    }
+    _slots.resize(capacity);
+  }
+
+  /**
+   Returns the value for the key, or nullptr if not found
+   */
+  const V *find(std::string_view key) const {
+    auto hash = std::hash<std::string_view>()(key);
+    auto mask = _slots.size() - 1;
+    for (auto index = hash & mask;; index = (index + 1) & mask) {
+      auto &slot = _slots[index];
+      if (!slot.used) {
+        return nullptr;
+      }
+      if (slot.hash == hash && slot.key == key) {
+        return &slot.value;
+      }
+    }
+  }
+
+  V *find(std::string_view key) {
+    return const_cast<V *>(
+        static_cast<const FlatHashMap<V> *>(this)->find(key));
+  }
+
+  /**
+   Inserts the value if the key is not in the map. Returns the value in the
+   map for the key.
+   */
+  V &insert(std::string_view key, V value) {
+    if ((_size + 1) * 2 > _slots.size()) {
+      grow();
+    }
+    auto hash = std::hash<std::string_view>()(key);
+    auto mask = _slots.size() - 1;
+    for (auto index = hash & mask;; index = (index + 1) & mask) {
+      auto &slot = _slots[index];
+      if (!slot.used) {
+        slot.used = true;
+        slot.hash = hash;
+        slot.key = std::string(key);
+        slot.value = std::move(value);
+        _size++;
+        return slot.value;
+      }
+      if (slot.hash == hash && slot.key == key) {
+        return slot.value;
+      }
+    }
+  }
+
+  size_t size() const { return _size; }
+
+private:
+  struct Slot {
+    bool used = false;
+    size_t hash = 0;
+    std::string key;
+    V value = V();
+  };
+
+  void grow() {
+    std::vector<Slot> slots(_slots.size() * 2);
+    slots.swap(_slots);
+    _size = 0;
+    for (auto &slot : slots) {
+      if (slot.used) {
+        insert(slot.key, std::move(slot.value));
+      }
+    }
+  }
+
+  std::vector<Slot> _slots;
+  size_t _size = 0;
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace RNWorklet {
+
+/**
+ Counters shared by all block pools
+ */
+struct JsiBlockPoolStats {
+  /**
+   Blocks kept in the free lists and their bytes
+   */
+  std::atomic<int64_t> pooledBlocks = {0};
+  std::atomic<int64_t> pooledBytes = {0};
+  /**
+   Allocations served from a free list or from the heap
+   */
+  std::atomic<uint64_t> hits = {0};
+  std::atomic<uint64_t> misses = {0};
+
+  static JsiBlockPoolStats &get() {
+    static JsiBlockPoolStats stats;
+    return stats;
+  }
+};
+
+/**
+ Pool of fixed size blocks. Each thread keeps a free list of up to
+ MaxPooledBlocks blocks, so allocating and freeing never takes a lock. Blocks
+ freed on another thread than they were allocated on move to that thread's
+ list.
+ */
+template <size_t BlockSize> class JsiBlockPool {
+public:
+  static constexpr size_t MaxPooledBlocks = 256;
+
+  static void *allocate() {
+    auto &list = getFreeList();
+    auto &stats = JsiBlockPoolStats::get();
+    if (list.head == nullptr) {
+      stats.misses.fetch_add(1, std::memory_order_relaxed);
+      return ::operator new(BlockSize);
+    }
+    auto block = list.head;
+    list.head = block->next;
+    list.count--;
+    stats.hits.fetch_add(1, std::memory_order_relaxed);
+    stats.pooledBlocks.fetch_sub(1, std::memory_order_relaxed);
+    stats.pooledBytes.fetch_sub(BlockSize, std::memory_order_relaxed);
+    return block;
+  }
+
+  static void deallocate(void *pointer) {
+    if (isThreadExiting()) {
+      ::operator delete(pointer);
+      return;
+    }
+    auto &list = getFreeList();
+    if (list.count >= MaxPooledBlocks) {
+      ::operator delete(pointer);
+      return;
+    }
+    auto block = static_cast<Block *>(pointer);
+    block->next = list.head;
+    list.head = block;
+    list.count++;
+    auto &stats = JsiBlockPoolStats::get();
+    stats.pooledBlocks.fetch_add(1, std::memory_order_relaxed);
+    stats.pooledBytes.fetch_add(BlockSize, std::memory_order_relaxed);
+  }
+
+private:
+  static_assert(BlockSize >= sizeof(void *), "Blocks must fit a pointer");
+
+  struct Block {
+    Block *next;
+  };
+
+  struct FreeList {
+    Block *head = nullptr;
+    size_t count = 0;
+
+    ~FreeList() {
+      isThreadExiting() = true;
+      auto &stats = JsiBlockPoolStats::get();
+      stats.pooledBlocks.fetch_sub(count, std::memory_order_relaxed);
+      stats.pooledBytes.fetch_sub(count * BlockSize,
+                                  std::memory_order_relaxed);
+      while (head != nullptr) {
+        auto next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+  };
+
+  static FreeList &getFreeList() {
+    static thread_local FreeList list;
+    return list;
+  }
+
+  // Blocks freed by thread_local destructors running after the free list is
+  // gone go straight back to the heap
+  static bool &isThreadExiting() {
+    static thread_local bool exiting = false;
+    return exiting;
+  }
+};
+
+/**
+ Allocator taking single objects from the block pool of their size, for use
+ with std::allocate_shared
+ */
+template <typename T> class JsiPoolAllocator {
+public:
+  using value_type = T;
+
+  JsiPoolAllocator() = default;
+  template <typename U> JsiPoolAllocator(const JsiPoolAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    if (n != 1) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T *>(JsiBlockPool<getBlockSize()>::allocate());
+  }
+
+  void deallocate(T *pointer, size_t n) {
+    if (n != 1) {
+      ::operator delete(pointer);
+      return;
+    }
+    JsiBlockPool<getBlockSize()>::deallocate(pointer);
+  }
+
+  template <typename U> bool operator==(const JsiPoolAllocator<U> &) const {
+    return true;
+  }
+  template <typename U> bool operator!=(const JsiPoolAllocator<U> &) const {
+    return false;
+  }
+
+private:
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+                "Over-aligned types can not be pooled");
+
+  // Sizes are rounded up so that similar types share a pool
+  static constexpr size_t getBlockSize() {
+    return (sizeof(T) + 15) / 16 * 16;
+  }
+};
+
+} // namespace RNWorklet
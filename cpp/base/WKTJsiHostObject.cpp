@@ -1,124 +1,161 @@
 #include "WKTJsiHostObject.h"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
 #include <utility>
 
-// To be able to find objects that aren't cleaned up correctly,
-// we can set this value to 1 and debug the constructor/destructor
-#define JSI_DEBUG_ALLOCATIONS 0
+#include "WKTJsiMemoryStats.h"
+#include "WKTJsiPropNameCache.h"
 
 namespace RNWorklet {
 
-#if JSI_DEBUG_ALLOCATIONS
-int objCounter = 0;
-std::vector<JsiHostObject *> objects;
-#endif
-
 JsiHostObject::JsiHostObject() {
-#if JSI_DEBUG_ALLOCATIONS
-  objects.push_back(this);
-  objCounter++;
-#endif
+  JsiMemoryStats::getHostObjectCounter().add(0);
 }
 JsiHostObject::~JsiHostObject() {
-#if JSI_DEBUG_ALLOCATIONS
-  for (size_t i = 0; i < objects.size(); ++i) {
-    if (objects.at(i) == this) {
-      objects.erase(objects.begin() + i);
-      break;
-    }
+  JsiMemoryStats::getHostObjectCounter().remove(0);
+}
+
+JsiHostObjectMembers::JsiHostObjectMembers(
+    const JsiFunctionMap &funcs, const JsiPropertyGettersMap &getters,
+    const JsiPropertySettersMap &setters)
+    : _members(funcs.size() + getters.size() + setters.size()) {
+  for (auto &func : funcs) {
+    auto &member = getOrAdd(func.first);
+    member.function = func.second;
+    member.functionIndex = _functionCount++;
+  }
+  for (auto &getter : getters) {
+    getOrAdd(getter.first).getter = getter.second;
+  }
+  for (auto &setter : setters) {
+    getOrAdd(setter.first).setter = setter.second;
   }
-  objCounter--;
-#endif
 }
 
-void JsiHostObject::set(jsi::Runtime &rt, const jsi::PropNameID &name,
-                        const jsi::Value &value) {
+JsiHostObjectMember &JsiHostObjectMembers::getOrAdd(const std::string &name) {
+  auto member = _members.find(name);
+  if (member != nullptr) {
+    return *member;
+  }
+  _names.push_back(name);
+  JsiHostObjectMember newMember;
+  newMember.keyId = JsiKeyTable::intern(name);
+  return _members.insert(name, newMember);
+}
 
-  auto nameStr = name.utf8(rt);
+const JsiHostObjectMembers &
+JsiHostObjectMembers::get(const JsiFunctionMap &funcs,
+                          const JsiPropertyGettersMap &getters,
+                          const JsiPropertySettersMap &setters) {
+  // The exported maps are static per class, so their addresses identify the
+  // class.
+  using Key = std::tuple<const void *, const void *, const void *>;
+  static std::mutex mutex;
+  static std::map<Key, std::unique_ptr<JsiHostObjectMembers>> registry;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &members = registry[Key(&funcs, &getters, &setters)];
+  if (members == nullptr) {
+    members = std::make_unique<JsiHostObjectMembers>(funcs, getters, setters);
+  }
+  return *members;
+}
 
-  /** Check the static setters map */
-  const JsiPropertySettersMap &setters = getExportedPropertySettersMap();
-  auto setter = setters.find(nameStr);
-  if (setter != setters.end()) {
-    auto dispatcher = std::bind(setter->second, this, std::placeholders::_1,
-                                std::placeholders::_2);
-    return dispatcher(rt, value);
+const JsiHostObjectMembers &JsiHostObject::getMembers() {
+  auto members = _members.load(std::memory_order_acquire);
+  if (members == nullptr) {
+    members = &JsiHostObjectMembers::get(getExportedFunctionMap(),
+                                         getExportedPropertyGettersMap(),
+                                         getExportedPropertySettersMap());
+    _members.store(members, std::memory_order_release);
+  }
+  return *members;
+}
+
+void JsiHostObject::set(jsi::Runtime &rt, const jsi::PropNameID &name,
+                        const jsi::Value &value) {
+  auto member = getMembers().find(name.utf8(rt));
+  if (member != nullptr && member->setter != nullptr) {
+    (this->*member->setter)(rt, value);
   }
 }
 
 jsi::Value JsiHostObject::get(jsi::Runtime &runtime,
                               const jsi::PropNameID &name) {
-  auto nameStr = name.utf8(runtime);
+  return getExported(runtime, name, name.utf8(runtime));
+}
 
-  // get mapped runtime / function cache
-  auto hostFunctionCache =
-      _hostFunctionCache.find(static_cast<void *>(&runtime));
-  if (hostFunctionCache == _hostFunctionCache.end()) {
-    std::map<std::string, jsi::Function> map;
-    _hostFunctionCache.emplace(static_cast<void *>(&runtime), std::move(map));
-    hostFunctionCache = _hostFunctionCache.find(static_cast<void *>(&runtime));
+jsi::Value JsiHostObject::getExported(jsi::Runtime &runtime,
+                                      const jsi::PropNameID &name,
+                                      const std::string &nameStr) {
+  auto &members = getMembers();
+  auto member = members.find(nameStr);
+  if (member == nullptr) {
+    return jsi::Value::undefined();
   }
 
-  // Check function cache
-  auto cachedFunc = hostFunctionCache->second.find(nameStr);
-  if (cachedFunc != hostFunctionCache->second.end()) {
-    return cachedFunc->second.asFunction(runtime);
+  // Getters take precedence over functions with the same name
+  if (member->getter != nullptr) {
+    return (this->*member->getter)(runtime);
   }
 
-  // Check the static getters map
-  const JsiPropertyGettersMap &getters = getExportedPropertyGettersMap();
-  auto getter = getters.find(nameStr);
-  if (getter != getters.end()) {
-    auto dispatcher = std::bind(getter->second, this, std::placeholders::_1);
-    return dispatcher(runtime);
+  if (member->function != nullptr) {
+    return getHostFunction(runtime, name, members, *member);
   }
 
-  // Check the static function map
-  const JsiFunctionMap &funcs = getExportedFunctionMap();
-  auto func = funcs.find(nameStr);
-  if (func != funcs.end()) {
-    auto dispatcher =
-        std::bind(func->second, reinterpret_cast<JsiHostObject *>(this),
-                  std::placeholders::_1, std::placeholders::_2,
-                  std::placeholders::_3, std::placeholders::_4);
+  return jsi::Value::undefined();
+}
 
+jsi::Value JsiHostObject::getHostFunction(jsi::Runtime &runtime,
+                                          const jsi::PropNameID &name,
+                                          const JsiHostObjectMembers &members,
+                                          const JsiHostObjectMember &member) {
+  std::lock_guard<std::mutex> lock(_hostFunctionCacheMutex);
+
+  // get mapped runtime / function cache
+  auto hostFunctionCache = std::find_if(
+      _hostFunctionCache.begin(), _hostFunctionCache.end(),
+      [&](const auto &entry) { return entry.first == &runtime; });
+  if (hostFunctionCache == _hostFunctionCache.end()) {
+    _hostFunctionCache.emplace_back(
+        static_cast<void *>(&runtime),
+        std::vector<std::unique_ptr<jsi::Function>>(
+            members.getFunctionCount()));
+    hostFunctionCache = _hostFunctionCache.end() - 1;
+  }
+
+  // Check function cache
+  auto &cachedFunc = hostFunctionCache->second.at(member.functionIndex);
+  if (cachedFunc == nullptr) {
+    auto func = member.function;
+    auto self = this;
     // Add to cache - it is important to cache the results from the
     // createFromHostFunction function which takes some time.
-    return hostFunctionCache->second
-        .emplace(nameStr, jsi::Function::createFromHostFunction(runtime, name,
-                                                                0, dispatcher))
-        .first->second.asFunction(runtime);
+    cachedFunc = std::make_unique<jsi::Function>(
+        jsi::Function::createFromHostFunction(
+            runtime, name, 0,
+            [self, func](jsi::Runtime &runtime, const jsi::Value &thisValue,
+                         const jsi::Value *arguments, size_t count) {
+              return (self->*func)(runtime, thisValue, arguments, count);
+            }));
   }
-
-  return jsi::Value::undefined();
+  return jsi::Value(runtime, *cachedFunc);
 }
 
 std::vector<jsi::PropNameID>
 JsiHostObject::getPropertyNames(jsi::Runtime &runtime) {
-  // statically exported functions
-  const auto &funcs = getExportedFunctionMap();
-
-  // Statically exported property getters
-  const auto &getters = getExportedPropertyGettersMap();
-
-  // Statically exported property setters
-  const auto &setters = getExportedPropertySettersMap();
+  auto &members = getMembers();
+  auto &names = members.getNames();
+  auto propNameCache = JsiPropNameCache::get(runtime);
 
   std::vector<jsi::PropNameID> propNames;
-  propNames.reserve(funcs.size() + getters.size() + setters.size());
-
-  for (auto it = funcs.cbegin(); it != funcs.cend(); ++it) {
-    propNames.push_back(jsi::PropNameID::forAscii(runtime, it->first));
-  }
-
-  for (auto it = getters.cbegin(); it != getters.cend(); ++it) {
-    propNames.push_back(jsi::PropNameID::forUtf8(runtime, it->first));
-  }
-
-  for (auto it = getters.cbegin(); it != getters.cend(); ++it) {
-    if (getters.count(it->first) == 0) {
-      propNames.push_back(jsi::PropNameID::forUtf8(runtime, it->first));
-    }
+  propNames.reserve(names.size());
+  for (auto &name : names) {
+    propNames.push_back(
+        propNameCache->getPropName(runtime, members.find(name)->keyId));
   }
   return propNames;
 }
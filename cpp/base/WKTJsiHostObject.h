@@ -2,13 +2,18 @@
 
 #include <jsi/jsi.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "WKTFlatHashMap.h"
+
 #define STR_CAT_NX(A, B) A##B
 #define STR_CAT(A, B) STR_CAT_NX(A, B)
 #define STR_GET get_
@@ -135,6 +140,65 @@ using JsiPropertySettersMap =
     std::unordered_map<std::string, void (JsiHostObject::*)(
                                         jsi::Runtime &, const jsi::Value &)>;
 
+/**
+ * Exported members of a host object class with a given name. A name can have
+ * a function, a getter and/or a setter.
+ */
+struct JsiHostObjectMember {
+  jsi::Value (JsiHostObject::*function)(jsi::Runtime &, const jsi::Value &,
+                                        const jsi::Value *,
+                                        size_t) = nullptr;
+  jsi::Value (JsiHostObject::*getter)(jsi::Runtime &) = nullptr;
+  void (JsiHostObject::*setter)(jsi::Runtime &, const jsi::Value &) = nullptr;
+  /** Interned key id of the name */
+  uint32_t keyId = 0;
+  /** Index of the function in the per runtime function cache */
+  size_t functionIndex = 0;
+};
+
+/**
+ * Flat lookup table of all exported members of a host object class, built
+ * once per class from the exported function, getter and setter maps so that
+ * property access is a single hash lookup.
+ */
+class JsiHostObjectMembers {
+public:
+  JsiHostObjectMembers(const JsiFunctionMap &funcs,
+                       const JsiPropertyGettersMap &getters,
+                       const JsiPropertySettersMap &setters);
+
+  /**
+   * Returns the member with the given name or nullptr
+   */
+  const JsiHostObjectMember *find(const std::string &name) const {
+    return _members.find(name);
+  }
+
+  /**
+   * Returns the names of all members, in the order functions, getters, setters
+   */
+  const std::vector<std::string> &getNames() const { return _names; }
+
+  /**
+   * Returns the number of exported functions
+   */
+  size_t getFunctionCount() const { return _functionCount; }
+
+  /**
+   * Returns the shared members table for the exported maps
+   */
+  static const JsiHostObjectMembers &
+  get(const JsiFunctionMap &funcs, const JsiPropertyGettersMap &getters,
+      const JsiPropertySettersMap &setters);
+
+private:
+  JsiHostObjectMember &getOrAdd(const std::string &name);
+
+  FlatHashMap<JsiHostObjectMember> _members;
+  std::vector<std::string> _names;
+  size_t _functionCount = 0;
+};
+
 /**
  * Base class for jsi host objects
  */
@@ -194,7 +258,34 @@ protected:
    */
   std::vector<jsi::PropNameID> getPropertyNames(jsi::Runtime &runtime) override;
 
+  /**
+   * Returns the exported getter value or function with the given name, for
+   * subclasses that already converted the name to UTF-8.
+   * @param runtime Runtime
+   * @param name Name of value to get
+   * @param nameStr UTF-8 value of name
+   * @return Value or undefined
+   */
+  jsi::Value getExported(jsi::Runtime &runtime, const jsi::PropNameID &name,
+                         const std::string &nameStr);
+
 private:
-  std::map<void *, std::map<std::string, jsi::Function>> _hostFunctionCache;
+  /**
+   * Returns the members table of this object's class
+   */
+  const JsiHostObjectMembers &getMembers();
+
+  /**
+   * Returns the cached host function for the member or creates it
+   */
+  jsi::Value getHostFunction(jsi::Runtime &runtime, const jsi::PropNameID &name,
+                             const JsiHostObjectMembers &members,
+                             const JsiHostObjectMember &member);
+
+  std::atomic<const JsiHostObjectMembers *> _members = {nullptr};
+  std::mutex _hostFunctionCacheMutex;
+  std::vector<
+      std::pair<void *, std::vector<std::unique_ptr<jsi::Function>>>>
+      _hostFunctionCache;
 };
 } // namespace RNWorklet
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace RNWorklet {
+
+/**
+ Number of live instances and their bytes
+ */
+struct JsiMemoryCounter {
+  std::atomic<int64_t> count = {0};
+  std::atomic<int64_t> bytes = {0};
+
+  void add(size_t size) {
+    count.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+  }
+
+  void remove(size_t size) {
+    count.fetch_sub(1, std::memory_order_relaxed);
+    bytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+  }
+};
+
+/**
+ Always-on accounting of live wrappers and host objects, updated with relaxed
+ atomics. Wrappers are counted by the type they were created with and by the
+ context whose thread created them, the JS thread and threads outside of
+ contexts count as "js". Bytes are the size of the instances themselves, not
+ of the strings and buffers they own.
+ */
+class JsiMemoryStats {
+public:
+  /**
+   Number of JsiWrapperType values, checked against JsiWrapperTypeCount where
+   the enum is declared
+   */
+  static constexpr size_t WrapperTypeCount = 11;
+
+  struct ContextCounter {
+    size_t contextId;
+    std::string name;
+    JsiMemoryCounter counter;
+  };
+
+  static JsiMemoryCounter &getWrapperCounter(size_t type) {
+    static JsiMemoryCounter counters[WrapperTypeCount];
+    return counters[type];
+  }
+
+  static JsiMemoryCounter &getHostObjectCounter() {
+    static JsiMemoryCounter counter;
+    return counter;
+  }
+
+  /**
+   Returns the counter of a context, created on first use. Counters are never
+   freed since wrappers can outlive the context that created them.
+   */
+  static JsiMemoryCounter *getContextCounter(size_t contextId,
+                                             const std::string &name) {
+    std::lock_guard<std::mutex> lock(getMutex());
+    auto &counters = getContextCounters();
+    for (auto &counter : counters) {
+      if (counter->contextId == contextId) {
+        return &counter->counter;
+      }
+    }
+    counters.push_back(std::make_unique<ContextCounter>());
+    counters.back()->contextId = contextId;
+    counters.back()->name = name;
+    return &counters.back()->counter;
+  }
+
+  /**
+   Changes the name reported for a context's counter
+   */
+  static void setContextName(size_t contextId, const std::string &name) {
+    std::lock_guard<std::mutex> lock(getMutex());
+    for (auto &counter : getContextCounters()) {
+      if (counter->contextId == contextId) {
+        counter->name = name;
+      }
+    }
+  }
+
+  /**
+   Calls the function with each context counter
+   */
+  template <typename Fn> static void forEachContextCounter(Fn &&fn) {
+    std::lock_guard<std::mutex> lock(getMutex());
+    for (auto &counter : getContextCounters()) {
+      fn(*counter);
+    }
+  }
+
+  /**
+   Returns the counter of the context running on the calling thread
+   */
+  static JsiMemoryCounter *getCurrentContextCounter() {
+    auto counter = current();
+    if (counter == nullptr) {
+      static JsiMemoryCounter *jsCounter = getContextCounter(0, "js");
+      counter = jsCounter;
+    }
+    return counter;
+  }
+
+  /**
+   Charges wrappers created on the calling thread to a context while in scope
+   */
+  class Scope {
+  public:
+    explicit Scope(JsiMemoryCounter *counter) : _previous(current()) {
+      current() = counter;
+    }
+    ~Scope() { current() = _previous; }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    JsiMemoryCounter *_previous;
+  };
+
+private:
+  static JsiMemoryCounter *&current() {
+    static thread_local JsiMemoryCounter *counter = nullptr;
+    return counter;
+  }
+
+  static std::mutex &getMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::vector<std::unique_ptr<ContextCounter>> &getContextCounters() {
+    static std::vector<std::unique_ptr<ContextCounter>> counters;
+    return counters;
+  }
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "WKTFlatHashMap.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Process wide table of interned property keys. Each distinct key gets a small
+ integer id that stays valid for the lifetime of the process.
+ */
+class JsiKeyTable {
+public:
+  /**
+   Returns the id of the key, interning it if needed
+   */
+  static uint32_t intern(std::string_view key) {
+    auto &table = getInstance();
+    {
+      std::shared_lock<std::shared_mutex> lock(table._mutex);
+      auto id = table._ids.find(key);
+      if (id != nullptr) {
+        return *id;
+      }
+    }
+    std::unique_lock<std::shared_mutex> lock(table._mutex);
+    auto id = static_cast<uint32_t>(table._keys.size());
+    auto &result = table._ids.insert(key, id);
+    if (result == id) {
+      table._keys.emplace_back(key);
+    }
+    return result;
+  }
+
+  /**
+   Returns the key for an id returned from intern
+   */
+  static const std::string &getKey(uint32_t id) {
+    auto &table = getInstance();
+    std::shared_lock<std::shared_mutex> lock(table._mutex);
+    return table._keys.at(id);
+  }
+
+private:
+  static JsiKeyTable &getInstance() {
+    static JsiKeyTable instance;
+    return instance;
+  }
+
+  std::shared_mutex _mutex;
+  FlatHashMap<uint32_t> _ids;
+  // Deque so that references returned from getKey stay valid
+  std::deque<std::string> _keys;
+};
+
+/**
+ Cache of PropNameIDs for interned keys in a single runtime, so that creating
+ property names for the same keys again does not convert from UTF-8. Caches
+ must only be used on the runtime's thread, and must be cleared before the
+ runtime is destroyed.
+ */
+class JsiPropNameCache {
+public:
+  /**
+   Returns the cache for the runtime
+   */
+  static std::shared_ptr<JsiPropNameCache> get(jsi::Runtime &runtime) {
+    std::lock_guard<std::mutex> lock(getMutex());
+    auto &caches = getCaches();
+    auto it = caches.find(&runtime);
+    if (it == caches.end()) {
+      it = caches.emplace(&runtime, std::make_shared<JsiPropNameCache>()).first;
+    }
+    return it->second;
+  }
+
+  /**
+   Drops the cache for the runtime
+   @param runtime Runtime to drop the cache for
+   @param releaseNames Release the cached names. Pass false if the runtime
+   might already be destroyed, the names are leaked instead.
+   */
+  static void clear(jsi::Runtime &runtime, bool releaseNames = true) {
+    std::shared_ptr<JsiPropNameCache> cache;
+    {
+      std::lock_guard<std::mutex> lock(getMutex());
+      auto &caches = getCaches();
+      auto it = caches.find(&runtime);
+      if (it == caches.end()) {
+        return;
+      }
+      cache = it->second;
+      caches.erase(it);
+    }
+    if (!releaseNames) {
+      for (auto &name : cache->_names) {
+        name.release();
+      }
+    }
+  }
+
+  /**
+   Returns a PropNameID for the key
+   */
+  jsi::PropNameID getPropName(jsi::Runtime &runtime, std::string_view key) {
+    return getPropName(runtime, JsiKeyTable::intern(key));
+  }
+
+  /**
+   Returns a PropNameID for the interned key
+   */
+  jsi::PropNameID getPropName(jsi::Runtime &runtime, uint32_t id) {
+    if (id >= _names.size()) {
+      _names.resize(id + 1);
+    }
+    auto &name = _names[id];
+    if (name == nullptr) {
+      name = std::make_unique<jsi::PropNameID>(
+          jsi::PropNameID::forUtf8(runtime, JsiKeyTable::getKey(id)));
+    }
+    return jsi::PropNameID(runtime, *name);
+  }
+
+private:
+  static std::mutex &getMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::map<jsi::Runtime *, std::shared_ptr<JsiPropNameCache>> &
+  getCaches() {
+    static std::map<jsi::Runtime *, std::shared_ptr<JsiPropNameCache>> caches;
+    return caches;
+  }
+
+  std::vector<std::unique_ptr<jsi::PropNameID>> _names;
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "WKTRingBuffer.h"
+
+#if defined(__APPLE__)
+#include <os/log.h>
+#elif defined(ANDROID)
+#include <android/log.h>
+#endif
+
+/**
+ Log levels. Messages below WKT_LOG_LEVEL are compiled out, their arguments
+ are not even evaluated. Defaults to debug in debug builds and to warnings
+ in release builds, define WKT_LOG_LEVEL to override.
+ */
+#define WKT_LOG_LEVEL_VERBOSE 0
+#define WKT_LOG_LEVEL_DEBUG 1
+#define WKT_LOG_LEVEL_INFO 2
+#define WKT_LOG_LEVEL_WARN 3
+#define WKT_LOG_LEVEL_ERROR 4
+#define WKT_LOG_LEVEL_NONE 5
+
+#ifndef WKT_LOG_LEVEL
+#if DEBUG
+#define WKT_LOG_LEVEL WKT_LOG_LEVEL_DEBUG
+#else
+#define WKT_LOG_LEVEL WKT_LOG_LEVEL_WARN
+#endif
+#endif
+
+namespace RNWorklet {
+
+enum class LogLevel {
+  Verbose = WKT_LOG_LEVEL_VERBOSE,
+  Debug = WKT_LOG_LEVEL_DEBUG,
+  Info = WKT_LOG_LEVEL_INFO,
+  Warn = WKT_LOG_LEVEL_WARN,
+  Error = WKT_LOG_LEVEL_ERROR
+};
+
+enum class LogMode {
+  /**
+   Messages are written to the platform log on the logging thread
+   */
+  Sync,
+  /**
+   Messages are formatted on the logging thread and written to the platform
+   log from a background thread, so that logging never waits for the log
+   */
+  Async
+};
+
+/**
+ Writes log messages to os_log on Apple platforms, to the Android log on
+ Android and to stderr elsewhere. Use the WKT_LOG_* macros instead of calling
+ write directly so that disabled levels compile to nothing.
+ */
+class Log {
+public:
+  static void setMode(LogMode mode) {
+    getMode().store(mode, std::memory_order_relaxed);
+  }
+
+#if defined(__GNUC__)
+  __attribute__((format(printf, 2, 3)))
+#endif
+  static void
+  write(LogLevel level, const char *format, ...) {
+    Message message;
+    message.level = level;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(message.text, sizeof(message.text), format, args);
+    va_end(args);
+
+    if (getMode().load(std::memory_order_relaxed) == LogMode::Sync) {
+      writeToPlatform(level, message.text);
+    } else {
+      getAsyncSink().post(std::move(message));
+    }
+  }
+
+private:
+  struct Message {
+    LogLevel level = LogLevel::Info;
+    // Longer messages are truncated
+    char text[256] = {0};
+  };
+
+  /**
+   Background thread writing queued messages. Messages logged while the
+   queue is full are dropped and counted.
+   */
+  class AsyncSink {
+  public:
+    AsyncSink()
+        : _buffer(256, RingBufferMode::MultiProducerMultiConsumer),
+          _thread([this]() { run(); }) {}
+
+    void post(Message &&message) {
+      if (!_buffer.tryPush(std::move(message))) {
+        _dropped++;
+        return;
+      }
+      _cond.notify_one();
+    }
+
+  private:
+    void run() {
+      while (true) {
+        Message message;
+        while (_buffer.tryPop(message)) {
+          writeToPlatform(message.level, message.text);
+        }
+        auto dropped = _dropped.exchange(0);
+        if (dropped > 0) {
+          std::snprintf(message.text, sizeof(message.text),
+                        "%zu log messages dropped", dropped);
+          writeToPlatform(LogLevel::Warn, message.text);
+        }
+        // Producers notify without taking the mutex, so a wake up can be
+        // missed. The timeout bounds how late such a message is written.
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait_for(lock, std::chrono::milliseconds(100));
+      }
+    }
+
+    RingBuffer<Message> _buffer;
+    std::atomic<size_t> _dropped = {0};
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    // Last so that it starts after the other members are initialized
+    std::thread _thread;
+  };
+
+  static void writeToPlatform(LogLevel level, const char *text) {
+#if defined(__APPLE__)
+    static os_log_t log = os_log_create("react-native-worklets-core", "log");
+    os_log_type_t type = level == LogLevel::Error  ? OS_LOG_TYPE_ERROR
+                         : level == LogLevel::Warn ? OS_LOG_TYPE_DEFAULT
+                         : level == LogLevel::Info ? OS_LOG_TYPE_INFO
+                                                   : OS_LOG_TYPE_DEBUG;
+    os_log_with_type(log, type, "%{public}s", text);
+#elif defined(ANDROID)
+    int priority = level == LogLevel::Error  ? ANDROID_LOG_ERROR
+                   : level == LogLevel::Warn ? ANDROID_LOG_WARN
+                   : level == LogLevel::Info ? ANDROID_LOG_INFO
+                   : level == LogLevel::Debug ? ANDROID_LOG_DEBUG
+                                              : ANDROID_LOG_VERBOSE;
+    __android_log_print(priority, "RNWorklets", "%s", text);
+#else
+    (void)level;
+    std::fprintf(stderr, "[RNWorklets] %s\n", text);
+#endif
+  }
+
+  static std::atomic<LogMode> &getMode() {
+    static std::atomic<LogMode> mode = {LogMode::Async};
+    return mode;
+  }
+
+  static AsyncSink &getAsyncSink() {
+    // Never destroyed, so that messages logged while exiting are safe
+    static AsyncSink *sink = new AsyncSink();
+    return *sink;
+  }
+};
+
+} // namespace RNWorklet
+
+#if WKT_LOG_LEVEL <= WKT_LOG_LEVEL_VERBOSE
+#define WKT_LOG_VERBOSE(fmt, ...)                                              \
+  ::RNWorklet::Log::write(::RNWorklet::LogLevel::Verbose, fmt, ##__VA_ARGS__)
+#else
+#define WKT_LOG_VERBOSE(fmt, ...) ((void)0)
+#endif
+
+#if WKT_LOG_LEVEL <= WKT_LOG_LEVEL_DEBUG
+#define WKT_LOG_DEBUG(fmt, ...)                                                \
+  ::RNWorklet::Log::write(::RNWorklet::LogLevel::Debug, fmt, ##__VA_ARGS__)
+#else
+#define WKT_LOG_DEBUG(fmt, ...) ((void)0)
+#endif
+
+#if WKT_LOG_LEVEL <= WKT_LOG_LEVEL_INFO
+#define WKT_LOG_INFO(fmt, ...)                                                 \
+  ::RNWorklet::Log::write(::RNWorklet::LogLevel::Info, fmt, ##__VA_ARGS__)
+#else
+#define WKT_LOG_INFO(fmt, ...) ((void)0)
+#endif
+
+#if WKT_LOG_LEVEL <= WKT_LOG_LEVEL_WARN
+#define WKT_LOG_WARN(fmt, ...)                                                 \
+  ::RNWorklet::Log::write(::RNWorklet::LogLevel::Warn, fmt, ##__VA_ARGS__)
+#else
+#define WKT_LOG_WARN(fmt, ...) ((void)0)
+#endif
+
+#if WKT_LOG_LEVEL <= WKT_LOG_LEVEL_ERROR
+#define WKT_LOG_ERROR(fmt, ...)                                                \
+  ::RNWorklet::Log::write(::RNWorklet::LogLevel::Error, fmt, ##__VA_ARGS__)
+#else
+#define WKT_LOG_ERROR(fmt, ...) ((void)0)
+#endif
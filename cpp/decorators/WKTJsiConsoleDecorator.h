@@ -1,12 +1,17 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
 #include <memory>
 #include <string>
+#include <utility>
 
-#include "WKTArgumentsWrapper.h"
 #include "WKTJsiBaseDecorator.h"
 #include "WKTJsiHostObject.h"
-#include "WKTJsiWrapper.h"
+#include "WKTJsiWorkletContext.h"
+#include "WKTRingBuffer.h"
 #include <jsi/jsi.h>
 
 namespace RNWorklet {
@@ -15,101 +20,223 @@ namespace jsi = facebook::jsi;
 
 static const char *PropNameConsole = "console";
 
+/**
+ Console levels, messages below the level set with setLevel are dropped
+ before their arguments are formatted
+ */
+enum class ConsoleLevel { Log = 0, Info = 1, Warn = 2, Error = 3, None = 4 };
+
+static const std::array<std::pair<ConsoleLevel, const char *>, 5>
+    ConsoleLevelNames = {{{ConsoleLevel::Log, "log"},
+                          {ConsoleLevel::Info, "info"},
+                          {ConsoleLevel::Warn, "warn"},
+                          {ConsoleLevel::Error, "error"},
+                          {ConsoleLevel::None, "none"}}};
+
+/**
+ Formats console arguments into a single string on the logging thread, so
+ that no values have to be copied to the JS thread. Nested values are
+ limited in depth and count, and messages are truncated at MaxLength.
+ */
+class JsiConsoleFormatter {
+public:
+  static constexpr int MaxDepth = 3;
+  static constexpr size_t MaxItems = 50;
+  static constexpr size_t MaxLength = 4096;
+
+  static std::string format(jsi::Runtime &runtime, const jsi::Value *arguments,
+                            size_t count) {
+    std::string result;
+    for (size_t i = 0; i < count && result.size() < MaxLength; i++) {
+      if (i > 0) {
+        result += ' ';
+      }
+      // Strings are printed as is at the top level, like console does
+      if (arguments[i].isString()) {
+        result += arguments[i].asString(runtime).utf8(runtime);
+      } else {
+        append(runtime, arguments[i], 0, result);
+      }
+    }
+    truncate(result);
+    return result;
+  }
+
+private:
+  /**
+   Truncates text longer than MaxLength and marks it with an ellipsis. The
+   cut is moved back to the start of a code point so that no UTF-8 sequence
+   is split.
+   */
+  static void truncate(std::string &text) {
+    if (text.size() <= MaxLength) {
+      return;
+    }
+    auto length = MaxLength;
+    // Continuation bytes are 0b10xxxxxx
+    while (length > 0 && (static_cast<unsigned char>(text[length]) & 0xC0) ==
+                             0x80) {
+      length--;
+    }
+    text.resize(length);
+    text += "...";
+  }
+
+  static void append(jsi::Runtime &runtime, const jsi::Value &value, int depth,
+                     std::string &result) {
+    if (result.size() >= MaxLength) {
+      return;
+    }
+    if (value.isUndefined()) {
+      result += "undefined";
+    } else if (value.isNull()) {
+      result += "null";
+    } else if (value.isBool()) {
+      result += value.getBool() ? "true" : "false";
+    } else if (value.isNumber()) {
+      appendNumber(value.getNumber(), result);
+    } else if (value.isString()) {
+      result += '"';
+      result += value.asString(runtime).utf8(runtime);
+      result += '"';
+      truncate(result);
+    } else if (value.isObject()) {
+      appendObject(runtime, value.asObject(runtime), depth, result);
+    } else {
+      result += value.toString(runtime).utf8(runtime);
+      truncate(result);
+    }
+  }
+
+  static void appendNumber(double number, std::string &result) {
+    if (std::isnan(number)) {
+      result += "NaN";
+    } else if (std::isinf(number)) {
+      result += number > 0 ? "Infinity" : "-Infinity";
+    } else if (number == std::floor(number) && std::fabs(number) < 1e15) {
+      result += std::to_string(static_cast<int64_t>(number));
+    } else {
+      char buffer[32];
+      std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+      result += buffer;
+    }
+  }
+
+  static void appendObject(jsi::Runtime &runtime, const jsi::Object &object,
+                           int depth, std::string &result) {
+    if (object.isFunction(runtime)) {
+      auto name = object.getProperty(runtime, "name");
+      result += "[Function";
+      if (name.isString()) {
+        auto nameStr = name.asString(runtime).utf8(runtime);
+        result += nameStr.empty() ? "" : " " + nameStr;
+      }
+      result += "]";
+      return;
+    }
+
+    // Errors have no enumerable properties, print their stack instead
+    auto stack = object.getProperty(runtime, "stack");
+    if (stack.isString() && object.hasProperty(runtime, "message")) {
+      result += stack.asString(runtime).utf8(runtime);
+      truncate(result);
+      return;
+    }
+
+    if (object.isArray(runtime)) {
+      if (depth >= MaxDepth) {
+        result += "[Array]";
+        return;
+      }
+      auto array = object.asArray(runtime);
+      auto size = array.size(runtime);
+      result += "[";
+      for (size_t i = 0; i < size && i < MaxItems; i++) {
+        result += i > 0 ? ", " : "";
+        append(runtime, array.getValueAtIndex(runtime, i), depth + 1, result);
+      }
+      if (size > MaxItems) {
+        result += ", ... " + std::to_string(size - MaxItems) + " more items";
+      }
+      result += "]";
+      return;
+    }
+
+    if (depth >= MaxDepth) {
+      result += "[Object]";
+      return;
+    }
+    auto names = object.getPropertyNames(runtime);
+    auto size = names.size(runtime);
+    if (size == 0) {
+      result += "{}";
+      return;
+    }
+    result += "{ ";
+    for (size_t i = 0; i < size && i < MaxItems; i++) {
+      auto name = names.getValueAtIndex(runtime, i).asString(runtime);
+      result += i > 0 ? ", " : "";
+      result += name.utf8(runtime) + ": ";
+      append(runtime,
+             object.getProperty(runtime, jsi::PropNameID::forString(runtime,
+                                                                    name)),
+             depth + 1, result);
+    }
+    if (size > MaxItems) {
+      result += ", ... " + std::to_string(size - MaxItems) + " more keys";
+    }
+    result += " }";
+  }
+};
+
+/**
+ Console installed in worklet runtimes. Messages are formatted on the
+ worklet thread and queued in a ring shared by the context's runtimes, which
+ is flushed to the JS console in batches. Messages logged while the ring is
+ full are dropped and reported with the next flush.
+ */
 class JsiConsoleImpl : public JsiHostObject,
                        public std::enable_shared_from_this<JsiConsoleImpl> {
 public:
+  static constexpr size_t RingCapacity = 512;
+
   JsiConsoleImpl(jsi::Runtime &runtime, const jsi::Value &consoleObj)
       : _consoleObj(consoleObj.asObject(runtime)),
         _logFn(_consoleObj.getPropertyAsFunction(runtime, "log")),
-        _infoFn(_consoleObj.getPropertyAsFunction(runtime, "info")),
         _warnFn(_consoleObj.getPropertyAsFunction(runtime, "warn")),
-        _errorFn(_consoleObj.getPropertyAsFunction(runtime, "error")) {}
+        _infoFn(_consoleObj.getPropertyAsFunction(runtime, "info")),
+        _errorFn(_consoleObj.getPropertyAsFunction(runtime, "error")),
+        _ring(RingCapacity, RingBufferMode::MultiProducerMultiConsumer) {}
+
+  /**
+   Sets the lowest level that is logged by worklet consoles
+   */
+  static void setLevel(ConsoleLevel level) {
+    getLevel().store(level, std::memory_order_relaxed);
+  }
+
+  static std::atomic<ConsoleLevel> &getLevel() {
+    static std::atomic<ConsoleLevel> level = {ConsoleLevel::Log};
+    return level;
+  }
 
   JSI_HOST_FUNCTION(log) {
-    ArgumentsWrapper argsWrapper(runtime, arguments, count);
-    auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
-    JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
-        [weakSelf = weak_from_this(), argsWrapper, thisWrapper,
-         count](jsi::Runtime &runtime) {
-          auto args = argsWrapper.getArguments(runtime);
-          auto self = weakSelf.lock();
-          if (self) {
-            if (thisWrapper->getType() == JsiWrapperType::Object) {
-              auto thisObject = thisWrapper->unwrap(runtime);
-              self->_logFn.callWithThis(runtime, thisObject.asObject(runtime),
-                                        ArgumentsWrapper::toArgs(args), count);
-            } else {
-              self->_logFn.call(runtime, ArgumentsWrapper::toArgs(args), count);
-            }
-          }
-        });
+    post(runtime, ConsoleLevel::Log, arguments, count);
     return jsi::Value::undefined();
   }
 
   JSI_HOST_FUNCTION(warn) {
-    ArgumentsWrapper argsWrapper(runtime, arguments, count);
-    auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
-    JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
-        [weakSelf = weak_from_this(), argsWrapper, thisWrapper,
-         count](jsi::Runtime &runtime) {
-          auto args = argsWrapper.getArguments(runtime);
-          auto self = weakSelf.lock();
-          if (self) {
-            if (thisWrapper->getType() == JsiWrapperType::Object) {
-              auto thisObject = thisWrapper->unwrap(runtime);
-              self->_warnFn.callWithThis(runtime, thisObject.asObject(runtime),
-                                         ArgumentsWrapper::toArgs(args), count);
-            } else {
-              self->_warnFn.call(runtime, ArgumentsWrapper::toArgs(args),
-                                 count);
-            }
-          }
-        });
+    post(runtime, ConsoleLevel::Warn, arguments, count);
     return jsi::Value::undefined();
   }
 
   JSI_HOST_FUNCTION(error) {
-    ArgumentsWrapper argsWrapper(runtime, arguments, count);
-    auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
-    JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
-        [weakSelf = weak_from_this(), argsWrapper, thisWrapper,
-         count](jsi::Runtime &runtime) {
-          auto args = argsWrapper.getArguments(runtime);
-          auto self = weakSelf.lock();
-          if (self) {
-            if (thisWrapper->getType() == JsiWrapperType::Object) {
-              auto thisObject = thisWrapper->unwrap(runtime);
-              self->_errorFn.callWithThis(runtime, thisObject.asObject(runtime),
-                                          ArgumentsWrapper::toArgs(args),
-                                          count);
-            } else {
-              self->_errorFn.call(runtime, ArgumentsWrapper::toArgs(args),
-                                  count);
-            }
-          }
-        });
+    post(runtime, ConsoleLevel::Error, arguments, count);
     return jsi::Value::undefined();
   }
 
   JSI_HOST_FUNCTION(info) {
-    ArgumentsWrapper argsWrapper(runtime, arguments, count);
-    auto thisWrapper = JsiWrapper::wrap(runtime, thisValue);
-    JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
-        [weakSelf = weak_from_this(), argsWrapper, thisWrapper,
-         count](jsi::Runtime &runtime) {
-          auto args = argsWrapper.getArguments(runtime);
-          auto self = weakSelf.lock();
-          if (self) {
-            if (thisWrapper->getType() == JsiWrapperType::Object) {
-              auto thisObject = thisWrapper->unwrap(runtime);
-              self->_infoFn.callWithThis(runtime, thisObject.asObject(runtime),
-                                         ArgumentsWrapper::toArgs(args), count);
-            } else {
-              self->_infoFn.call(runtime, ArgumentsWrapper::toArgs(args),
-                                 count);
-            }
-          }
-        });
+    post(runtime, ConsoleLevel::Info, arguments, count);
     return jsi::Value::undefined();
   }
 
@@ -119,11 +246,74 @@ public:
                        JSI_EXPORT_FUNC(JsiConsoleImpl, info))
 
 private:
+  struct Message {
+    ConsoleLevel level = ConsoleLevel::Log;
+    std::string text;
+  };
+
+  void post(jsi::Runtime &runtime, ConsoleLevel level,
+            const jsi::Value *arguments, size_t count) {
+    if (level < getLevel().load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    Message message;
+    message.level = level;
+    message.text = JsiConsoleFormatter::format(runtime, arguments, count);
+    if (!_ring.tryPush(std::move(message))) {
+      _dropped++;
+    }
+
+    // One flush is scheduled at a time, it picks up everything queued
+    // before it runs
+    if (!_flushScheduled.exchange(true)) {
+      JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
+          [weakSelf = weak_from_this()](jsi::Runtime &runtime) {
+            auto self = weakSelf.lock();
+            if (self) {
+              self->flush(runtime);
+            }
+          });
+    }
+  }
+
+  void flush(jsi::Runtime &runtime) {
+    _flushScheduled.store(false);
+    Message message;
+    while (_ring.tryPop(message)) {
+      getFunction(message.level)
+          .call(runtime, jsi::String::createFromUtf8(runtime, message.text));
+    }
+    auto dropped = _dropped.exchange(0);
+    if (dropped > 0) {
+      _warnFn.call(runtime, jsi::String::createFromUtf8(
+                                runtime, std::to_string(dropped) +
+                                             " worklet console messages were "
+                                             "dropped."));
+    }
+  }
+
+  jsi::Function &getFunction(ConsoleLevel level) {
+    switch (level) {
+    case ConsoleLevel::Info:
+      return _infoFn;
+    case ConsoleLevel::Warn:
+      return _warnFn;
+    case ConsoleLevel::Error:
+      return _errorFn;
+    default:
+      return _logFn;
+    }
+  }
+
   jsi::Object _consoleObj;
   jsi::Function _logFn;
   jsi::Function _warnFn;
   jsi::Function _infoFn;
   jsi::Function _errorFn;
+  RingBuffer<Message> _ring;
+  std::atomic<size_t> _dropped = {0};
+  std::atomic<bool> _flushScheduled = {false};
 };
 
 /**
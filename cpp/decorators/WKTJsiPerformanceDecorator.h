@@ -6,6 +6,7 @@
 
 #include "WKTJsiBaseDecorator.h"
 #include "WKTJsiHostObject.h"
+#include "WKTJsiWorkletTrace.h"
 #include "WKTJsiWrapper.h"
 #include <jsi/jsi.h>
 
@@ -27,7 +28,19 @@ public:
     return jsi::Value(duration / NANOSECONDS_IN_MILLISECOND);
   }
 
-  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiPerformanceImpl, now))
+  JSI_HOST_FUNCTION(getWorkletEntries) {
+    return JsiWorkletTrace::getEntries(runtime);
+  }
+
+  JSI_HOST_FUNCTION(clearWorkletEntries) {
+    JsiWorkletTrace::getBuffer().clear();
+    return jsi::Value::undefined();
+  }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiPerformanceImpl, now),
+                       JSI_EXPORT_FUNC(JsiPerformanceImpl, getWorkletEntries),
+                       JSI_EXPORT_FUNC(JsiPerformanceImpl,
+                                       clearWorkletEntries))
 };
 
 /**
@@ -6,6 +6,7 @@
 
 #include "WKTJsiBaseDecorator.h"
 #include "WKTJsiWrapper.h"
+#include "WKTLog.h"
 #include <jsi/jsi.h>
 
 namespace RNWorklet {
@@ -79,17 +80,19 @@ public:
           auto context = JsiWorkletContext::getCurrent(runtime);
           if (context) {
             // Invoke function on context thread / runtime
-            context->invokeOnWorkletThread(
+            context->invokeOnWorkletRuntime(
+                runtime,
                 [dispatcher](JsiWorkletContext *context,
                              jsi::Runtime &runtime) {
-                  printf("ctx %lu: setImmediate\n", context->getContextId());
+                  WKT_LOG_VERBOSE("ctx %zu: setImmediate",
+                                  context->getContextId());
                   dispatcher(runtime);
                 });
           } else {
             // Invoke function in JS thread / runtime
             JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
                 [dispatcher](jsi::Runtime &runtime) {
-                  printf("ctx -1: setImmediate\n");
+                  WKT_LOG_VERBOSE("ctx -1: setImmediate");
                   dispatcher(runtime);
                 });
           }
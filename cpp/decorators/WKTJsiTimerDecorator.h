@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "WKTDispatchTimer.h"
+#include "WKTJsiBaseDecorator.h"
+#include "WKTJsiHostObject.h"
+#include "WKTJsiWorkletContext.h"
+#include "WKTLog.h"
+#include <jsi/jsi.h>
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+static const char *PropNameSetTimeout = "setTimeout";
+static const char *PropNameSetInterval = "setInterval";
+static const char *PropNameClearTimeout = "clearTimeout";
+static const char *PropNameClearInterval = "clearInterval";
+static const char *PropNameRequestAnimationFrame = "requestAnimationFrame";
+static const char *PropNameCancelAnimationFrame = "cancelAnimationFrame";
+
+/**
+ Timers and animation frame callbacks of a single worklet runtime. The
+ callbacks stay in their runtime, the context's DispatchTimer only holds the
+ deadlines and posts back to the runtime's thread when they expire. Must
+ only be used on the runtime's thread.
+ */
+class JsiWorkletTimers {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  /**
+   Frame interval used by requestAnimationFrame. Frames are aligned to
+   multiples of the interval on the steady clock, so all worklet runtimes
+   see the same frames.
+   */
+  static constexpr std::chrono::nanoseconds FrameInterval =
+      std::chrono::nanoseconds(1000000000 / 60);
+
+  /**
+   Largest delay accepted by setTimeout and setInterval, larger delays run
+   immediately like in browsers
+   */
+  static constexpr double MaxDelay = 2147483647;
+
+  /**
+   Returns the timers of the calling worklet runtime and sets context to
+   the runtime's context
+   */
+  static std::shared_ptr<JsiWorkletTimers>
+  get(jsi::Runtime &runtime, JsiWorkletContext *&context, const char *name) {
+    context = JsiWorkletContext::getCurrent(runtime);
+    auto timers = context ? context->getWorkletTimers(runtime) : nullptr;
+    if (!timers) {
+      throw jsi::JSError(runtime, std::string(name) +
+                                      " can only be called in a worklet "
+                                      "context.");
+    }
+    return timers;
+  }
+
+  /**
+   Returns the callback passed as the first argument
+   */
+  static jsi::Function getCallback(jsi::Runtime &runtime,
+                                   const jsi::Value *arguments, size_t count,
+                                   const char *name) {
+    if (count == 0 || !arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime, std::string(name) +
+                                      " expects a function as its first "
+                                      "parameter");
+    }
+    return arguments[0].asObject(runtime).asFunction(runtime);
+  }
+
+  /**
+   Starts a timer calling the callback with the arguments after delay
+   milliseconds, and every delay milliseconds after that if it repeats
+   @returns Id for clearTimer
+   */
+  double setTimer(JsiWorkletContext *context, jsi::Runtime &runtime,
+                  jsi::Function &&callback, std::vector<jsi::Value> &&args,
+                  double delay, bool repeats) {
+    if (std::isnan(delay) || delay < 0 || delay > MaxDelay) {
+      delay = 0;
+    }
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(delay));
+    if (repeats) {
+      // Intervals of zero would repost themselves without ever sleeping
+      interval = std::max<Clock::duration>(interval,
+                                           std::chrono::milliseconds(1));
+    }
+
+    auto id = _nextId++;
+    auto timer = std::make_shared<Timer>(Timer{std::move(callback),
+                                               std::move(args), interval,
+                                               Clock::now() + interval, 0,
+                                               repeats});
+    _timers.emplace(id, timer);
+    schedule(context, runtime, id, *timer);
+    return static_cast<double>(id);
+  }
+
+  /**
+   Stops a timer started with setTimer, unknown ids are ignored
+   */
+  void clearTimer(JsiWorkletContext *context, double id) {
+    auto it = _timers.find(static_cast<uint64_t>(id));
+    if (it == _timers.end()) {
+      return;
+    }
+    context->getDispatchTimer()->cancel(it->second->dispatchId);
+    _timers.erase(it);
+  }
+
+  /**
+   Calls the callback with the frame time on the next frame
+   @returns Id for cancelAnimationFrame
+   */
+  double requestAnimationFrame(JsiWorkletContext *context,
+                               jsi::Runtime &runtime,
+                               jsi::Function &&callback) {
+    auto id = _nextId++;
+    _frameCallbacks.emplace_back(
+        id, std::make_shared<jsi::Function>(std::move(callback)));
+    if (!_frameScheduled) {
+      _frameScheduled = true;
+      auto now = Clock::now().time_since_epoch();
+      auto frame = Clock::time_point(
+          std::chrono::duration_cast<Clock::duration>(
+              (now / FrameInterval + 1) * FrameInterval));
+      dispatchAt(context, runtime, frame,
+                 [frame](JsiWorkletTimers &timers, JsiWorkletContext *context,
+                         jsi::Runtime &runtime) {
+                   timers.fireFrame(context, runtime, frame);
+                 });
+    }
+    return static_cast<double>(id);
+  }
+
+  /**
+   Removes a callback added with requestAnimationFrame, unknown ids are
+   ignored
+   */
+  void cancelAnimationFrame(double id) {
+    auto key = static_cast<uint64_t>(id);
+    _frameCallbacks.erase(
+        std::remove_if(_frameCallbacks.begin(), _frameCallbacks.end(),
+                       [key](const FrameCallback &frameCallback) {
+                         return frameCallback.first == key;
+                       }),
+        _frameCallbacks.end());
+  }
+
+private:
+  struct Timer {
+    jsi::Function callback;
+    std::vector<jsi::Value> args;
+    Clock::duration interval;
+    Clock::time_point deadline;
+    uint64_t dispatchId;
+    bool repeats;
+  };
+
+  typedef std::pair<uint64_t, std::shared_ptr<jsi::Function>> FrameCallback;
+  typedef std::function<void(JsiWorkletTimers &timers,
+                             JsiWorkletContext *context,
+                             jsi::Runtime &runtime)>
+      fire_t;
+
+  void schedule(JsiWorkletContext *context, jsi::Runtime &runtime,
+                uint64_t id, Timer &timer) {
+    timer.dispatchId = dispatchAt(
+        context, runtime, timer.deadline,
+        [id](JsiWorkletTimers &timers, JsiWorkletContext *context,
+             jsi::Runtime &runtime) { timers.fire(context, runtime, id); });
+  }
+
+  // Runs fire on the runtime's thread once the deadline has passed
+  static uint64_t dispatchAt(JsiWorkletContext *context,
+                             jsi::Runtime &runtime, Clock::time_point deadline,
+                             fire_t &&fire) {
+    std::weak_ptr<JsiWorkletContext> weakContext = context->shared_from_this();
+    auto runtimePtr = &runtime;
+    return context->getDispatchTimer()->dispatchAt(
+        deadline, [weakContext, runtimePtr, fire = std::move(fire)]() {
+          auto context = weakContext.lock();
+          if (context) {
+            context->invokeOnWorkletRuntime(
+                *runtimePtr,
+                [fire](JsiWorkletContext *context, jsi::Runtime &runtime) {
+                  auto timers = context->getWorkletTimers(runtime);
+                  if (timers) {
+                    fire(*timers, context, runtime);
+                  }
+                });
+          }
+        });
+  }
+
+  void fire(JsiWorkletContext *context, jsi::Runtime &runtime, uint64_t id) {
+    auto it = _timers.find(id);
+    if (it == _timers.end()) {
+      // Cleared after the deadline passed
+      return;
+    }
+    // Hold on to the timer, the callback might clear it
+    auto timer = it->second;
+    if (timer->repeats) {
+      // Stay on the interval's schedule, skipping intervals we fell behind on
+      timer->deadline += timer->interval;
+      auto now = Clock::now();
+      if (timer->deadline <= now) {
+        timer->deadline +=
+            ((now - timer->deadline) / timer->interval + 1) * timer->interval;
+      }
+      schedule(context, runtime, id, *timer);
+    } else {
+      _timers.erase(it);
+    }
+
+    WKT_LOG_VERBOSE("ctx %zu: timer %llu", context->getContextId(),
+                    static_cast<unsigned long long>(id));
+    call(runtime, timer->callback,
+         static_cast<const jsi::Value *>(timer->args.data()),
+         timer->args.size());
+  }
+
+  void fireFrame(JsiWorkletContext *context, jsi::Runtime &runtime,
+                 Clock::time_point frame) {
+    // Callbacks requested from these callbacks run on the next frame
+    _frameScheduled = false;
+    std::vector<FrameCallback> callbacks;
+    callbacks.swap(_frameCallbacks);
+
+    // Same time base as performance.now
+    auto timestamp = jsi::Value(
+        std::chrono::duration<double, std::milli>(frame.time_since_epoch())
+            .count());
+    for (auto &callback : callbacks) {
+      call(runtime, *callback.second, &timestamp, 1);
+    }
+  }
+
+  static void call(jsi::Runtime &runtime, jsi::Function &callback,
+                   const jsi::Value *args, size_t count) {
+    try {
+      callback.call(runtime, args, count);
+    } catch (const jsi::JSError &err) {
+      reportError(err.getMessage());
+    } catch (const std::exception &err) {
+      reportError(err.what());
+    } catch (...) {
+      reportError("Unknown error in timer callback.");
+    }
+  }
+
+  static void reportError(const std::string &message) {
+    JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
+        [message](jsi::Runtime &runtime) {
+          throw jsi::JSError(runtime, message);
+        });
+  }
+
+  std::unordered_map<uint64_t, std::shared_ptr<Timer>> _timers;
+  std::vector<FrameCallback> _frameCallbacks;
+  bool _frameScheduled = false;
+  uint64_t _nextId = 1;
+};
+
+/**
+ Decorator for setTimeout, setInterval, clearTimeout and clearInterval
+ Timers are driven by the context's DispatchTimer, so waiting for a timer
+ never keeps a worklet thread busy.
+ */
+class JsiTimerDecorator : public JsiBaseDecorator {
+public:
+  void decorateRuntime(jsi::Runtime &runtime) override {
+    install(runtime, PropNameSetTimeout, 2, createSetTimer(false));
+    install(runtime, PropNameSetInterval, 2, createSetTimer(true));
+    install(runtime, PropNameClearTimeout, 1,
+            createClearTimer(PropNameClearTimeout));
+    install(runtime, PropNameClearInterval, 1,
+            createClearTimer(PropNameClearInterval));
+  };
+
+  static void install(jsi::Runtime &runtime, const char *name,
+                      unsigned int paramCount, jsi::HostFunctionType &&func) {
+    runtime.global().setProperty(
+        runtime, name,
+        jsi::Function::createFromHostFunction(
+            runtime, jsi::PropNameID::forUtf8(runtime, name), paramCount,
+            std::move(func)));
+  }
+
+private:
+  static jsi::HostFunctionType createSetTimer(bool repeats) {
+    return JSI_HOST_FUNCTION_LAMBDA {
+      auto name = repeats ? PropNameSetInterval : PropNameSetTimeout;
+      JsiWorkletContext *context = nullptr;
+      auto timers = JsiWorkletTimers::get(runtime, context, name);
+      auto callback =
+          JsiWorkletTimers::getCallback(runtime, arguments, count, name);
+      auto delay = count > 1 && arguments[1].isNumber()
+                       ? arguments[1].getNumber()
+                       : 0;
+
+      // Arguments stay in this runtime, so there is no need to wrap them
+      std::vector<jsi::Value> args;
+      for (size_t i = 2; i < count; i++) {
+        args.emplace_back(runtime, arguments[i]);
+      }
+      return timers->setTimer(context, runtime, std::move(callback),
+                              std::move(args), delay, repeats);
+    };
+  }
+
+  static jsi::HostFunctionType createClearTimer(const char *name) {
+    return JSI_HOST_FUNCTION_LAMBDA {
+      JsiWorkletContext *context = nullptr;
+      auto timers = JsiWorkletTimers::get(runtime, context, name);
+      if (count > 0 && arguments[0].isNumber()) {
+        timers->clearTimer(context, arguments[0].getNumber());
+      }
+      return jsi::Value::undefined();
+    };
+  }
+};
+
+/**
+ Decorator for requestAnimationFrame and cancelAnimationFrame
+ */
+class JsiAnimationFrameDecorator : public JsiBaseDecorator {
+public:
+  void decorateRuntime(jsi::Runtime &runtime) override {
+    JsiTimerDecorator::install(
+        runtime, PropNameRequestAnimationFrame, 1, JSI_HOST_FUNCTION_LAMBDA {
+          JsiWorkletContext *context = nullptr;
+          auto timers = JsiWorkletTimers::get(runtime, context,
+                                              PropNameRequestAnimationFrame);
+          auto callback = JsiWorkletTimers::getCallback(
+              runtime, arguments, count, PropNameRequestAnimationFrame);
+          return timers->requestAnimationFrame(context, runtime,
+                                               std::move(callback));
+        });
+    JsiTimerDecorator::install(
+        runtime, PropNameCancelAnimationFrame, 1, JSI_HOST_FUNCTION_LAMBDA {
+          JsiWorkletContext *context = nullptr;
+          auto timers = JsiWorkletTimers::get(runtime, context,
+                                              PropNameCancelAnimationFrame);
+          if (count > 0 && arguments[0].isNumber()) {
+            timers->cancelAnimationFrame(arguments[0].getNumber());
+          }
+          return jsi::Value::undefined();
+        });
+  };
+};
+} // namespace RNWorklet
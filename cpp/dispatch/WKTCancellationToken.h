@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+
+namespace RNWorklet {
+
+/**
+ Cancellation flag shared between the caller that dispatched a task and the
+ task. Queued tasks whose token is cancelled are skipped, running tasks can
+ check the token of the task running on their thread with getCurrent.
+ */
+class CancellationToken {
+public:
+  void cancel() { _cancelled.store(true, std::memory_order_release); }
+
+  bool isCancelled() const {
+    return _cancelled.load(std::memory_order_acquire);
+  }
+
+  /**
+   Returns the token of the task running on the calling thread, or nullptr
+   */
+  static CancellationToken *getCurrent() { return current(); }
+
+  /**
+   Sets the token of the task running on the calling thread while in scope
+   */
+  class Scope {
+  public:
+    explicit Scope(CancellationToken *token) : _previous(current()) {
+      current() = token;
+    }
+    ~Scope() { current() = _previous; }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    CancellationToken *_previous;
+  };
+
+private:
+  static CancellationToken *&current() {
+    static thread_local CancellationToken *token = nullptr;
+    return token;
+  }
+
+  std::atomic<bool> _cancelled = {false};
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,162 @@
+#include "WKTDispatchPool.h"
+
+#include <utility>
+
+namespace RNWorklet {
+
+static thread_local const void *currentPoolState = nullptr;
+static thread_local int currentWorkerIndex = -1;
+
+DispatchPool::DispatchPool(std::string name, size_t size,
+                           const DispatchThreadOptions &threadOptions)
+    : name_{std::move(name)}, state_{std::make_shared<State>()} {
+  for (size_t i = 0; i < std::max<size_t>(size, 1); i++) {
+    state_->workers.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < state_->workers.size(); i++) {
+    auto workerOptions = threadOptions;
+    workerOptions.name =
+        (threadOptions.name.empty() ? name_ : threadOptions.name) + "_" +
+        std::to_string(i);
+    state_->workers[i]->thread =
+        DispatchThread(workerOptions, [state = state_, i]() {
+          dispatch_thread_handler(state, i);
+        });
+  }
+}
+
+DispatchPool::~DispatchPool() {
+  // Signal to dispatch threads that it's time to wrap up
+  std::unique_lock<std::mutex> lock(state_->sleepLock);
+  state_->quit = true;
+  lock.unlock();
+  state_->cv.notify_all();
+
+  // Wait for threads to finish before we exit. If we're destroyed from one of
+  // our own workers that worker is detached and exits when its task returns.
+  for (auto &worker : state_->workers) {
+    if (worker->thread.isCurrentThread()) {
+      worker->thread.detach();
+    } else if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+int DispatchPool::getCurrentWorkerIndex() const {
+  return currentPoolState == state_.get() ? currentWorkerIndex : -1;
+}
+
+void DispatchPool::dispatch(fp_t &&op, DispatchPriority priority) {
+  auto &workers = state_->workers;
+
+  // Keep work queued from a worker on that worker, spread the rest
+  auto index = getCurrentWorkerIndex();
+  auto &worker = *workers[index >= 0 ? static_cast<size_t>(index)
+                                     : state_->nextWorker++ % workers.size()];
+  {
+    std::lock_guard<std::mutex> lock(worker.lock);
+    worker.tasks[static_cast<size_t>(priority)].push_back(std::move(op));
+    state_->pending++;
+  }
+
+  // Any worker can run this, so waking one is enough
+  notify(*state_, false);
+}
+
+void DispatchPool::dispatch(size_t workerIndex, fp_t &&op) {
+  auto &worker = *state_->workers.at(workerIndex);
+  {
+    std::lock_guard<std::mutex> lock(worker.lock);
+    worker.pinned.push(std::move(op));
+    worker.pinnedCount++;
+  }
+
+  // We can't choose which worker is woken up, so wake them all
+  notify(*state_, true);
+}
+
+void DispatchPool::notify(State &state, bool all) {
+  // Taking the sleep lock ensures that a worker is either waiting or will see
+  // the new work when it checks its wait predicate.
+  { std::lock_guard<std::mutex> lock(state.sleepLock); }
+  if (all) {
+    state.cv.notify_all();
+  } else {
+    state.cv.notify_one();
+  }
+}
+
+bool DispatchPool::tryPopPinned(State &state, size_t index, fp_t &op) {
+  auto &worker = *state.workers[index];
+  if (worker.pinnedCount == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(worker.lock);
+  if (!worker.pinned.empty()) {
+    op = std::move(worker.pinned.front());
+    worker.pinned.pop();
+    worker.pinnedCount--;
+    return true;
+  }
+  return false;
+}
+
+bool DispatchPool::tryPop(State &state, size_t index, size_t lane, fp_t &op) {
+  auto &worker = *state.workers[index];
+  std::lock_guard<std::mutex> lock(worker.lock);
+  auto &tasks = worker.tasks[lane];
+  if (!tasks.empty()) {
+    op = std::move(tasks.front());
+    tasks.pop_front();
+    state.pending--;
+    return true;
+  }
+  return false;
+}
+
+bool DispatchPool::trySteal(State &state, size_t index, size_t lane,
+                            fp_t &op) {
+  auto size = state.workers.size();
+  for (size_t i = 1; i < size; i++) {
+    auto &victim = *state.workers[(index + i) % size];
+    std::lock_guard<std::mutex> lock(victim.lock);
+    auto &tasks = victim.tasks[lane];
+    if (!tasks.empty()) {
+      op = std::move(tasks.back());
+      tasks.pop_back();
+      state.pending--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DispatchPool::dispatch_thread_handler(std::shared_ptr<State> state,
+                                           size_t index) {
+  currentPoolState = state.get();
+  currentWorkerIndex = static_cast<int>(index);
+  auto &worker = *state->workers[index];
+
+  while (!state->quit) {
+    // Pinned work first, then our own and other workers' work by priority
+    fp_t op;
+    auto found = tryPopPinned(*state, index, op);
+    for (size_t lane = 0; !found && lane < DispatchPriorityCount; lane++) {
+      found = tryPop(*state, index, lane, op) ||
+              trySteal(*state, index, lane, op);
+    }
+    if (found) {
+      auto opCopyThatWillBeDestroyedBeforeWeContinue = std::move(op);
+      opCopyThatWillBeDestroyedBeforeWeContinue();
+      continue;
+    }
+
+    // Wait until we have data or a quit signal
+    std::unique_lock<std::mutex> lock(state->sleepLock);
+    state->cv.wait(lock, [&] {
+      return state->quit || state->pending > 0 || worker.pinnedCount > 0;
+    });
+  }
+}
+} // namespace RNWorklet
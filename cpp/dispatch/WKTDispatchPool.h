@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "WKTDispatchQueue.h"
+#include "WKTDispatchThread.h"
+
+namespace RNWorklet {
+
+/**
+ A pool of worker threads sharing work through per-worker queues. Workers run
+ the work queued on themselves in order, and when they run out of work they
+ steal the most recently queued work from the other workers - which is the
+ work that would otherwise have to wait the longest.
+
+ Work can also be pinned to a given worker. Pinned work is never stolen and
+ is used for anything that touches state owned by that worker.
+
+ Unpinned work has a priority. Workers run and steal queued work of a higher
+ priority before work of a lower priority.
+ */
+class DispatchPool {
+  typedef std::function<void(void)> fp_t;
+
+public:
+  /**
+   @param threadOptions Applied to all workers, names get the worker index
+   appended
+   */
+  DispatchPool(std::string name, size_t size,
+               const DispatchThreadOptions &threadOptions = {});
+
+  ~DispatchPool();
+
+  // dispatch to any worker
+  void dispatch(fp_t &&op, DispatchPriority priority = DispatchPriority::Normal);
+
+  // dispatch to the worker with the given index
+  void dispatch(size_t workerIndex, fp_t &&op);
+
+  /**
+   Returns the number of worker threads in the pool
+   */
+  size_t getSize() const { return state_->workers.size(); }
+
+  /**
+   Returns the index of the calling thread in the pool, or -1 if the calling
+   thread is not one of the pool's workers.
+   */
+  int getCurrentWorkerIndex() const;
+
+  // Deleted operations
+  DispatchPool(const DispatchPool &rhs) = delete;
+
+  DispatchPool &operator=(const DispatchPool &rhs) = delete;
+
+  DispatchPool(DispatchPool &&rhs) = delete;
+
+  DispatchPool &operator=(DispatchPool &&rhs) = delete;
+
+private:
+  struct Worker {
+    std::mutex lock;
+    std::array<std::deque<fp_t>, DispatchPriorityCount> tasks;
+    std::queue<fp_t> pinned;
+    std::atomic<size_t> pinnedCount{0};
+    DispatchThread thread;
+  };
+
+  // State shared with the worker threads, so that a worker can outlive the
+  // pool if the pool is destroyed from one of its own tasks.
+  struct State {
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex sleepLock;
+    std::condition_variable cv;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> nextWorker{0};
+    std::atomic<bool> quit{false};
+  };
+
+  static bool tryPopPinned(State &state, size_t index, fp_t &op);
+  static bool tryPop(State &state, size_t index, size_t lane, fp_t &op);
+  static bool trySteal(State &state, size_t index, size_t lane, fp_t &op);
+  static void notify(State &state, bool all);
+  static void dispatch_thread_handler(std::shared_ptr<State> state,
+                                      size_t index);
+
+  std::string name_;
+  std::shared_ptr<State> state_;
+};
+} // namespace RNWorklet
@@ -1,57 +1,165 @@
 #include "WKTDispatchQueue.h"
 
+#include <algorithm>
 #include <utility>
 
 namespace RNWorklet {
 
+// Number of times the thread checks for new work before parking
+static const int LockFreeSpinCount = 128;
+// Max number of items run between each check of the quit flag
+static const int LockFreeBatchSize = 64;
+
+DispatchQueue::State::State(DispatchQueueMode mode) : mode{mode} {
+  if (mode == DispatchQueueMode::LockFree) {
+    for (size_t i = 0; i < DispatchPriorityCount; i++) {
+      tail[i] = new Node();
+      head[i].store(tail[i], std::memory_order_relaxed);
+    }
+  }
+}
+
+DispatchQueue::State::~State() {
+  // Release any work left in the lock-free queues
+  for (auto node : tail) {
+    while (node != nullptr) {
+      auto next = node->next.load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+}
+
 DispatchQueue::~DispatchQueue() {
   // Signal to dispatch threads that it's time to wrap up
-  std::unique_lock<std::mutex> lock(lock_);
-  quit_ = true;
+  std::unique_lock<std::mutex> lock(state_->lock);
+  state_->quit = true;
   lock.unlock();
-  cv_.notify_all();
+  state_->cv.notify_all();
 
-  // Wait for threads to finish before we exit
-  if (thread_.joinable()) {
+  // Wait for the thread to finish, unless we are destroyed from it. The
+  // thread then exits when its current work returns.
+  if (thread_.isCurrentThread()) {
+    thread_.detach();
+  } else if (thread_.joinable()) {
     thread_.join();
   }
 }
 
-DispatchQueue::DispatchQueue(std::string name) : name_{std::move(name)} {
-  thread_ = std::thread(&DispatchQueue::dispatch_thread_handler, this);
+DispatchQueue::DispatchQueue(std::string name, DispatchQueueMode mode,
+                             DispatchThreadOptions threadOptions)
+    : name_{std::move(name)}, mode_{mode},
+      state_{std::make_shared<State>(mode)} {
+  if (threadOptions.name.empty()) {
+    threadOptions.name = name_;
+  }
+  if (mode_ == DispatchQueueMode::LockFree) {
+    thread_ = DispatchThread(threadOptions, [state = state_]() {
+      lock_free_dispatch_thread_handler(state);
+    });
+  } else {
+    thread_ = DispatchThread(
+        threadOptions, [state = state_]() { dispatch_thread_handler(state); });
+  }
 }
 
-void DispatchQueue::dispatch(const fp_t &op) {
-  std::unique_lock<std::mutex> lock(lock_);
-  q_.push(op);
+void DispatchQueue::dispatch(const fp_t &op, DispatchPriority priority) {
+  if (mode_ == DispatchQueueMode::LockFree) {
+    push(fp_t(op), priority);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(state_->lock);
+  state_->q[static_cast<size_t>(priority)].push(op);
 
   // Manual unlocking is done before notifying, to avoid waking up
   // the waiting thread only to block again (see notify_one for details)
   lock.unlock();
-  cv_.notify_one();
+  state_->cv.notify_one();
 }
 
-void DispatchQueue::dispatch(fp_t &&op) {
-  std::unique_lock<std::mutex> lock(lock_);
-  q_.push(std::move(op));
+void DispatchQueue::dispatch(fp_t &&op, DispatchPriority priority) {
+  if (mode_ == DispatchQueueMode::LockFree) {
+    push(std::move(op), priority);
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(state_->lock);
+  state_->q[static_cast<size_t>(priority)].push(std::move(op));
 
   // Manual unlocking is done before notifying, to avoid waking up
   // the waiting thread only to block again (see notify_one for details)
   lock.unlock();
-  cv_.notify_one();
+  state_->cv.notify_one();
+}
+
+void DispatchQueue::push(fp_t &&op, DispatchPriority priority) {
+  auto node = new Node();
+  node->op = std::move(op);
+
+  // Swap in the node as the new head, then link the previous head to it. Until
+  // the link is stored the consumer sees the queue as empty.
+  auto prev = state_->head[static_cast<size_t>(priority)].exchange(
+      node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_seq_cst);
+
+  // Only wake the thread if it is parked (or about to park). Both the link
+  // above and this load are sequentially consistent, so either we see the
+  // thread sleeping or the thread sees our node before waiting.
+  if (state_->sleeping.load(std::memory_order_seq_cst)) {
+    { std::lock_guard<std::mutex> lock(state_->lock); }
+    state_->cv.notify_one();
+  }
+}
+
+bool DispatchQueue::tryPop(State &state, fp_t &op) {
+  // Highest priority first
+  for (auto &tail : state.tail) {
+    auto next = tail->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      op = std::move(next->op);
+      delete tail;
+      tail = next;
+      return true;
+    }
+  }
+  return false;
 }
 
-void DispatchQueue::dispatch_thread_handler(void) {
-  std::unique_lock<std::mutex> lock(lock_);
+bool DispatchQueue::hasPending(State &state) {
+  for (auto tail : state.tail) {
+    if (tail->next.load(std::memory_order_seq_cst) != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DispatchQueue::lockedHasPending(State &state) {
+  for (auto &q : state.q) {
+    if (!q.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void DispatchQueue::dispatch_thread_handler(std::shared_ptr<State> state) {
+  std::unique_lock<std::mutex> lock(state->lock);
 
   do {
     // Wait until we have data or a quit signal
-    cv_.wait(lock, [this] { return (q_.size() || quit_); });
+    state->cv.wait(lock, [&state] {
+      return (lockedHasPending(*state) || state->quit);
+    });
 
     // after wait, we own the lock
-    if (!quit_ && q_.size()) {
-      auto op = std::move(q_.front());
-      q_.pop();
+    if (!state->quit && lockedHasPending(*state)) {
+      // Highest priority first
+      auto &q = *std::find_if(state->q.begin(), state->q.end(),
+                              [](const std::queue<fp_t> &q) { return !q.empty(); });
+      auto op = std::move(q.front());
+      q.pop();
 
       // unlock now that we're done messing with the queue
       lock.unlock();
@@ -63,6 +171,45 @@ void DispatchQueue::dispatch_thread_handler(void) {
 
       lock.lock();
     }
-  } while (!quit_);
+  } while (!state->quit);
+}
+
+void DispatchQueue::lock_free_dispatch_thread_handler(
+    std::shared_ptr<State> state) {
+  while (!state->quit) {
+    // Drain a batch of work without touching any shared flags
+    fp_t op;
+    int ran = 0;
+    while (ran < LockFreeBatchSize && tryPop(*state, op)) {
+      {
+        auto opCopyThatWillBeDestroyedBeforeWeContinue = std::move(op);
+        opCopyThatWillBeDestroyedBeforeWeContinue();
+      }
+      ran++;
+    }
+    if (ran > 0) {
+      continue;
+    }
+
+    // Spin for a while - new work often arrives right after the last item
+    bool found = false;
+    for (int i = 0; i < LockFreeSpinCount && !state->quit; i++) {
+      if (hasPending(*state)) {
+        found = true;
+        break;
+      }
+      std::this_thread::yield();
+    }
+    if (found) {
+      continue;
+    }
+
+    // Park until we have data or a quit signal
+    std::unique_lock<std::mutex> lock(state->lock);
+    state->sleeping.store(true, std::memory_order_seq_cst);
+    state->cv.wait(lock,
+                   [&state] { return state->quit || hasPending(*state); });
+    state->sleeping.store(false, std::memory_order_relaxed);
+  }
 }
 } // namespace RNWorklet
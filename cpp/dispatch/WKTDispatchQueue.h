@@ -1,31 +1,63 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <cstdint>
 #include <cstdio>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "WKTDispatchThread.h"
+
 // https://github.com/embeddedartistry/embedded-resources/blob/master/examples/cpp/dispatch.cpp
 namespace RNWorklet {
 
+/**
+ How work is handed over from the dispatching threads to the queue's thread
+ */
+enum class DispatchQueueMode {
+  /**
+   Work is pushed on a std::queue guarded by a mutex
+   */
+  Locked,
+  /**
+   Work is pushed on a lock-free multi-producer / single-consumer queue. The
+   queue's thread spins briefly before parking, so dispatching to a busy queue
+   never takes a lock or wakes a thread.
+   */
+  LockFree
+};
+
+/**
+ Priority lane of dispatched work. Queued work in a higher lane always runs
+ before queued work in a lower lane, work within a lane runs in order.
+ */
+enum class DispatchPriority { High = 0, Normal = 1, Low = 2 };
+
+static const size_t DispatchPriorityCount = 3;
+
 class DispatchQueue {
   typedef std::function<void(void)> fp_t;
 
 public:
-  explicit DispatchQueue(std::string name);
+  explicit DispatchQueue(std::string name,
+                         DispatchQueueMode mode = DispatchQueueMode::Locked,
+                         DispatchThreadOptions threadOptions = {});
 
   ~DispatchQueue();
 
   // dispatch and copy
-  void dispatch(const fp_t &op);
+  void dispatch(const fp_t &op,
+                DispatchPriority priority = DispatchPriority::Normal);
 
   // dispatch and move
-  void dispatch(fp_t &&op);
+  void dispatch(fp_t &&op, DispatchPriority priority = DispatchPriority::Normal);
 
   // Deleted operations
   DispatchQueue(const DispatchQueue &rhs) = delete;
@@ -37,13 +69,43 @@ public:
   DispatchQueue &operator=(DispatchQueue &&rhs) = delete;
 
 private:
+  // Node in the lock-free queue
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    fp_t op;
+  };
+
+  // State shared with the thread, so that the queue can be destroyed from
+  // work running on its own thread.
+  struct State {
+    explicit State(DispatchQueueMode mode);
+    ~State();
+
+    DispatchQueueMode mode;
+    std::mutex lock;
+    std::array<std::queue<fp_t>, DispatchPriorityCount> q;
+    std::condition_variable cv;
+    std::atomic<bool> quit{false};
+
+    // Lock-free queues, one per priority. Producers push on head, the queue's
+    // thread is the only one reading from tail. tail always points to a
+    // consumed node whose next node is the next item to run.
+    std::array<std::atomic<Node *>, DispatchPriorityCount> head;
+    std::array<Node *, DispatchPriorityCount> tail{};
+    std::atomic<bool> sleeping{false};
+  };
+
   std::string name_;
-  std::mutex lock_;
-  std::thread thread_;
-  std::queue<fp_t> q_;
-  std::condition_variable cv_;
-  bool quit_ = false;
+  DispatchQueueMode mode_;
+  std::shared_ptr<State> state_;
+  DispatchThread thread_;
+
+  void push(fp_t &&op, DispatchPriority priority);
+  static bool tryPop(State &state, fp_t &op);
+  static bool hasPending(State &state);
+  static bool lockedHasPending(State &state);
 
-  void dispatch_thread_handler(void);
+  static void dispatch_thread_handler(std::shared_ptr<State> state);
+  static void lock_free_dispatch_thread_handler(std::shared_ptr<State> state);
 };
 } // namespace RNWorklet
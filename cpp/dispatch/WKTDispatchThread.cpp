@@ -0,0 +1,173 @@
+#include "WKTDispatchThread.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+#else
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "WKTLog.h"
+
+namespace RNWorklet {
+
+#if defined(__APPLE__)
+static qos_class_t toQoSClass(DispatchQoS qos) {
+  switch (qos) {
+  case DispatchQoS::Background:
+    return QOS_CLASS_BACKGROUND;
+  case DispatchQoS::Utility:
+    return QOS_CLASS_UTILITY;
+  case DispatchQoS::UserInitiated:
+    return QOS_CLASS_USER_INITIATED;
+  case DispatchQoS::UserInteractive:
+    return QOS_CLASS_USER_INTERACTIVE;
+  default:
+    return QOS_CLASS_DEFAULT;
+  }
+}
+#else
+// Same values as Android's THREAD_PRIORITY_* constants
+static int toNice(DispatchQoS qos) {
+  switch (qos) {
+  case DispatchQoS::Background:
+    return 10;
+  case DispatchQoS::Utility:
+    return 1;
+  case DispatchQoS::UserInitiated:
+    return -4;
+  case DispatchQoS::UserInteractive:
+    return -8;
+  default:
+    return 0;
+  }
+}
+#endif
+
+DispatchThread::DispatchThread(const DispatchThreadOptions &options,
+                               std::function<void()> &&fn) {
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  if (options.stackSize > 0) {
+    auto stackSize = std::max<size_t>(options.stackSize, PTHREAD_STACK_MIN);
+    if (pthread_attr_setstacksize(&attr, stackSize) != 0) {
+      WKT_LOG_WARN("Could not set the stack size of thread %s to %zu",
+                   options.name.c_str(), stackSize);
+    }
+  }
+#if defined(__APPLE__)
+  if (options.qos != DispatchQoS::Default) {
+    pthread_attr_set_qos_class_np(&attr, toQoSClass(options.qos), 0);
+  }
+#endif
+
+  auto start = new Start{options, std::move(fn)};
+  auto result = pthread_create(&thread_, &attr, &DispatchThread::run, start);
+  pthread_attr_destroy(&attr);
+  if (result != 0) {
+    delete start;
+    throw std::runtime_error("Could not start thread " + options.name + ": " +
+                             std::strerror(result));
+  }
+  joinable_ = true;
+}
+
+DispatchThread::~DispatchThread() {
+  // Unlike std::thread a thread that is still running is not fatal, it is
+  // left to finish on its own
+  detach();
+}
+
+DispatchThread::DispatchThread(DispatchThread &&rhs) noexcept
+    : thread_{rhs.thread_}, joinable_{rhs.joinable_} {
+  rhs.joinable_ = false;
+}
+
+DispatchThread &DispatchThread::operator=(DispatchThread &&rhs) noexcept {
+  if (this != &rhs) {
+    detach();
+    thread_ = rhs.thread_;
+    joinable_ = rhs.joinable_;
+    rhs.joinable_ = false;
+  }
+  return *this;
+}
+
+void DispatchThread::join() {
+  if (joinable_) {
+    pthread_join(thread_, nullptr);
+    joinable_ = false;
+  }
+}
+
+void DispatchThread::detach() {
+  if (joinable_) {
+    pthread_detach(thread_);
+    joinable_ = false;
+  }
+}
+
+bool DispatchThread::isCurrentThread() const {
+  return joinable_ && pthread_equal(thread_, pthread_self()) != 0;
+}
+
+void *DispatchThread::run(void *arg) {
+  auto start = static_cast<Start *>(arg);
+  applyToCurrentThread(start->options);
+  auto fn = std::move(start->fn);
+  delete start;
+  fn();
+  return nullptr;
+}
+
+void DispatchThread::setCurrentThreadName(const std::string &name) {
+#if defined(__APPLE__)
+  pthread_setname_np(name.c_str());
+#else
+  // Names are limited to 16 bytes including the terminator
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+}
+
+void DispatchThread::applyToCurrentThread(
+    const DispatchThreadOptions &options) {
+  if (!options.name.empty()) {
+    setCurrentThreadName(options.name);
+  }
+#if defined(__APPLE__)
+  // QoS is set on the thread attributes, and there is no affinity API
+#else
+
+  if (options.nice.has_value() || options.qos != DispatchQoS::Default) {
+    auto nice = options.nice.value_or(toNice(options.qos));
+    auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, nice) != 0) {
+      WKT_LOG_WARN("Could not set the nice value of thread %s to %d",
+                   options.name.c_str(), nice);
+    }
+  }
+
+  if (options.affinityMask != 0) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (size_t i = 0; i < 64 && i < CPU_SETSIZE; i++) {
+      if (options.affinityMask & (uint64_t(1) << i)) {
+        CPU_SET(i, &cpuSet);
+      }
+    }
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+      WKT_LOG_WARN("Could not set the core affinity of thread %s",
+                   options.name.c_str());
+    }
+  }
+#endif
+}
+} // namespace RNWorklet
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+
+namespace RNWorklet {
+
+/**
+ Quality of service of a dispatch thread. Maps to the pthread QoS classes on
+ Apple platforms and to nice values on Android and Linux.
+ */
+enum class DispatchQoS {
+  Default,
+  Background,
+  Utility,
+  UserInitiated,
+  UserInteractive
+};
+
+/**
+ Scheduling options applied to dispatch threads when they start
+ */
+struct DispatchThreadOptions {
+  /**
+   Thread name, defaults to the name of the queue or pool. Android and Linux
+   keep the first 15 characters.
+   */
+  std::string name;
+  DispatchQoS qos = DispatchQoS::Default;
+  /**
+   Nice value on Android and Linux, overrides the value derived from qos.
+   Ignored on Apple platforms.
+   */
+  std::optional<int> nice;
+  /**
+   Stack size in bytes, 0 for the platform default
+   */
+  size_t stackSize = 0;
+  /**
+   Cores the thread may run on, bit i allows core i. 0 allows all cores.
+   Ignored on Apple platforms, which have no affinity API.
+   */
+  uint64_t affinityMask = 0;
+
+  /**
+   Returns true if all options have their default values
+   */
+  bool isDefault() const {
+    return name.empty() && qos == DispatchQoS::Default && !nice.has_value() &&
+           stackSize == 0 && affinityMask == 0;
+  }
+};
+
+/**
+ A joinable pthread started with DispatchThreadOptions. Used instead of
+ std::thread, which can't set a stack size or a QoS class before the thread
+ starts.
+ */
+class DispatchThread {
+public:
+  DispatchThread() = default;
+
+  /**
+   Starts a thread running fn
+   */
+  DispatchThread(const DispatchThreadOptions &options,
+                 std::function<void()> &&fn);
+
+  ~DispatchThread();
+
+  DispatchThread(DispatchThread &&rhs) noexcept;
+  DispatchThread &operator=(DispatchThread &&rhs) noexcept;
+
+  DispatchThread(const DispatchThread &rhs) = delete;
+  DispatchThread &operator=(const DispatchThread &rhs) = delete;
+
+  bool joinable() const { return joinable_; }
+
+  void join();
+
+  void detach();
+
+  /**
+   Returns true if called from this thread
+   */
+  bool isCurrentThread() const;
+
+  /**
+   Renames the calling thread. Android and Linux keep the first 15
+   characters.
+   */
+  static void setCurrentThreadName(const std::string &name);
+
+private:
+  struct Start {
+    DispatchThreadOptions options;
+    std::function<void()> fn;
+  };
+
+  static void *run(void *arg);
+
+  // Applied from the new thread, before it runs any work
+  static void applyToCurrentThread(const DispatchThreadOptions &options);
+
+  pthread_t thread_{};
+  bool joinable_ = false;
+};
+} // namespace RNWorklet
@@ -0,0 +1,82 @@
+#include "WKTDispatchTimer.h"
+
+#include <utility>
+#include <vector>
+
+namespace RNWorklet {
+
+DispatchTimer::DispatchTimer(std::string name,
+                             DispatchThreadOptions threadOptions)
+    : name_{std::move(name)}, state_{std::make_shared<State>()} {
+  if (threadOptions.name.empty()) {
+    threadOptions.name = name_;
+  }
+  thread_ = DispatchThread(threadOptions, [state = state_]() {
+    dispatch_thread_handler(state);
+  });
+}
+
+DispatchTimer::~DispatchTimer() {
+  // Signal to the thread that it's time to wrap up
+  std::unique_lock<std::mutex> lock(state_->lock);
+  state_->quit = true;
+  lock.unlock();
+  state_->cv.notify_all();
+
+  // Wait for the thread to finish, unless we are destroyed from it
+  if (thread_.isCurrentThread()) {
+    thread_.detach();
+  } else if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+uint64_t DispatchTimer::dispatchAt(Clock::time_point deadline, fp_t &&op) {
+  std::unique_lock<std::mutex> lock(state_->lock);
+  auto id = state_->nextId++;
+  state_->wheel.schedule(id, deadline, std::move(op));
+
+  // Only wake the thread if it sleeps past the new deadline
+  auto wake = deadline < state_->wakeUp;
+  lock.unlock();
+  if (wake) {
+    state_->cv.notify_one();
+  }
+  return id;
+}
+
+bool DispatchTimer::cancel(uint64_t id) {
+  std::lock_guard<std::mutex> lock(state_->lock);
+  return state_->wheel.cancel(id);
+}
+
+void DispatchTimer::dispatch_thread_handler(std::shared_ptr<State> state) {
+  std::unique_lock<std::mutex> lock(state->lock);
+  std::vector<fp_t> expired;
+
+  while (!state->quit) {
+    state->wheel.advance(Clock::now(), expired);
+    if (!expired.empty()) {
+      // Run work without holding the lock, it may schedule more work
+      lock.unlock();
+      for (auto &op : expired) {
+        op();
+      }
+      expired.clear();
+      lock.lock();
+      continue;
+    }
+
+    // Sleep until the next deadline or until an earlier one is added
+    auto next = state->wheel.getNextDeadline();
+    if (next.has_value()) {
+      state->wakeUp = *next;
+      state->cv.wait_until(lock, *next);
+    } else {
+      state->wakeUp = Clock::time_point::max();
+      state->cv.wait(lock);
+    }
+    state->wakeUp = Clock::time_point::max();
+  }
+}
+} // namespace RNWorklet
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "WKTDispatchThread.h"
+#include "WKTTimerWheel.h"
+
+namespace RNWorklet {
+
+/**
+ Runs work at given deadlines on a thread that sleeps until the next
+ deadline. Work should be short - it usually just dispatches the actual
+ work to another queue - since all deadlines share the one thread.
+ */
+class DispatchTimer {
+  typedef std::function<void(void)> fp_t;
+
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit DispatchTimer(std::string name,
+                         DispatchThreadOptions threadOptions = {});
+
+  ~DispatchTimer();
+
+  /**
+   Runs op at or after the deadline
+   @returns Id for cancelling the work, never 0
+   */
+  uint64_t dispatchAt(Clock::time_point deadline, fp_t &&op);
+
+  /**
+   Cancels work that has not started yet, returns false if the work has
+   already run or is running.
+   */
+  bool cancel(uint64_t id);
+
+  // Deleted operations
+  DispatchTimer(const DispatchTimer &rhs) = delete;
+
+  DispatchTimer &operator=(const DispatchTimer &rhs) = delete;
+
+  DispatchTimer(DispatchTimer &&rhs) = delete;
+
+  DispatchTimer &operator=(DispatchTimer &&rhs) = delete;
+
+private:
+  // State shared with the thread, so that the timer can be destroyed from
+  // work running on its own thread.
+  struct State {
+    std::mutex lock;
+    std::condition_variable cv;
+    TimerWheel<fp_t> wheel;
+    uint64_t nextId = 1;
+    // Deadline the thread sleeps until, max while it sleeps without one
+    Clock::time_point wakeUp = Clock::time_point::max();
+    bool quit = false;
+  };
+
+  static void dispatch_thread_handler(std::shared_ptr<State> state);
+
+  std::string name_;
+  std::shared_ptr<State> state_;
+  DispatchThread thread_;
+};
+} // namespace RNWorklet
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace RNWorklet {
+
+/**
+ Which threads can use a ring buffer at the same time
+ */
+enum class RingBufferMode {
+  /**
+   One thread pushing and one thread popping at a time
+   */
+  SingleProducerSingleConsumer,
+  /**
+   Any number of threads pushing and popping
+   */
+  MultiProducerMultiConsumer
+};
+
+/**
+ Bounded lock-free ring buffer. Each cell has a sequence number telling
+ producers and consumers whether it is free or filled for their position
+ (Vyukov's bounded queue). In single producer / single consumer mode the
+ positions are advanced with plain stores instead of compare and swap.
+ */
+template <typename T> class RingBuffer {
+public:
+  /**
+   Constructor
+   @param capacity Min number of items, rounded up to a power of two
+   @param mode Which threads can use the buffer at the same time
+   */
+  RingBuffer(size_t capacity, RingBufferMode mode) : _mode(mode) {
+    size_t size = 2;
+    while (size < capacity) {
+      size *= 2;
+    }
+    _mask = size - 1;
+    _cells = std::unique_ptr<Cell[]>(new Cell[size]);
+    for (size_t i = 0; i < size; i++) {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  /**
+   Pushes the item, returns false if the buffer is full
+   */
+  bool tryPush(T &&item) {
+    auto pos = _enqueuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &_cells[pos & _mask];
+      auto sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (_mode == RingBufferMode::SingleProducerSingleConsumer) {
+          _enqueuePos.store(pos + 1, std::memory_order_relaxed);
+          break;
+        }
+        if (_enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->item = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   Pops an item, returns false if the buffer is empty
+   */
+  bool tryPop(T &item) {
+    auto pos = _dequeuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &_cells[pos & _mask];
+      auto sequence = cell->sequence.load(std::memory_order_acquire);
+      auto diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (_mode == RingBufferMode::SingleProducerSingleConsumer) {
+          _dequeuePos.store(pos + 1, std::memory_order_relaxed);
+          break;
+        }
+        if (_dequeuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = _dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+    item = std::move(cell->item);
+    cell->item = T();
+    cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   Returns the number of items in the buffer. Only a snapshot while other
+   threads push or pop.
+   */
+  size_t size() const {
+    auto enqueuePos = _enqueuePos.load(std::memory_order_acquire);
+    auto dequeuePos = _dequeuePos.load(std::memory_order_acquire);
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+  }
+
+  /**
+   Returns true if the item at the consumer position has been pushed. Unlike
+   size this doesn't count items that producers are still writing, so a
+   single consumer can rely on the next tryPop succeeding.
+   */
+  bool canPop() const {
+    auto pos = _dequeuePos.load(std::memory_order_acquire);
+    auto sequence =
+        _cells[pos & _mask].sequence.load(std::memory_order_acquire);
+    return sequence == pos + 1;
+  }
+
+  /**
+   Returns the max number of items in the buffer
+   */
+  size_t capacity() const { return _mask + 1; }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  RingBufferMode _mode;
+  size_t _mask;
+  std::unique_ptr<Cell[]> _cells;
+  // Producer and consumer positions on separate cache lines
+  alignas(64) std::atomic<size_t> _enqueuePos = {0};
+  alignas(64) std::atomic<size_t> _dequeuePos = {0};
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace RNWorklet {
+
+/**
+ Hierarchical timer wheel with a resolution of one millisecond. Level 0 has
+ one slot per tick, each higher level has slots covering the whole level
+ below it. Timers are placed on the lowest level that can hold their delay
+ and cascade down a level each time the wheel wraps around to their slot,
+ so scheduling, cancelling and expiring are all constant time.
+
+ Cancelled timers are removed lazily when their slot is reached. The wheel
+ is not thread safe.
+ */
+template <typename T> class TimerWheel {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr size_t SlotBits = 6;
+  static constexpr size_t SlotCount = static_cast<size_t>(1) << SlotBits;
+  static constexpr size_t LevelCount = 4;
+
+  /**
+   @param start Time of tick 0, deadlines before it expire on the first
+   advance
+   */
+  explicit TimerWheel(Clock::time_point start = Clock::now())
+      : _start(start) {}
+
+  /**
+   Schedules a timer, replacing any timer with the same id. Timers never
+   expire before their deadline, which is rounded up to the next tick.
+   */
+  void schedule(uint64_t id, Clock::time_point deadline, T &&value) {
+    auto tick = toTick(deadline, true);
+    auto &timer = _timers[id];
+    timer.tick = tick;
+    timer.value = std::move(value);
+    place(Entry{id, tick});
+  }
+
+  /**
+   Cancels a timer, returns false if there is no timer with the id
+   */
+  bool cancel(uint64_t id) {
+    if (_timers.erase(id) == 0) {
+      return false;
+    }
+    if (_timers.empty()) {
+      clearSlots();
+    }
+    return true;
+  }
+
+  /**
+   Returns the number of scheduled timers
+   */
+  size_t size() const { return _timers.size(); }
+
+  bool empty() const { return _timers.empty(); }
+
+  /**
+   Expires all timers with a deadline at or before now, appending their
+   values to expired in deadline order
+   */
+  void advance(Clock::time_point now, std::vector<T> &expired) {
+    if (!_due.empty()) {
+      std::vector<Entry> entries;
+      entries.swap(_due);
+      expire(entries, expired);
+    }
+    auto nowTick = toTick(now, false);
+    while (_tick <= nowTick) {
+      if (_timers.empty()) {
+        clearSlots();
+        _tick = nowTick + 1;
+        break;
+      }
+      // Skip ticks where nothing expires or cascades
+      auto next = getNextTick();
+      if (next > nowTick) {
+        _tick = nowTick + 1;
+        break;
+      }
+      _tick = next;
+      processTick(expired);
+      _tick++;
+    }
+  }
+
+  /**
+   Returns when advance should be called next, or nullopt if no timers are
+   scheduled. For timers on higher levels this is the time they cascade,
+   which is at or before their deadline.
+   */
+  std::optional<Clock::time_point> getNextDeadline() const {
+    if (_timers.empty()) {
+      return std::nullopt;
+    }
+    if (!_due.empty()) {
+      return _start;
+    }
+    return _start + std::chrono::milliseconds(getNextTick());
+  }
+
+private:
+  static constexpr uint64_t SlotMask = SlotCount - 1;
+  static constexpr uint64_t MaxDelay =
+      (static_cast<uint64_t>(1) << (SlotBits * LevelCount)) - 1;
+
+  struct Entry {
+    uint64_t id;
+    uint64_t tick;
+  };
+
+  struct Timer {
+    uint64_t tick = 0;
+    T value;
+  };
+
+  uint64_t toTick(Clock::time_point time, bool roundUp) const {
+    if (time <= _start) {
+      return 0;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       time - _start)
+                       .count();
+    auto tick = static_cast<uint64_t>(elapsed / 1000000);
+    if (roundUp && elapsed % 1000000 != 0) {
+      tick++;
+    }
+    return tick;
+  }
+
+  bool isLive(const Entry &entry) const {
+    auto it = _timers.find(entry.id);
+    return it != _timers.end() && it->second.tick == entry.tick;
+  }
+
+  void place(const Entry &entry) {
+    if (entry.tick < _tick) {
+      // Deadline is on a tick that has already been processed
+      _due.push_back(entry);
+      return;
+    }
+    // Timers further out than the top level can reach are parked at its
+    // end and placed again when they cascade
+    auto delay = std::min(entry.tick - _tick, MaxDelay);
+    size_t level = 0;
+    while (level + 1 < LevelCount &&
+           delay >= (static_cast<uint64_t>(1) << (SlotBits * (level + 1)))) {
+      level++;
+    }
+    auto index = ((_tick + delay) >> (SlotBits * level)) & SlotMask;
+    _slots[level][index].push_back(entry);
+  }
+
+  void cascade(size_t level, size_t index) {
+    std::vector<Entry> entries;
+    entries.swap(_slots[level][index]);
+    for (auto &entry : entries) {
+      if (isLive(entry)) {
+        place(entry);
+      }
+    }
+  }
+
+  void processTick(std::vector<T> &expired) {
+    for (auto level = LevelCount - 1; level > 0; level--) {
+      auto shift = SlotBits * level;
+      if ((_tick & ((static_cast<uint64_t>(1) << shift) - 1)) == 0) {
+        cascade(level, (_tick >> shift) & SlotMask);
+      }
+    }
+
+    std::vector<Entry> entries;
+    entries.swap(_slots[0][_tick & SlotMask]);
+    expire(entries, expired);
+  }
+
+  void expire(const std::vector<Entry> &entries, std::vector<T> &expired) {
+    for (auto &entry : entries) {
+      auto it = _timers.find(entry.id);
+      if (it != _timers.end() && it->second.tick == entry.tick) {
+        expired.push_back(std::move(it->second.value));
+        _timers.erase(it);
+      }
+    }
+  }
+
+  // First tick at or after _tick where a slot expires or cascades
+  uint64_t getNextTick() const {
+    auto next = UINT64_MAX;
+    for (uint64_t i = 0; i < SlotCount; i++) {
+      if (!_slots[0][(_tick + i) & SlotMask].empty()) {
+        next = _tick + i;
+        break;
+      }
+    }
+    for (size_t level = 1; level < LevelCount; level++) {
+      auto shift = SlotBits * level;
+      auto first = (_tick + (static_cast<uint64_t>(1) << shift) - 1) >> shift;
+      for (uint64_t index = 0; index < SlotCount; index++) {
+        if (!_slots[level][index].empty()) {
+          auto turn = first + ((index - first) & SlotMask);
+          next = std::min(next, turn << shift);
+        }
+      }
+    }
+    return next;
+  }
+
+  void clearSlots() {
+    _due.clear();
+    for (auto &level : _slots) {
+      for (auto &slot : level) {
+        slot.clear();
+      }
+    }
+  }
+
+  Clock::time_point _start;
+  // Next tick to process
+  uint64_t _tick = 0;
+  std::unordered_map<uint64_t, Timer> _timers;
+  // Timers scheduled on ticks before _tick, expired on the next advance
+  std::vector<Entry> _due;
+  std::array<std::array<std::vector<Entry>, SlotCount>, LevelCount> _slots;
+};
+} // namespace RNWorklet
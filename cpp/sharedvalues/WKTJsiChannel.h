@@ -0,0 +1,235 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "WKTJsiHostObject.h"
+#include "WKTJsiSerializer.h"
+#include "WKTJsiWorklet.h"
+#include "WKTJsiWorkletContext.h"
+#include "WKTRingBuffer.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Bounded channel for streaming values between contexts. Values are serialized
+ into a lock-free ring buffer on push and deserialized into the popping
+ runtime. A consumer worklet can be set to be woken up in its context when
+ values arrive, with all values pushed since its last call.
+ */
+class JsiChannel : public JsiHostObject,
+                   public std::enable_shared_from_this<JsiChannel> {
+public:
+  /**
+   Constructor
+   @param capacity Min number of values in the channel
+   @param mode Which threads can push and pop at the same time
+   */
+  JsiChannel(size_t capacity, RingBufferMode mode)
+      : _buffer(capacity, mode) {}
+
+  /**
+   Pushes the value, returns false if the channel is full
+   */
+  bool push(jsi::Runtime &runtime, const jsi::Value &value) {
+    if (!_buffer.tryPush(
+            std::make_shared<JsiSerializedValues>(runtime, &value, 1))) {
+      _dropped++;
+      return false;
+    }
+    auto consumer = std::atomic_load(&_consumer);
+    if (consumer != nullptr &&
+        !_wakePending.exchange(true, std::memory_order_seq_cst)) {
+      wake(consumer);
+    }
+    return true;
+  }
+
+  JSI_HOST_FUNCTION(push) {
+    if (count == 0) {
+      throw jsi::JSError(runtime, "push expects a value.");
+    }
+    return push(runtime, arguments[0]);
+  }
+
+  JSI_HOST_FUNCTION(tryPop) {
+    std::shared_ptr<JsiSerializedValues> item;
+    if (!_buffer.tryPop(item)) {
+      return jsi::Value::undefined();
+    }
+    return std::move(item->deserialize(runtime).at(0));
+  }
+
+  JSI_HOST_FUNCTION(popBatch) {
+    size_t maxCount = _buffer.capacity();
+    if (count > 0 && !arguments[0].isUndefined()) {
+      if (!arguments[0].isNumber() || arguments[0].asNumber() < 0) {
+        throw jsi::JSError(runtime,
+                           "popBatch expects a non-negative number.");
+      }
+      maxCount = static_cast<size_t>(arguments[0].asNumber());
+    }
+    return popBatch(runtime, maxCount);
+  }
+
+  JSI_HOST_FUNCTION(setConsumer) {
+    if (count == 0 || arguments[0].isUndefined() || arguments[0].isNull()) {
+      std::atomic_store(&_consumer, std::shared_ptr<Consumer>());
+      return jsi::Value::undefined();
+    }
+
+    if (!arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime, "setConsumer expects a worklet function.");
+    }
+    auto func = std::make_shared<jsi::Function>(
+        arguments[0].asObject(runtime).asFunction(runtime));
+    if (!JsiWorklet::isDecoratedAsWorklet(runtime, func)) {
+      throw jsi::JSError(runtime, "setConsumer expects a worklet function, "
+                                  "the function is not a worklet.");
+    }
+
+    // Consumers without a context run on the JS thread
+    std::shared_ptr<JsiWorkletContext> context;
+    if (count >= 2 && arguments[1].isObject()) {
+      context =
+          arguments[1].asObject(runtime).getHostObject<JsiWorkletContext>(
+              runtime);
+      if (context == nullptr) {
+        throw jsi::JSError(runtime, "setConsumer called with invalid context.");
+      }
+    }
+
+    auto consumer = std::make_shared<Consumer>();
+    consumer->workletInvoker =
+        std::make_shared<WorkletInvoker>(runtime, arguments[0]);
+    consumer->context = context;
+    std::atomic_store(&_consumer, consumer);
+
+    // Deliver values pushed before the consumer was set
+    if (_buffer.size() > 0 &&
+        !_wakePending.exchange(true, std::memory_order_seq_cst)) {
+      wake(consumer);
+    }
+    return jsi::Value::undefined();
+  }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiChannel, push),
+                       JSI_EXPORT_FUNC(JsiChannel, tryPop),
+                       JSI_EXPORT_FUNC(JsiChannel, popBatch),
+                       JSI_EXPORT_FUNC(JsiChannel, setConsumer))
+
+  JSI_PROPERTY_GET(size) { return static_cast<double>(_buffer.size()); }
+
+  JSI_PROPERTY_GET(capacity) {
+    return static_cast<double>(_buffer.capacity());
+  }
+
+  JSI_PROPERTY_GET(dropped) { return static_cast<double>(_dropped.load()); }
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiChannel, size),
+                              JSI_EXPORT_PROP_GET(JsiChannel, capacity),
+                              JSI_EXPORT_PROP_GET(JsiChannel, dropped))
+
+private:
+  struct Consumer {
+    std::shared_ptr<WorkletInvoker> workletInvoker;
+    std::shared_ptr<JsiWorkletContext> context;
+  };
+
+  /**
+   Pops up to maxCount values into an array
+   */
+  jsi::Array popBatch(jsi::Runtime &runtime, size_t maxCount) {
+    std::vector<jsi::Value> values;
+    std::shared_ptr<JsiSerializedValues> item;
+    while (values.size() < maxCount && _buffer.tryPop(item)) {
+      values.push_back(std::move(item->deserialize(runtime).at(0)));
+    }
+    auto array = jsi::Array(runtime, values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+      array.setValueAtIndex(runtime, i, std::move(values[i]));
+    }
+    return array;
+  }
+
+  /**
+   Schedules the consumer in its context
+   */
+  void wake(std::shared_ptr<Consumer> consumer) {
+    auto weakSelf = weak_from_this();
+    auto deliver = [weakSelf, consumer](jsi::Runtime &runtime) {
+      auto self = weakSelf.lock();
+      if (self) {
+        self->deliver(runtime, consumer);
+      }
+    };
+    if (consumer->context != nullptr) {
+      consumer->context->invokeOnWorkletThread(
+          [deliver](JsiWorkletContext *, jsi::Runtime &runtime) {
+            deliver(runtime);
+          });
+    } else {
+      JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(deliver);
+    }
+  }
+
+  /**
+   Calls the consumer with the values in the channel until it is empty. Only
+   the delivery holding the wake flag pops, so there is never more than one
+   consumer popping even if the context runs on a pool.
+   */
+  void deliver(jsi::Runtime &runtime, std::shared_ptr<Consumer> consumer) {
+    do {
+      // Items still being pushed are not popped, their producer wakes the
+      // consumer again once the flag below is cleared
+      while (true) {
+        auto values = popBatch(runtime, _buffer.capacity());
+        if (values.size(runtime) == 0) {
+          break;
+        }
+        call(runtime, consumer, jsi::Value(std::move(values)));
+      }
+      // Cleared last, a push that saw the flag still set before this is
+      // picked up by the check below
+      _wakePending.store(false, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    } while (_buffer.canPop() &&
+             !_wakePending.exchange(true, std::memory_order_seq_cst));
+  }
+
+  static void call(jsi::Runtime &runtime, std::shared_ptr<Consumer> consumer,
+                   const jsi::Value &values) {
+    try {
+      consumer->workletInvoker->call(runtime, jsi::Value::undefined(), &values,
+                                     1);
+    } catch (const jsi::JSError &err) {
+      reportError(err.getMessage());
+    } catch (const std::exception &err) {
+      reportError(err.what());
+    } catch (...) {
+      reportError("Unknown error in channel consumer.");
+    }
+  }
+
+  static void reportError(const std::string &message) {
+    JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
+        [message](jsi::Runtime &runtime) {
+          throw jsi::JSError(runtime, message);
+        });
+  }
+
+  RingBuffer<std::shared_ptr<JsiSerializedValues>> _buffer;
+  std::shared_ptr<Consumer> _consumer;
+  std::atomic<bool> _wakePending = {false};
+  std::atomic<size_t> _dropped = {0};
+};
+
+} // namespace RNWorklet
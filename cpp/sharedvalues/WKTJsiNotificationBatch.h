@@ -0,0 +1,176 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+class JsiBatchedListener;
+
+/**
+ Collects change notifications raised on the current thread while a batch is
+ active, and delivers them once per listener when the outermost batch ends.
+ */
+class JsiNotificationBatch {
+public:
+  /**
+   Begins a batch for the lifetime of the scope
+   */
+  class Scope {
+  public:
+    Scope() { JsiNotificationBatch::begin(); }
+    ~Scope() { JsiNotificationBatch::end(); }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  };
+
+  /**
+   Returns true if a batch is active on the calling thread
+   */
+  static bool isActive() { return getState().depth > 0; }
+
+  /**
+   Adds changed paths for a listener to the active batch
+   */
+  static void add(const std::shared_ptr<JsiBatchedListener> &listener,
+                  const std::vector<std::string> &changedPaths) {
+    auto &state = getState();
+    auto it = state.lookup.find(listener.get());
+    if (it == state.lookup.end()) {
+      it = state.lookup.emplace(listener.get(), state.pending.size()).first;
+      state.pending.emplace_back(listener, std::set<std::string>());
+    }
+    auto &paths = state.pending.at(it->second).second;
+    paths.insert(changedPaths.begin(), changedPaths.end());
+  }
+
+  static void begin() { getState().depth++; }
+
+  static void end();
+
+private:
+  struct State {
+    int depth = 0;
+    std::vector<
+        std::pair<std::weak_ptr<JsiBatchedListener>, std::set<std::string>>>
+        pending;
+    std::map<const JsiBatchedListener *, size_t> lookup;
+  };
+
+  static State &getState() {
+    static thread_local State state;
+    return state;
+  }
+};
+
+/**
+ Listener that coalesces notifications. Immediate listeners are called on
+ every change, unless a batch is active on the writing thread. Deferred
+ listeners only collect the changed paths and schedule a single flush, so
+ many writes within one tick result in one call.
+ */
+class JsiBatchedListener
+    : public std::enable_shared_from_this<JsiBatchedListener> {
+public:
+  typedef std::function<void(std::function<void()> &&)> scheduler_t;
+
+  /**
+   Creates a listener
+   @param callback Callback receiving the changed paths
+   @param scheduler Used for scheduling flushes of deferred listeners, or
+   nullptr for immediate listeners.
+   */
+  JsiBatchedListener(JsiWrapperListener callback, scheduler_t scheduler)
+      : _callback(std::move(callback)), _scheduler(std::move(scheduler)) {}
+
+  /**
+   Called when the value changes
+   */
+  void onChanged(const std::vector<std::string> &changedPaths) {
+    if (_scheduler) {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _pending.insert(changedPaths.begin(), changedPaths.end());
+      if (_isScheduled) {
+        return;
+      }
+      _isScheduled = true;
+      lock.unlock();
+
+      std::weak_ptr<JsiBatchedListener> weakSelf = shared_from_this();
+      _scheduler([weakSelf]() {
+        auto self = weakSelf.lock();
+        if (self) {
+          self->flush();
+        }
+      });
+      return;
+    }
+
+    if (JsiNotificationBatch::isActive()) {
+      JsiNotificationBatch::add(shared_from_this(), changedPaths);
+      return;
+    }
+
+    _callback(changedPaths);
+  }
+
+  /**
+   Delivers the changed paths to the callback
+   */
+  void deliver(const std::set<std::string> &changedPaths) {
+    _callback(
+        std::vector<std::string>(changedPaths.begin(), changedPaths.end()));
+  }
+
+  /**
+   Delivers pending paths of a deferred listener
+   */
+  void flush() {
+    std::set<std::string> pending;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      pending.swap(_pending);
+      _isScheduled = false;
+    }
+    if (!pending.empty()) {
+      deliver(pending);
+    }
+  }
+
+private:
+  JsiWrapperListener _callback;
+  scheduler_t _scheduler;
+  std::mutex _mutex;
+  std::set<std::string> _pending;
+  bool _isScheduled = false;
+};
+
+inline void JsiNotificationBatch::end() {
+  auto &state = getState();
+  if (--state.depth > 0) {
+    return;
+  }
+
+  // Listeners can write to shared values again, so take the pending list
+  // before delivering.
+  auto pending = std::move(state.pending);
+  state.pending.clear();
+  state.lookup.clear();
+  for (auto &entry : pending) {
+    auto listener = entry.first.lock();
+    if (listener) {
+      listener->deliver(entry.second);
+    }
+  }
+}
+
+} // namespace RNWorklet
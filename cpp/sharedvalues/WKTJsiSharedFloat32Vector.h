@@ -0,0 +1,254 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "WKTJsiArrayBufferWrapper.h"
+#include "WKTJsiHostObject.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ A fixed size vector of floats shared between runtimes and native code.
+ Elements are read and written without allocating. Whole vectors are
+ guarded by a sequence lock, so readers never block and always see all
+ elements of one write.
+ */
+class JsiSharedFloat32Vector : public JsiHostObject {
+public:
+  explicit JsiSharedFloat32Vector(size_t size)
+      : _size(size), _values(new std::atomic<float>[size]) {
+    for (size_t i = 0; i < size; i++) {
+      _values[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   Returns the vector held by the value, or nullptr if the value is not a
+   shared vector
+   */
+  static std::shared_ptr<JsiSharedFloat32Vector>
+  fromValue(jsi::Runtime &runtime, const jsi::Value &value) {
+    if (!value.isObject()) {
+      return nullptr;
+    }
+    auto object = value.asObject(runtime);
+    if (!object.isHostObject<JsiSharedFloat32Vector>(runtime)) {
+      return nullptr;
+    }
+    return object.getHostObject<JsiSharedFloat32Vector>(runtime);
+  }
+
+  /**
+   Returns the number of elements
+   */
+  size_t size() const { return _size; }
+
+  /**
+   Returns an element, safe to call from any thread
+   */
+  float getElement(size_t index) const {
+    return _values[index].load(std::memory_order_relaxed);
+  }
+
+  /**
+   Sets an element, safe to call from any thread
+   */
+  void setElement(size_t index, float value) {
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    beginWrite();
+    _values[index].store(value, std::memory_order_relaxed);
+    endWrite();
+  }
+
+  /**
+   Copies all elements written by one write into values, which must hold
+   size() floats. Safe to call from any thread.
+   */
+  void read(float *values) const {
+    for (int i = 0; i < SeqLockRetries; i++) {
+      auto sequence = _sequence.load(std::memory_order_acquire);
+      if (sequence & 1) {
+        // Write in progress
+        continue;
+      }
+      copyTo(values);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (_sequence.load(std::memory_order_relaxed) == sequence) {
+        return;
+      }
+    }
+    // Writers keep changing the vector, wait for them instead
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    copyTo(values);
+  }
+
+  /**
+   Sets all elements from values, which must hold size() floats. Safe to
+   call from any thread.
+   */
+  void write(const float *values) {
+    std::lock_guard<std::mutex> lock(_writeMutex);
+    beginWrite();
+    for (size_t i = 0; i < _size; i++) {
+      _values[i].store(values[i], std::memory_order_relaxed);
+    }
+    endWrite();
+  }
+
+  JSI_HOST_FUNCTION(getImpl) {
+    return static_cast<double>(
+        getElement(getIndex(runtime, arguments, count)));
+  }
+
+  JSI_HOST_FUNCTION(setImpl) {
+    auto index = getIndex(runtime, arguments, count);
+    if (count < 2 || !arguments[1].isNumber()) {
+      throw jsi::JSError(runtime, "set expects a number as its value.");
+    }
+    setElement(index, static_cast<float>(arguments[1].getNumber()));
+    return jsi::Value::undefined();
+  }
+
+  JSI_HOST_FUNCTION(toString) {
+    return jsi::String::createFromUtf8(
+        runtime, "[SharedFloat32Vector " + std::to_string(_size) + "]");
+  }
+
+  JSI_EXPORT_FUNCTIONS(
+      JSI_EXPORT_FUNC_NAMED(JsiSharedFloat32Vector, getImpl, get),
+      JSI_EXPORT_FUNC_NAMED(JsiSharedFloat32Vector, setImpl, set),
+      JSI_EXPORT_FUNC(JsiSharedFloat32Vector, toString))
+
+  JSI_PROPERTY_GET(length) { return static_cast<double>(_size); }
+
+  JSI_PROPERTY_GET(value) {
+    std::unique_ptr<float[]> values(new float[_size]);
+    read(values.get());
+    auto result = jsi::Array(runtime, _size);
+    for (size_t i = 0; i < _size; i++) {
+      result.setValueAtIndex(runtime, i, static_cast<double>(values[i]));
+    }
+    return result;
+  }
+
+  JSI_PROPERTY_SET(value) { write(runtime, value); }
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiSharedFloat32Vector,
+                                                  length),
+                              JSI_EXPORT_PROP_GET(JsiSharedFloat32Vector,
+                                                  value))
+  JSI_EXPORT_PROPERTY_SETTERS(JSI_EXPORT_PROP_SET(JsiSharedFloat32Vector,
+                                                  value))
+
+  /**
+   Sets all elements from an array of numbers or a Float32Array of the same
+   length
+   */
+  void write(jsi::Runtime &runtime, const jsi::Value &value) {
+    std::unique_ptr<float[]> values(new float[_size]);
+    if (value.isObject() && value.asObject(runtime).isArray(runtime)) {
+      auto array = value.asObject(runtime).asArray(runtime);
+      if (array.size(runtime) != _size) {
+        throw jsi::JSError(runtime, getLengthError());
+      }
+      for (size_t i = 0; i < _size; i++) {
+        auto element = array.getValueAtIndex(runtime, i);
+        if (!element.isNumber()) {
+          throw jsi::JSError(runtime,
+                             "SharedFloat32Vector values must be numbers.");
+        }
+        values[i] = static_cast<float>(element.getNumber());
+      }
+    } else if (value.isObject() &&
+               isFloat32Array(runtime, value.asObject(runtime))) {
+      // Copy the bytes directly instead of reading element by element
+      auto object = value.asObject(runtime);
+      auto length = static_cast<size_t>(
+          object.getProperty(runtime, PropNameLength).asNumber());
+      if (length != _size) {
+        throw jsi::JSError(runtime, getLengthError());
+      }
+      auto byteOffset = static_cast<size_t>(
+          object.getProperty(runtime, PropNameByteOffset).asNumber());
+      auto arrayBuffer = object.getProperty(runtime, PropNameBuffer)
+                             .asObject(runtime)
+                             .getArrayBuffer(runtime);
+      std::memcpy(values.get(), arrayBuffer.data(runtime) + byteOffset,
+                  _size * sizeof(float));
+    } else {
+      throw jsi::JSError(runtime, "SharedFloat32Vector values must be arrays "
+                                  "of numbers or Float32Arrays.");
+    }
+    write(values.get());
+  }
+
+private:
+  /**
+   Number of tries for reading the vector before falling back to the lock
+   */
+  static constexpr int SeqLockRetries = 64;
+
+  // Writers are serialized by the write mutex
+  void beginWrite() {
+    _sequence.store(_sequence.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void endWrite() {
+    _sequence.store(_sequence.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+  }
+
+  void copyTo(float *values) const {
+    for (size_t i = 0; i < _size; i++) {
+      values[i] = _values[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  size_t getIndex(jsi::Runtime &runtime, const jsi::Value *arguments,
+                  size_t count) const {
+    if (count == 0 || !arguments[0].isNumber()) {
+      throw jsi::JSError(runtime, "Expected an index as the first parameter.");
+    }
+    auto index = arguments[0].getNumber();
+    if (index < 0 || index >= static_cast<double>(_size)) {
+      throw jsi::JSError(runtime, "Index " + std::to_string(index) +
+                                      " is out of bounds.");
+    }
+    return static_cast<size_t>(index);
+  }
+
+  std::string getLengthError() const {
+    return "Expected " + std::to_string(_size) + " values.";
+  }
+
+  static bool isFloat32Array(jsi::Runtime &runtime, const jsi::Object &obj) {
+    if (!JsiArrayBufferWrapper::isArrayBufferView(runtime, obj)) {
+      return false;
+    }
+    auto ctor = obj.getProperty(runtime, PropNameConstructor);
+    if (!ctor.isObject()) {
+      return false;
+    }
+    auto name = ctor.asObject(runtime).getProperty(runtime, PropNameName);
+    return name.isString() &&
+           name.asString(runtime).utf8(runtime) == "Float32Array";
+  }
+
+  size_t _size;
+  std::unique_ptr<std::atomic<float>[]> _values;
+  std::atomic<uint32_t> _sequence = {0};
+  mutable std::mutex _writeMutex;
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "WKTJsiHostObject.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ A shared number stored in an atomic. Reading and writing it from any
+ runtime or from native code never allocates and never locks.
+ */
+class JsiSharedNumber : public JsiHostObject {
+public:
+  explicit JsiSharedNumber(double value) : _value(value) {}
+
+  /**
+   Returns the shared number held by the value, or nullptr if the value is
+   not a shared number
+   */
+  static std::shared_ptr<JsiSharedNumber> fromValue(jsi::Runtime &runtime,
+                                                    const jsi::Value &value) {
+    if (!value.isObject()) {
+      return nullptr;
+    }
+    auto object = value.asObject(runtime);
+    if (!object.isHostObject<JsiSharedNumber>(runtime)) {
+      return nullptr;
+    }
+    return object.getHostObject<JsiSharedNumber>(runtime);
+  }
+
+  /**
+   Returns the current value, safe to call from any thread
+   */
+  double getValue() const { return _value.load(std::memory_order_acquire); }
+
+  /**
+   Sets the value, safe to call from any thread
+   */
+  void setValue(double value) {
+    _value.store(value, std::memory_order_release);
+  }
+
+  JSI_HOST_FUNCTION(toString) {
+    return jsi::String::createFromUtf8(runtime, std::to_string(getValue()));
+  }
+
+  JSI_PROPERTY_GET(value) { return getValue(); }
+
+  JSI_PROPERTY_SET(value) {
+    if (!value.isNumber()) {
+      throw jsi::JSError(runtime, "SharedNumber values must be numbers.");
+    }
+    setValue(value.getNumber());
+  }
+
+  JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC(JsiSharedNumber, toString))
+
+  JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiSharedNumber, value))
+  JSI_EXPORT_PROPERTY_SETTERS(JSI_EXPORT_PROP_SET(JsiSharedNumber, value))
+
+private:
+  std::atomic<double> _value;
+};
+
+} // namespace RNWorklet
@@ -4,9 +4,11 @@
 #include <map>
 
 #include <memory>
+#include <string>
+#include <vector>
 
-#include "WKTJsiDispatcher.h"
 #include "WKTJsiHostObject.h"
+#include "WKTJsiNotificationBatch.h"
 #include "WKTJsiWorkletContext.h"
 #include "WKTJsiWrapper.h"
 
@@ -49,45 +51,70 @@ public:
 
   JSI_HOST_FUNCTION(addListener) {
     // Verify arguments
-    if (arguments[0].isUndefined() || arguments[0].isNull() ||
+    if (count == 0 || arguments[0].isUndefined() || arguments[0].isNull() ||
         arguments[0].isObject() == false ||
         arguments[0].asObject(runtime).isFunction(runtime) == false) {
       throw jsi::JSError(runtime,
                          "addListener expects a function as its parameter.");
     }
 
-    // Wrap the callback into a dispatcher with error handling. This
-    // callback will always be called on the main js thread/runtime so we
-    // can just use values directly.
+    // Read options
+    auto batched = false;
+    if (count > 1 && arguments[1].isObject()) {
+      auto batchedProp =
+          arguments[1].asObject(runtime).getProperty(runtime, "batched");
+      batched = batchedProp.isBool() && batchedProp.getBool();
+    }
+
+    // The listener is called with the runtime it was added from. Immediate
+    // listeners are called directly from the writing thread, batched
+    // listeners are flushed on the thread owning the runtime.
     auto functionToCall = std::make_shared<jsi::Function>(
         arguments[0].asObject(runtime).asFunction(runtime));
 
-    auto functionPtr =
-        [functionToCall](jsi::Runtime &rt, const jsi::Value &thisVal,
-                         const jsi::Value *args, size_t count) -> jsi::Value {
-      if (thisVal.isObject()) {
-        return functionToCall->callWithThis(rt, thisVal.asObject(rt), args,
-                                            count);
-      } else {
-        return functionToCall->call(rt, args, count);
+    auto context = _context;
+    auto callback = [&runtime, functionToCall,
+                     context](const std::vector<std::string> &changedPaths) {
+      try {
+        auto paths = jsi::Array(runtime, changedPaths.size());
+        for (size_t i = 0; i < changedPaths.size(); i++) {
+          paths.setValueAtIndex(
+              runtime, i, jsi::String::createFromUtf8(runtime, changedPaths[i]));
+        }
+        functionToCall->call(runtime, paths);
+      } catch (const jsi::JSError &err) {
+        reportError(context, err.getMessage());
+      } catch (const std::exception &err) {
+        reportError(context, err.what());
+      } catch (...) {
+        reportError(context, "Unknown error in shared value listener.");
       }
     };
 
-    // Do not Wrap this Value - replace with undefined
-    auto thisValuePtr = JsiWrapper::wrap(runtime, jsi::Value::undefined());
-
-    auto dispatcher = JsiDispatcher::createDispatcher(
-        runtime, thisValuePtr, functionPtr, nullptr,
-        [&runtime, this](const char *err) {
-          _context->invokeOnJsThread([err](jsi::Runtime &runtime) {
-            throw jsi::JSError(runtime, err);
-          });
-        });
-
-    // Set up the callback to run on the correct runtime thread.
-    auto callback = std::make_shared<std::function<void()>>(dispatcher);
+    JsiBatchedListener::scheduler_t scheduler = nullptr;
+    if (batched) {
+      auto workletContext = JsiWorkletContext::getCurrent(runtime);
+      if (workletContext != nullptr) {
+        scheduler = [workletContext,
+                     &runtime](std::function<void()> &&flush) {
+          workletContext->invokeOnWorkletRuntime(
+              runtime, [flush = std::move(flush)](JsiWorkletContext *,
+                                                  jsi::Runtime &) { flush(); });
+        };
+      } else {
+        scheduler = [context](std::function<void()> &&flush) {
+          context->invokeOnJsThread(
+              [flush = std::move(flush)](jsi::Runtime &) { flush(); });
+        };
+      }
+    }
 
-    auto listenerId = _valueWrapper->addListener(callback);
+    auto listener = std::make_shared<JsiBatchedListener>(callback, scheduler);
+    auto listenerId = _valueWrapper->addListener(
+        std::make_shared<JsiWrapperListener>(
+            [listener](const std::vector<std::string> &changedPaths) {
+              listener->onChanged(changedPaths);
+            }));
 
     // Return functionPtr for removing the observer
     return jsi::Function::createFromHostFunction(
@@ -110,7 +137,7 @@ public:
    * @param listener callback to notify
    * @return id of the listener - used for removing the listener
    */
-  size_t addListener(std::shared_ptr<std::function<void()>> listener) {
+  size_t addListener(std::shared_ptr<JsiWrapperListener> listener) {
     return _valueWrapper->addListener(listener);
   }
 
@@ -123,6 +150,16 @@ public:
   }
 
 private:
+  /**
+   Reports an error from a listener on the JS thread
+   */
+  static void reportError(std::shared_ptr<JsiWorkletContext> context,
+                          const std::string &message) {
+    context->invokeOnJsThread([message](jsi::Runtime &runtime) {
+      throw jsi::JSError(runtime, message);
+    });
+  }
+
   std::shared_ptr<JsiWrapper> _valueWrapper;
   std::shared_ptr<JsiWorkletContext> _context;
 };
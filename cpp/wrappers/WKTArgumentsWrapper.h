@@ -5,15 +5,36 @@
 
 #include <jsi/jsi.h>
 
+#include "WKTJsiSerializer.h"
+
 namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
 
+/**
+ How values are passed between runtimes
+ */
+enum class TransferMode {
+  /**
+   Each value is wrapped in a tree of JsiWrappers
+   */
+  Wrap,
+  /**
+   Values are serialized into a single buffer, see JsiSerializedValues
+   */
+  Serialize
+};
+
 class ArgumentsWrapper {
 public:
   ArgumentsWrapper(jsi::Runtime &runtime, const jsi::Value *arguments,
-                   size_t count)
+                   size_t count, TransferMode mode = TransferMode::Wrap)
       : _count(count) {
+    if (mode == TransferMode::Serialize) {
+      _serialized =
+          std::make_shared<JsiSerializedValues>(runtime, arguments, count);
+      return;
+    }
     _arguments.resize(count);
     for (size_t i = 0; i < count; ++i) {
       _arguments[i] = JsiWrapper::wrap(runtime, arguments[i]);
@@ -23,6 +44,9 @@ public:
   size_t getCount() const { return _count; }
 
   std::vector<jsi::Value> getArguments(jsi::Runtime &runtime) const {
+    if (_serialized != nullptr) {
+      return _serialized->deserialize(runtime);
+    }
     std::vector<jsi::Value> args(_count);
     for (size_t i = 0; i < _count; ++i) {
       args[i] = JsiWrapper::unwrap(runtime, _arguments.at(i));
@@ -37,6 +61,7 @@ public:
 private:
   size_t _count;
   std::vector<std::shared_ptr<JsiWrapper>> _arguments;
+  std::shared_ptr<JsiSerializedValues> _serialized;
 };
 
 } // namespace RNWorklet
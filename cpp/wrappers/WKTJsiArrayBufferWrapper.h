@@ -0,0 +1,255 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "WKTJsiProxyCache.h"
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+static const char *PropNameArrayBuffer = "ArrayBuffer";
+static const char *PropNameArrayBufferIsView = "isView";
+static const char *PropNameBuffer = "buffer";
+static const char *PropNameByteOffset = "byteOffset";
+static const char *PropNameByteLength = "byteLength";
+static const char *PropNameLength = "length";
+static const char *PropNameConstructor = "constructor";
+static const char *PropNameName = "name";
+
+/**
+ Native, ref-counted memory backing shared array buffers. Every runtime sees
+ the same bytes through a jsi::ArrayBuffer created on top of this buffer.
+ */
+class JsiSharedBuffer : public jsi::MutableBuffer {
+public:
+  /**
+   Creates a new zero-filled shared buffer with the given size
+   */
+  static std::shared_ptr<JsiSharedBuffer> create(size_t size) {
+    auto buffer =
+        std::shared_ptr<JsiSharedBuffer>(new JsiSharedBuffer(size));
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    getRegistry()[buffer->data()] = buffer;
+    return buffer;
+  }
+
+  /**
+   Returns the shared buffer backing the array buffer. If the array buffer
+   was created by us the existing buffer is returned without copying,
+   otherwise the contents are copied once into a new shared buffer.
+   */
+  static std::shared_ptr<JsiSharedBuffer>
+  fromArrayBuffer(jsi::Runtime &runtime, jsi::ArrayBuffer &arrayBuffer) {
+    auto data = arrayBuffer.data(runtime);
+    auto size = arrayBuffer.size(runtime);
+    auto existing = find(data, size);
+    if (existing != nullptr) {
+      return existing;
+    }
+    auto buffer = create(size);
+    if (size > 0) {
+      std::memcpy(buffer->data(), data, size);
+    }
+    return buffer;
+  }
+
+  ~JsiSharedBuffer() {
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    getRegistry().erase(_data.data());
+  }
+
+  size_t size() const override { return _data.size(); }
+  uint8_t *data() override { return _data.data(); }
+
+private:
+  explicit JsiSharedBuffer(size_t size) : _data(size) {}
+
+  /**
+   Returns the shared buffer owning the given memory, or nullptr if the memory
+   is owned by a javascript runtime.
+   */
+  static std::shared_ptr<JsiSharedBuffer> find(const uint8_t *data,
+                                               size_t size) {
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    auto &registry = getRegistry();
+    auto it = registry.find(data);
+    if (it == registry.end()) {
+      return nullptr;
+    }
+    auto buffer = it->second.lock();
+    if (buffer == nullptr || buffer->size() != size) {
+      return nullptr;
+    }
+    return buffer;
+  }
+
+  static std::map<const uint8_t *, std::weak_ptr<JsiSharedBuffer>> &
+  getRegistry() {
+    static std::map<const uint8_t *, std::weak_ptr<JsiSharedBuffer>> registry;
+    return registry;
+  }
+
+  static std::mutex &getRegistryMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  std::vector<uint8_t> _data;
+};
+
+/**
+ Wraps an ArrayBuffer or a view on an ArrayBuffer (typed arrays and
+ DataView). The bytes are kept in a single JsiSharedBuffer, and each runtime
+ unwrapping the value gets an ArrayBuffer pointing to the same memory.
+ */
+class JsiArrayBufferWrapper : public JsiWrapper {
+public:
+  /**
+   * Constructs a new array buffer wrapper
+   * @param runtime In runtime
+   * @param value Value to wrap
+   * @param parent Parent wrapper object
+   */
+  JsiArrayBufferWrapper(jsi::Runtime &runtime, const jsi::Value &value,
+                        JsiWrapper *parent)
+      : JsiWrapper(runtime, value, parent, JsiWrapperType::ArrayBuffer) {}
+
+  /**
+   Returns true if the object is an ArrayBuffer or a view on an ArrayBuffer
+   */
+  static bool isArrayBufferOrView(jsi::Runtime &runtime,
+                                  const jsi::Object &obj) {
+    return obj.isArrayBuffer(runtime) || isArrayBufferView(runtime, obj);
+  }
+
+  /**
+   Returns true if the object is a typed array or a DataView
+   */
+  static bool isArrayBufferView(jsi::Runtime &runtime, const jsi::Object &obj) {
+    if (obj.isHostObject(runtime) || obj.isFunction(runtime) ||
+        obj.isArray(runtime)) {
+      return false;
+    }
+    // Cheap check first - views always have an array buffer in "buffer"
+    auto buffer = obj.getProperty(runtime, PropNameBuffer);
+    if (!buffer.isObject() || !buffer.asObject(runtime).isArrayBuffer(runtime)) {
+      return false;
+    }
+    // Verify with ArrayBuffer.isView so that plain objects with a buffer
+    // property are not treated as views
+    auto isView = JsiProxyCache::get(runtime)->getGlobalFunction(
+        runtime, PropNameArrayBuffer, PropNameArrayBufferIsView);
+    if (isView == nullptr) {
+      return false;
+    }
+    auto result = isView->call(runtime, jsi::Value(runtime, obj));
+    return result.isBool() && result.getBool();
+  }
+
+  bool canUpdateValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    return value.isObject() &&
+           isArrayBufferOrView(runtime, value.asObject(runtime));
+  }
+
+  /**
+   Returns the shared buffer holding the bytes
+   */
+  std::shared_ptr<JsiSharedBuffer> getBuffer() { return _buffer; }
+
+  /**
+   * Returns the array buffer as a string
+   * @param runtime Runtime to return in
+   * @return Array buffer as string
+   */
+  std::string toString(jsi::Runtime &runtime) override {
+    return "[object " +
+           (_viewType.empty() ? std::string(PropNameArrayBuffer) : _viewType) +
+           "]";
+  }
+
+protected:
+  /**
+   * Overridden setValue method
+   * @param runtime Calling runtime
+   * @param value Value to set
+   */
+  void setValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    assert(value.isObject());
+    auto object = value.asObject(runtime);
+
+    if (object.isArrayBuffer(runtime)) {
+      auto arrayBuffer = object.getArrayBuffer(runtime);
+      _buffer = JsiSharedBuffer::fromArrayBuffer(runtime, arrayBuffer);
+      _viewType.clear();
+      _byteOffset = 0;
+      _length = _buffer->size();
+      return;
+    }
+
+    // Typed array or DataView - keep the whole underlying buffer so that the
+    // view keeps its offset and length.
+    auto arrayBuffer = object.getProperty(runtime, PropNameBuffer)
+                           .asObject(runtime)
+                           .getArrayBuffer(runtime);
+    _buffer = JsiSharedBuffer::fromArrayBuffer(runtime, arrayBuffer);
+    _byteOffset = static_cast<size_t>(
+        object.getProperty(runtime, PropNameByteOffset).asNumber());
+
+    // DataView has no length, its constructor expects the byte length
+    auto length = object.getProperty(runtime, PropNameLength);
+    _length = static_cast<size_t>(
+        length.isNumber()
+            ? length.getNumber()
+            : object.getProperty(runtime, PropNameByteLength).asNumber());
+
+    auto ctor = object.getProperty(runtime, PropNameConstructor);
+    auto name = ctor.isObject()
+                    ? ctor.asObject(runtime).getProperty(runtime, PropNameName)
+                    : jsi::Value::undefined();
+    if (!name.isString()) {
+      throw jsi::JSError(runtime,
+                         "Could not resolve the type of the typed array.");
+    }
+    _viewType = name.asString(runtime).utf8(runtime);
+  }
+
+  /**
+   * Overridden getValue method
+   * @param runtime Calling runtime
+   * @return An ArrayBuffer (or view) using the shared memory
+   */
+  jsi::Value getValue(jsi::Runtime &runtime) override {
+    auto arrayBuffer = jsi::ArrayBuffer(runtime, _buffer);
+    if (_viewType.empty()) {
+      return arrayBuffer;
+    }
+
+    auto ctor = runtime.global().getProperty(runtime, _viewType.c_str());
+    if (!ctor.isObject() || !ctor.asObject(runtime).isFunction(runtime)) {
+      throw jsi::JSError(runtime, "The typed array type " + _viewType +
+                                      " is not available in this runtime.");
+    }
+
+    return ctor.asObject(runtime).asFunction(runtime).callAsConstructor(
+        runtime, std::move(arrayBuffer),
+        jsi::Value(static_cast<double>(_byteOffset)),
+        jsi::Value(static_cast<double>(_length)));
+  }
+
+private:
+  std::shared_ptr<JsiSharedBuffer> _buffer;
+  // Name of the view constructor, empty for plain array buffers
+  std::string _viewType;
+  size_t _byteOffset = 0;
+  size_t _length = 0;
+};
+} // namespace RNWorklet
@@ -3,11 +3,20 @@
 #include <jsi/jsi.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "WKTJsiHostObject.h"
+#include "WKTJsiPromiseWrapper.h"
+#include "WKTJsiWorklet.h"
+#include "WKTJsiWorkletContext.h"
 #include "WKTJsiWrapper.h"
 
 namespace RNWorklet {
@@ -36,7 +45,10 @@ public:
     return jsi::String::createFromUtf8(runtime, toString(runtime));
   }
 
-  JSI_PROPERTY_GET(length) { return static_cast<double>(_array.size()); }
+  JSI_PROPERTY_GET(length) {
+    auto lock = readLock();
+    return static_cast<double>(size());
+  }
 
   JSI_HOST_FUNCTION(iterator) {
     int index = 0;
@@ -45,9 +57,8 @@ public:
                  this](jsi::Runtime &runtime, const jsi::Value &thisValue,
                        const jsi::Value *arguments, size_t count) mutable {
       auto retVal = jsi::Object(runtime);
-      if (index < _array.size()) {
-        retVal.setProperty(runtime, "value",
-                           _array[index]->unwrapAsProxyOrValue(runtime));
+      if (index < size()) {
+        retVal.setProperty(runtime, "value", getElement(runtime, index));
         retVal.setProperty(runtime, "done", false);
         index++;
       } else {
@@ -65,31 +76,48 @@ public:
   }
 
   JSI_HOST_FUNCTION(push) {
-    // Push all arguments to the array
-    auto lastIndex = _array.size();
-    for (size_t i = 0; i < count; i++) {
-      std::string indexString = std::to_string(lastIndex++);
-      _array.push_back(JsiWrapper::wrap(runtime, arguments[i], this));
+    size_t length;
+    {
+      auto lock = writeLock();
+      // Push all arguments to the array
+      for (size_t i = 0; i < count; i++) {
+        pushElement(runtime, arguments[i]);
+      }
+      length = size();
     }
     notify();
-    return static_cast<double>(_array.size());
+    return static_cast<double>(length);
   };
 
   JSI_HOST_FUNCTION(pop) {
-    // Pop last element from array
-    if (_array.empty()) {
-      return jsi::Value::undefined();
+    jsi::Value lastEl;
+    {
+      auto lock = writeLock();
+      // Pop last element from array
+      if (size() == 0) {
+        return jsi::Value::undefined();
+      }
+      lastEl = getElement(runtime, size() - 1);
+      switch (_storage) {
+      case ArrayStorage::Numbers:
+        _numbers.pop_back();
+        break;
+      case ArrayStorage::Bools:
+        _bools.pop_back();
+        break;
+      case ArrayStorage::Generic:
+        _array.pop_back();
+        break;
+      }
     }
-    auto lastEl = _array.at(_array.size() - 1);
-    _array.pop_back();
     notify();
-    return lastEl->unwrapAsProxyOrValue(runtime);
+    return lastEl;
   };
 
   JSI_HOST_FUNCTION(forEach) {
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = _array.at(i)->unwrapAsProxyOrValue(runtime);
+    for (size_t i = 0; i < size(); i++) {
+      auto arg = getElement(runtime, i);
       callFunction(runtime, callbackFn, thisValue, &arg, 1);
     }
     return jsi::Value::undefined();
@@ -97,9 +125,10 @@ public:
 
   JSI_HOST_FUNCTION(map) {
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    auto result = jsi::Array(runtime, _array.size());
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = _array.at(i)->unwrapAsProxyOrValue(runtime);
+    auto length = size();
+    auto result = jsi::Array(runtime, length);
+    for (size_t i = 0; i < length && i < size(); i++) {
+      auto arg = getElement(runtime, i);
       auto retVal = callFunction(runtime, callbackFn, thisValue, &arg, 1);
       result.setValueAtIndex(runtime, i, retVal);
     }
@@ -108,27 +137,26 @@ public:
 
   JSI_HOST_FUNCTION(filter) {
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    std::vector<std::shared_ptr<JsiWrapper>> result;
+    std::vector<jsi::Value> result;
 
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = _array.at(i)->unwrapAsProxyOrValue(runtime);
+    for (size_t i = 0; i < size(); i++) {
+      auto arg = getElement(runtime, i);
       auto retVal = callFunction(runtime, callbackFn, thisValue, &arg, 1);
       if (retVal.getBool() == true) {
-        result.push_back(_array.at(i));
+        result.push_back(std::move(arg));
       }
     }
     auto returnValue = jsi::Array(runtime, result.size());
     for (size_t i = 0; i < result.size(); i++) {
-      returnValue.setValueAtIndex(runtime, i,
-                                  result.at(i)->unwrapAsProxyOrValue(runtime));
+      returnValue.setValueAtIndex(runtime, i, result.at(i));
     }
     return returnValue;
   };
 
   JSI_HOST_FUNCTION(find) {
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = _array.at(i)->unwrapAsProxyOrValue(runtime);
+    for (size_t i = 0; i < size(); i++) {
+      auto arg = getElement(runtime, i);
       auto retVal = callFunction(runtime, callbackFn, thisValue, &arg, 1);
       if (retVal.getBool() == true) {
         return arg;
@@ -139,8 +167,8 @@ public:
 
   JSI_HOST_FUNCTION(every) {
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = JsiWrapper::unwrapAsProxyOrValue(runtime, _array.at(i));
+    for (size_t i = 0; i < size(); i++) {
+      auto arg = getElement(runtime, i);
       auto retVal = callFunction(runtime, callbackFn, thisValue, &arg, 1);
       if (retVal.getBool() == false) {
         return false;
@@ -151,8 +179,8 @@ public:
 
   JSI_HOST_FUNCTION(findIndex) {
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = JsiWrapper::unwrapAsProxyOrValue(runtime, _array.at(i));
+    for (size_t i = 0; i < size(); i++) {
+      auto arg = getElement(runtime, i);
       auto retVal = callFunction(runtime, callbackFn, thisValue, &arg, 1);
       if (retVal.getBool() == true) {
         return static_cast<int>(i);
@@ -162,6 +190,29 @@ public:
   };
 
   JSI_HOST_FUNCTION(indexOf) {
+    // Packed arrays can only contain numbers or bools
+    if (_storage == ArrayStorage::Numbers) {
+      if (!arguments[0].isNumber()) {
+        return -1;
+      }
+      // Strict equality, NaN is never found
+      auto it = std::find(_numbers.begin(), _numbers.end(),
+                          arguments[0].getNumber());
+      return it == _numbers.end()
+                 ? -1
+                 : static_cast<int>(std::distance(_numbers.begin(), it));
+    }
+    if (_storage == ArrayStorage::Bools) {
+      if (!arguments[0].isBool()) {
+        return -1;
+      }
+      auto it =
+          std::find(_bools.begin(), _bools.end(), arguments[0].getBool());
+      return it == _bools.end()
+                 ? -1
+                 : static_cast<int>(std::distance(_bools.begin(), it));
+    }
+
     auto wrappedArg = JsiWrapper::wrap(runtime, arguments[0]);
     for (size_t i = 0; i < _array.size(); i++) {
       // TODO: Add == operator to JsiWrapper
@@ -174,40 +225,66 @@ public:
     return -1;
   };
 
-  const std::vector<std::shared_ptr<JsiWrapper>>
-  flat_internal(int depth, std::vector<std::shared_ptr<JsiWrapper>> &arr) {
-    std::vector<std::shared_ptr<JsiWrapper>> result;
-    for (auto it : arr) {
+  /**
+   Appends the elements to result, flattening nested arrays up to depth
+   levels deep (all levels if depth is negative). Children are read under
+   their own read lock and keep their storage.
+   */
+  void flat_internal(jsi::Runtime &runtime, int depth,
+                     std::vector<jsi::Value> &result) {
+    auto lock = readLock();
+    if (_storage != ArrayStorage::Generic) {
+      // Packed arrays have no nested arrays
+      for (size_t i = 0; i < size(); i++) {
+        result.push_back(getElement(runtime, i));
+      }
+      return;
+    }
+    for (auto &it : _array) {
       if (it->getType() == JsiWrapperType::Array) {
         // Recursively call flat untill depth equals 0
         if (depth <= -1 || depth > 0) {
-          auto childArray =
-              (static_cast<JsiArrayWrapper *>(it.get()))->getArray();
-          auto flattened = flat_internal(depth - 1, childArray);
-          for (auto child : flattened) {
-            result.push_back(child);
-          }
+          static_cast<JsiArrayWrapper *>(it.get())
+              ->flat_internal(runtime, depth - 1, result);
         }
       } else {
-        result.push_back(it);
+        result.push_back(JsiWrapper::unwrapAsProxyOrValue(runtime, it));
       }
     }
-    return result;
   }
 
   JSI_HOST_FUNCTION(flat) {
     auto depth = count > 0 ? arguments[0].asNumber() : -1;
-    std::vector<std::shared_ptr<JsiWrapper>> result =
-        flat_internal(depth, _array);
+    std::vector<jsi::Value> result;
+    flat_internal(runtime, depth, result);
     auto returnValue = jsi::Array(runtime, result.size());
     for (size_t i = 0; i < result.size(); i++) {
-      returnValue.setValueAtIndex(
-          runtime, i, JsiWrapper::unwrapAsProxyOrValue(runtime, result.at(i)));
+      returnValue.setValueAtIndex(runtime, i, std::move(result[i]));
     }
     return returnValue;
   };
 
   JSI_HOST_FUNCTION(includes) {
+    // Packed arrays can only contain numbers or bools
+    if (_storage == ArrayStorage::Numbers) {
+      if (!arguments[0].isNumber()) {
+        return false;
+      }
+      // SameValueZero, NaN is found
+      auto value = arguments[0].getNumber();
+      if (std::isnan(value)) {
+        return std::any_of(_numbers.begin(), _numbers.end(),
+                           [](double n) { return std::isnan(n); });
+      }
+      return std::find(_numbers.begin(), _numbers.end(), value) !=
+             _numbers.end();
+    }
+    if (_storage == ArrayStorage::Bools) {
+      return arguments[0].isBool() &&
+             std::find(_bools.begin(), _bools.end(),
+                       arguments[0].getBool()) != _bools.end();
+    }
+
     auto wrappedArg = JsiWrapper::wrap(runtime, arguments[0]);
     for (size_t i = 0; i < _array.size(); i++) {
       // TODO: Add == operator to JsiWrapper!!!
@@ -222,15 +299,14 @@ public:
 
   JSI_HOST_FUNCTION(concat) {
     auto nextArray = arguments[0].asObject(runtime).asArray(runtime);
+    auto length = size();
     auto results = jsi::Array(
-        runtime, static_cast<size_t>(_array.size() + nextArray.size(runtime)));
-    for (size_t i = 0; i < _array.size(); i++) {
-      results.setValueAtIndex(
-          runtime, i, JsiWrapper::unwrapAsProxyOrValue(runtime, _array[i]));
+        runtime, static_cast<size_t>(length + nextArray.size(runtime)));
+    for (size_t i = 0; i < length; i++) {
+      results.setValueAtIndex(runtime, i, getElement(runtime, i));
     }
-    auto startIndex = std::max<size_t>(0, _array.size() - 1);
     for (size_t i = 0; i < nextArray.size(runtime); i++) {
-      results.setValueAtIndex(runtime, i + startIndex,
+      results.setValueAtIndex(runtime, i + length,
                               nextArray.getValueAtIndex(runtime, i));
     }
     return results;
@@ -240,10 +316,10 @@ public:
     auto separator =
         count > 0 ? arguments[0].asString(runtime).utf8(runtime) : ",";
     auto result = std::string("");
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto arg = _array.at(i)->unwrapAsProxyOrValue(runtime);
+    for (size_t i = 0; i < size(); i++) {
+      auto arg = getElement(runtime, i);
       result += arg.toString(runtime).utf8(runtime);
-      if (i < _array.size() - 1) {
+      if (i < size() - 1) {
         result += separator;
       }
     }
@@ -252,22 +328,143 @@ public:
 
   JSI_HOST_FUNCTION(reduce) {
     auto callbackFn = arguments[0].asObject(runtime).asFunction(runtime);
-    std::shared_ptr<JsiWrapper> acc =
-        JsiWrapper::wrap(runtime, jsi::Value::undefined());
-    if (count > 1) {
-      acc = JsiWrapper::wrap(runtime, arguments[1]);
-    }
-    for (size_t i = 0; i < _array.size(); i++) {
+    // The accumulator never leaves this runtime, so we don't need to wrap it
+    jsi::Value acc =
+        count > 1 ? jsi::Value(runtime, arguments[1]) : jsi::Value::undefined();
+    for (size_t i = 0; i < size(); i++) {
       std::vector<jsi::Value> args(3);
-      args[0] = acc->unwrapAsProxyOrValue(runtime);
-      args[1] = _array.at(i)->unwrapAsProxyOrValue(runtime);
+      args[0] = std::move(acc);
+      args[1] = getElement(runtime, i);
       args[2] = jsi::Value(static_cast<int>(i));
-      acc = JsiWrapper::wrap(
-          runtime,
-          callFunction(runtime, callbackFn, thisValue,
-                       static_cast<const jsi::Value *>(args.data()), 3));
+      acc = callFunction(runtime, callbackFn, thisValue,
+                         static_cast<const jsi::Value *>(args.data()), 3);
     }
-    return JsiWrapper::unwrapAsProxyOrValue(runtime, acc);
+    return acc;
+  }
+
+  JSI_HOST_FUNCTION(parallelMap) {
+    typedef std::vector<std::shared_ptr<JsiWrapper>> ChunkResult;
+    return runParallel<ChunkResult>(
+        runtime, "parallelMap", arguments, count, count > 1 ? 1 : -1,
+        [](jsi::Runtime &runtime, WorkletInvoker &invoker,
+           const ParallelSnapshot &snapshot, size_t begin, size_t end) {
+          ChunkResult result;
+          result.reserve(end - begin);
+          for (size_t i = begin; i < end; i++) {
+            jsi::Value args[2] = {snapshot.get(runtime, i),
+                                  jsi::Value(static_cast<double>(i))};
+            auto retVal =
+                invoker.call(runtime, jsi::Value::undefined(), args, 2);
+            result.push_back(JsiWrapper::wrap(runtime, retVal));
+          }
+          return result;
+        },
+        [](jsi::Runtime &runtime, const ParallelSnapshot &snapshot,
+           std::vector<ChunkResult> &chunks) -> jsi::Value {
+          auto result = jsi::Array(runtime, snapshot.size());
+          size_t index = 0;
+          for (auto &chunk : chunks) {
+            for (auto &wrapper : chunk) {
+              result.setValueAtIndex(runtime, index++,
+                                     JsiWrapper::unwrap(runtime, wrapper));
+            }
+          }
+          return result;
+        });
+  }
+
+  JSI_HOST_FUNCTION(parallelFilter) {
+    typedef std::vector<size_t> ChunkResult;
+    return runParallel<ChunkResult>(
+        runtime, "parallelFilter", arguments, count, count > 1 ? 1 : -1,
+        [](jsi::Runtime &runtime, WorkletInvoker &invoker,
+           const ParallelSnapshot &snapshot, size_t begin, size_t end) {
+          ChunkResult result;
+          for (size_t i = begin; i < end; i++) {
+            jsi::Value args[2] = {snapshot.get(runtime, i),
+                                  jsi::Value(static_cast<double>(i))};
+            auto retVal =
+                invoker.call(runtime, jsi::Value::undefined(), args, 2);
+            if (retVal.isBool() && retVal.getBool()) {
+              result.push_back(i);
+            }
+          }
+          return result;
+        },
+        [](jsi::Runtime &runtime, const ParallelSnapshot &snapshot,
+           std::vector<ChunkResult> &chunks) -> jsi::Value {
+          size_t length = 0;
+          for (auto &chunk : chunks) {
+            length += chunk.size();
+          }
+          auto result = jsi::Array(runtime, length);
+          size_t index = 0;
+          for (auto &chunk : chunks) {
+            for (auto i : chunk) {
+              result.setValueAtIndex(runtime, index++,
+                                     snapshot.get(runtime, i));
+            }
+          }
+          return result;
+        });
+  }
+
+  JSI_HOST_FUNCTION(parallelReduce) {
+    // Chunks are reduced in parallel starting from their first element, and
+    // the chunk results are combined in order on the calling thread, starting
+    // from the initial value if given. Without a combiner the reducer is used.
+    std::shared_ptr<jsi::Function> combiner;
+    if (count > 1 && arguments[1].isObject() &&
+        arguments[1].asObject(runtime).isFunction(runtime)) {
+      combiner = std::make_shared<jsi::Function>(
+          arguments[1].asObject(runtime).asFunction(runtime));
+    } else if (count > 1 && !arguments[1].isUndefined() &&
+               !arguments[1].isNull()) {
+      throw jsi::JSError(runtime,
+                         "parallelReduce expects the combiner as a function.");
+    } else if (count > 0 && arguments[0].isObject()) {
+      combiner = std::make_shared<jsi::Function>(
+          arguments[0].asObject(runtime).asFunction(runtime));
+    }
+    auto hasInitialValue = count > 2 && !arguments[2].isUndefined();
+    auto initialValue =
+        hasInitialValue ? JsiWrapper::wrap(runtime, arguments[2]) : nullptr;
+
+    typedef std::shared_ptr<JsiWrapper> ChunkResult;
+    return runParallel<ChunkResult>(
+        runtime, "parallelReduce", arguments, count, count > 3 ? 3 : -1,
+        [](jsi::Runtime &runtime, WorkletInvoker &invoker,
+           const ParallelSnapshot &snapshot, size_t begin, size_t end) {
+          auto acc = snapshot.get(runtime, begin);
+          for (size_t i = begin + 1; i < end; i++) {
+            jsi::Value args[3] = {std::move(acc), snapshot.get(runtime, i),
+                                  jsi::Value(static_cast<double>(i))};
+            acc = invoker.call(runtime, jsi::Value::undefined(), args, 3);
+          }
+          return JsiWrapper::wrap(runtime, acc);
+        },
+        [combiner, initialValue](jsi::Runtime &runtime,
+                                 const ParallelSnapshot &snapshot,
+                                 std::vector<ChunkResult> &chunks)
+            -> jsi::Value {
+          if (chunks.empty() && initialValue == nullptr) {
+            throw jsi::JSError(runtime,
+                               "Reduce of empty array with no initial value");
+          }
+          size_t first = 0;
+          jsi::Value acc;
+          if (initialValue != nullptr) {
+            acc = JsiWrapper::unwrap(runtime, initialValue);
+          } else {
+            acc = JsiWrapper::unwrap(runtime, chunks.at(0));
+            first = 1;
+          }
+          for (size_t i = first; i < chunks.size(); i++) {
+            acc = combiner->call(runtime, acc,
+                                 JsiWrapper::unwrap(runtime, chunks.at(i)));
+          }
+          return acc;
+        });
   }
 
   JSI_EXPORT_PROPERTY_GETTERS(JSI_EXPORT_PROP_GET(JsiArrayWrapper, length))
@@ -287,6 +484,9 @@ public:
       JSI_EXPORT_FUNC(JsiArrayWrapper, indexOf),
       JSI_EXPORT_FUNC(JsiArrayWrapper, join),
       JSI_EXPORT_FUNC(JsiArrayWrapper, reduce),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, parallelMap),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, parallelFilter),
+      JSI_EXPORT_FUNC(JsiArrayWrapper, parallelReduce),
       JSI_EXPORT_FUNC_NAMED(JsiArrayWrapper, toStringImpl, toString),
       JSI_EXPORT_FUNC_NAMED(JsiArrayWrapper, toStringImpl, Symbol.toStringTag),
 
@@ -311,18 +511,8 @@ public:
    * @param value Value to set
    */
   void setValue(jsi::Runtime &runtime, const jsi::Value &value) override {
-    assert(value.isObject());
-    auto object = value.asObject(runtime);
-    assert(object.isArray(runtime));
-    auto array = object.asArray(runtime);
-
-    size_t size = array.size(runtime);
-    _array.resize(size);
-
-    for (size_t i = 0; i < size; i++) {
-      _array[i] =
-          JsiWrapper::wrap(runtime, array.getValueAtIndex(runtime, i), this);
-    }
+    ChangedRanges changedRanges;
+    setArrayValue(runtime, value, changedRanges);
 
     /* / Update prototype
     auto objectCtor = runtime.global().getProperty(runtime, "Object");
@@ -344,6 +534,40 @@ public:
     }*/
   }
 
+  /**
+   * Overridden updateValue method. Only the elements that changed are
+   * replaced, and listeners receive the changed index ranges.
+   * @param runtime Calling runtime
+   * @param value Value to set
+   */
+  void updateValue(jsi::Runtime &runtime, const jsi::Value &value) override {
+    ChangedRanges changedRanges;
+    {
+      auto lock = writeLock();
+      setArrayValue(runtime, value, changedRanges);
+    }
+    if (changedRanges.empty() || !hasListeners()) {
+      return;
+    }
+    std::vector<std::string> paths;
+    paths.reserve(changedRanges.size());
+    for (const auto &range : changedRanges) {
+      paths.push_back(range.second - range.first == 1
+                          ? std::to_string(range.first)
+                          : std::to_string(range.first) + "-" +
+                                std::to_string(range.second - 1));
+    }
+    notify(paths);
+  }
+
+  bool updateValueInPlace(jsi::Runtime &runtime,
+                          const jsi::Value &value) override {
+    ChangedRanges changedRanges;
+    auto lock = writeLock();
+    setArrayValue(runtime, value, changedRanges);
+    return !changedRanges.empty();
+  }
+
   /**
    * Overridden jsi::HostObject set property method
    * @param runtime Runtime
@@ -357,8 +581,13 @@ public:
         std::all_of(nameStr.begin(), nameStr.end(), ::isdigit)) {
       // Return property by index
       auto index = std::stoi(nameStr.c_str());
-      _array[index] = JsiWrapper::wrap(runtime, value);
-      notify();
+      {
+        auto lock = writeLock();
+        setElement(runtime, index, value);
+      }
+      if (hasListeners()) {
+        notify(std::to_string(index));
+      }
     } else {
       // This is an edge case where the array is used as a
       // hashtable to set a value outside the bounds of the
@@ -380,11 +609,11 @@ public:
         std::all_of(nameStr.begin(), nameStr.end(), ::isdigit)) {
       // Return property by index
       auto index = std::stoi(nameStr.c_str());
-      auto prop = _array[index];
-      return JsiWrapper::unwrapAsProxyOrValue(runtime, prop);
+      auto lock = readLock();
+      return getElement(runtime, index);
     }
     // Return super JsiHostObject's get
-    return JsiHostObject::get(runtime, name);
+    return JsiHostObject::getExported(runtime, name, nameStr);
   }
 
   /**
@@ -395,8 +624,19 @@ public:
   std::string toString(jsi::Runtime &runtime) override {
     std::string retVal = "";
     // Return array contents
-    for (size_t i = 0; i < _array.size(); i++) {
-      auto str = _array.at(i)->toString(runtime);
+    for (size_t i = 0; i < size(); i++) {
+      std::string str;
+      switch (_storage) {
+      case ArrayStorage::Numbers:
+        str = JsiWrapper::numberToString(_numbers[i]);
+        break;
+      case ArrayStorage::Bools:
+        str = std::to_string(static_cast<bool>(_bools[i]));
+        break;
+      case ArrayStorage::Generic:
+        str = _array.at(i)->toString(runtime);
+        break;
+      }
       retVal += (i > 0 ? "," : "") + str;
     }
     return "[" + retVal + "]";
@@ -405,64 +645,489 @@ public:
   std::vector<jsi::PropNameID>
   getPropertyNames(jsi::Runtime &runtime) override {
     std::vector<jsi::PropNameID> propNames;
-    for (size_t i = 0; i < _array.size(); i++) {
+    for (size_t i = 0; i < size(); i++) {
       propNames.push_back(jsi::PropNameID::forUtf8(runtime, std::to_string(i)));
     }
     return propNames;
   }
 
-  const std::vector<std::shared_ptr<JsiWrapper>> &getArray() { return _array; }
+  std::string getChildKey(const JsiWrapper *child) override {
+    auto lock = readLock();
+    for (size_t i = 0; i < _array.size(); i++) {
+      if (_array[i].get() == child) {
+        return std::to_string(i);
+      }
+    }
+    return "";
+  }
+
+  /**
+   Returns the number of elements in the array
+   */
+  size_t size() const {
+    switch (_storage) {
+    case ArrayStorage::Numbers:
+      return _numbers.size();
+    case ArrayStorage::Bools:
+      return _bools.size();
+    case ArrayStorage::Generic:
+      return _array.size();
+    }
+    return 0;
+  }
 
 private:
+  /**
+   How the elements are stored. Arrays with only numbers or only bools are
+   kept packed, without a wrapper per element.
+   */
+  enum class ArrayStorage { Numbers, Bools, Generic };
+
+  /**
+   Elements of the array copied for processing in other runtimes. Wrapped
+   elements are shared, not copied.
+   */
+  class ParallelSnapshot {
+  public:
+    explicit ParallelSnapshot(const JsiArrayWrapper &array)
+        : _storage(array._storage), _numbers(array._numbers),
+          _bools(array._bools), _array(array._array) {}
+
+    size_t size() const {
+      switch (_storage) {
+      case ArrayStorage::Numbers:
+        return _numbers.size();
+      case ArrayStorage::Bools:
+        return _bools.size();
+      case ArrayStorage::Generic:
+        return _array.size();
+      }
+      return 0;
+    }
+
+    jsi::Value get(jsi::Runtime &runtime, size_t index) const {
+      switch (_storage) {
+      case ArrayStorage::Numbers:
+        return jsi::Value(_numbers.at(index));
+      case ArrayStorage::Bools:
+        return jsi::Value(static_cast<bool>(_bools.at(index)));
+      case ArrayStorage::Generic:
+        return JsiWrapper::unwrapAsProxyOrValue(runtime, _array.at(index));
+      }
+      return jsi::Value::undefined();
+    }
+
+  private:
+    ArrayStorage _storage;
+    std::vector<double> _numbers;
+    std::vector<bool> _bools;
+    std::vector<std::shared_ptr<JsiWrapper>> _array;
+  };
+
+  /**
+   Splits the array into chunks processed in parallel by the worklet in a
+   pooled context, and returns a promise resolved in the calling runtime with
+   the gathered chunk results.
+   @param name Name of the calling function, for errors
+   @param contextIndex Index of the optional context argument or -1
+   @param processChunk Processes the elements [begin, end) in a worker runtime
+   @param gather Combines the chunk results, in order, in the calling runtime
+   */
+  template <typename ChunkResult>
+  jsi::Value runParallel(
+      jsi::Runtime &runtime, const std::string &name,
+      const jsi::Value *arguments, size_t count, int contextIndex,
+      std::function<ChunkResult(jsi::Runtime &, WorkletInvoker &,
+                                const ParallelSnapshot &, size_t, size_t)>
+          processChunk,
+      std::function<jsi::Value(jsi::Runtime &, const ParallelSnapshot &,
+                               std::vector<ChunkResult> &)>
+          gather) {
+    if (count == 0 || !arguments[0].isObject() ||
+        !arguments[0].asObject(runtime).isFunction(runtime) ||
+        !JsiWorklet::isDecoratedAsWorklet(
+            runtime, std::make_shared<jsi::Function>(
+                         arguments[0].asObject(runtime).asFunction(runtime)))) {
+      throw jsi::JSError(runtime, name + " expects a worklet function.");
+    }
+    auto invoker = std::make_shared<WorkletInvoker>(runtime, arguments[0]);
+
+    std::shared_ptr<JsiWorkletContext> context;
+    if (contextIndex >= 0 && arguments[contextIndex].isObject()) {
+      context = arguments[contextIndex]
+                    .asObject(runtime)
+                    .getHostObject<JsiWorkletContext>(runtime);
+      if (context == nullptr) {
+        throw jsi::JSError(runtime, name + " called with invalid context.");
+      }
+    } else {
+      context = JsiWorkletContext::getParallelInstance();
+    }
+
+    std::shared_ptr<ParallelSnapshot> snapshot;
+    {
+      auto lock = readLock();
+      snapshot = std::make_shared<ParallelSnapshot>(*this);
+    }
+
+    // A few chunks per thread so that uneven chunks even out
+    auto length = snapshot->size();
+    auto chunkCount = std::min(length, context->getPoolSize() * 4);
+    auto chunkSize = chunkCount > 0 ? (length + chunkCount - 1) / chunkCount : 0;
+    if (chunkSize > 0) {
+      chunkCount = (length + chunkSize - 1) / chunkSize;
+    }
+
+    struct State {
+      std::vector<ChunkResult> results;
+      std::atomic<size_t> remaining;
+      std::mutex errorMutex;
+      std::string error;
+      // Only used and released on the calling thread
+      std::function<jsi::Value(jsi::Runtime &, const ParallelSnapshot &,
+                               std::vector<ChunkResult> &)>
+          gather;
+    };
+    auto state = std::make_shared<State>();
+    state->results.resize(chunkCount);
+    state->remaining = chunkCount;
+    state->gather = std::move(gather);
+
+    auto callingContext = JsiWorkletContext::getCurrent(runtime);
+    auto callingRuntime = &runtime;
+    auto complete = [state, snapshot](jsi::Runtime &runtime,
+                                      std::shared_ptr<PromiseParameter>
+                                          promise) {
+      auto gather = std::move(state->gather);
+      if (!state->error.empty()) {
+        promise->reject(runtime,
+                        jsi::String::createFromUtf8(runtime, state->error));
+        return;
+      }
+      try {
+        promise->resolve(runtime, gather(runtime, *snapshot, state->results));
+      } catch (const jsi::JSError &err) {
+        promise->reject(runtime,
+                        jsi::String::createFromUtf8(runtime, err.getMessage()));
+      }
+    };
+
+    auto promise = JsiPromiseWrapper::createPromiseWrapper(
+        runtime, [state, snapshot, invoker, context, processChunk, complete,
+                  chunkCount, chunkSize, callingContext,
+                  callingRuntime](jsi::Runtime &runtime,
+                                  std::shared_ptr<PromiseParameter> promise) {
+          if (chunkCount == 0) {
+            complete(runtime, promise);
+            return;
+          }
+          for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            context->invokeOnWorkletThread([=](JsiWorkletContext *,
+                                               jsi::Runtime &runtime) {
+              auto begin = chunk * chunkSize;
+              auto end = std::min(begin + chunkSize, snapshot->size());
+              try {
+                state->results[chunk] =
+                    processChunk(runtime, *invoker, *snapshot, begin, end);
+              } catch (const jsi::JSError &err) {
+                std::lock_guard<std::mutex> lock(state->errorMutex);
+                state->error = err.getMessage();
+              } catch (const std::exception &err) {
+                std::lock_guard<std::mutex> lock(state->errorMutex);
+                state->error = err.what();
+              }
+              if (--state->remaining > 0) {
+                return;
+              }
+              // Always resolve in the calling context or the JS context
+              if (callingContext == nullptr) {
+                JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
+                    [complete, promise](jsi::Runtime &runtime) {
+                      complete(runtime, promise);
+                    });
+              } else {
+                callingContext->invokeOnWorkletRuntime(
+                    *callingRuntime,
+                    [complete, promise](JsiWorkletContext *,
+                                        jsi::Runtime &runtime) {
+                      complete(runtime, promise);
+                    });
+              }
+            });
+          }
+        });
+
+    return jsi::Object::createFromHostObject(runtime, promise);
+  }
+
+  /**
+   Half-open ranges of changed indexes, in order
+   */
+  using ChangedRanges = std::vector<std::pair<size_t, size_t>>;
+
+  static void addChangedIndex(ChangedRanges &ranges, size_t index) {
+    if (!ranges.empty() && ranges.back().second == index) {
+      ranges.back().second++;
+    } else {
+      ranges.emplace_back(index, index + 1);
+    }
+  }
+
+  /**
+   Sets the elements from an array. Elements that did not change keep their
+   wrappers, nested objects and arrays are updated in place.
+   @param changedRanges Receives the indexes that changed, were added or
+   were removed
+   */
+  void setArrayValue(jsi::Runtime &runtime, const jsi::Value &value,
+                     ChangedRanges &changedRanges) {
+    assert(value.isObject());
+    auto object = value.asObject(runtime);
+    assert(object.isArray(runtime));
+    auto array = object.asArray(runtime);
+
+    size_t size = array.size(runtime);
+    std::vector<jsi::Value> values;
+    values.reserve(size);
+    bool allNumbers = true;
+    bool allBools = true;
+    for (size_t i = 0; i < size; i++) {
+      values.push_back(array.getValueAtIndex(runtime, i));
+      allNumbers &= values.back().isNumber();
+      allBools &= values.back().isBool();
+    }
+
+    // Arrays with only numbers or only bools are kept packed (empty arrays
+    // as numbers), anything else uses the generic layout.
+    auto storage = size > 0 && allBools ? ArrayStorage::Bools
+                   : allNumbers         ? ArrayStorage::Numbers
+                                        : ArrayStorage::Generic;
+    auto previousSize = this->size();
+    auto common = std::min(size, previousSize);
+
+    switch (storage) {
+    case ArrayStorage::Numbers: {
+      std::vector<double> numbers;
+      numbers.reserve(size);
+      for (size_t i = 0; i < size; i++) {
+        if (i >= common || !hasSameElement(runtime, i, values[i])) {
+          addChangedIndex(changedRanges, i);
+        }
+        numbers.push_back(values[i].getNumber());
+      }
+      _numbers = std::move(numbers);
+      _bools.clear();
+      _array.clear();
+      break;
+    }
+    case ArrayStorage::Bools: {
+      std::vector<bool> bools;
+      bools.reserve(size);
+      for (size_t i = 0; i < size; i++) {
+        if (i >= common || !hasSameElement(runtime, i, values[i])) {
+          addChangedIndex(changedRanges, i);
+        }
+        bools.push_back(values[i].getBool());
+      }
+      _bools = std::move(bools);
+      _numbers.clear();
+      _array.clear();
+      break;
+    }
+    case ArrayStorage::Generic: {
+      std::vector<std::shared_ptr<JsiWrapper>> elements;
+      elements.reserve(size);
+      for (size_t i = 0; i < size; i++) {
+        if (i < common && _storage == ArrayStorage::Generic) {
+          auto &element = _array[i];
+          if (element->hasSameValue(runtime, values[i])) {
+            elements.push_back(element);
+            continue;
+          }
+          // Update nested objects and arrays in place without notifying,
+          // their index is reported as changed if anything in them changed.
+          if ((element->getType() == JsiWrapperType::Object ||
+               element->getType() == JsiWrapperType::Array) &&
+              element->canUpdateValue(runtime, values[i])) {
+            if (element->updateValueInPlace(runtime, values[i])) {
+              addChangedIndex(changedRanges, i);
+            }
+            elements.push_back(element);
+            continue;
+          }
+        } else if (i < common && hasSameElement(runtime, i, values[i])) {
+          elements.push_back(JsiWrapper::wrap(runtime, values[i], this));
+          continue;
+        }
+        addChangedIndex(changedRanges, i);
+        elements.push_back(JsiWrapper::wrap(runtime, values[i], this));
+      }
+      _array = std::move(elements);
+      _numbers.clear();
+      _bools.clear();
+      break;
+    }
+    }
+    _storage = storage;
+
+    // Removed elements
+    if (previousSize > size) {
+      if (!changedRanges.empty() && changedRanges.back().second == size) {
+        changedRanges.back().second = previousSize;
+      } else {
+        changedRanges.emplace_back(size, previousSize);
+      }
+    }
+  }
+
+  /**
+   Returns true if the element at the given index holds the primitive value
+   */
+  bool hasSameElement(jsi::Runtime &runtime, size_t index,
+                      const jsi::Value &value) {
+    switch (_storage) {
+    case ArrayStorage::Numbers:
+      return value.isNumber() && _numbers[index] == value.getNumber();
+    case ArrayStorage::Bools:
+      return value.isBool() && _bools[index] == value.getBool();
+    case ArrayStorage::Generic:
+      return _array[index]->hasSameValue(runtime, value);
+    }
+    return false;
+  }
+
+  /**
+   Returns the element at the given index as a value in the runtime
+   */
+  jsi::Value getElement(jsi::Runtime &runtime, size_t index) {
+    switch (_storage) {
+    case ArrayStorage::Numbers:
+      return jsi::Value(_numbers.at(index));
+    case ArrayStorage::Bools:
+      return jsi::Value(static_cast<bool>(_bools.at(index)));
+    case ArrayStorage::Generic:
+      return JsiWrapper::unwrapAsProxyOrValue(runtime, _array.at(index));
+    }
+    return jsi::Value::undefined();
+  }
+
+  /**
+   Returns true if the value can be stored in the current packed layout. Empty
+   arrays can switch to any packed layout.
+   */
+  bool canStorePacked(const jsi::Value &value) {
+    if (size() == 0 && _storage != ArrayStorage::Generic) {
+      if (value.isNumber()) {
+        _storage = ArrayStorage::Numbers;
+      } else if (value.isBool()) {
+        _storage = ArrayStorage::Bools;
+      }
+    }
+    return (_storage == ArrayStorage::Numbers && value.isNumber()) ||
+           (_storage == ArrayStorage::Bools && value.isBool());
+  }
+
+  /**
+   Sets the element at the given index
+   */
+  void setElement(jsi::Runtime &runtime, size_t index,
+                  const jsi::Value &value) {
+    if (index >= size()) {
+      throw jsi::JSError(runtime, "Array out of bounds");
+    }
+    if (canStorePacked(value)) {
+      if (_storage == ArrayStorage::Numbers) {
+        _numbers[index] = value.getNumber();
+      } else {
+        _bools[index] = value.getBool();
+      }
+      return;
+    }
+    unpack(runtime);
+    _array[index] = JsiWrapper::wrap(runtime, value, this);
+  }
+
+  /**
+   Adds an element to the end of the array
+   */
+  void pushElement(jsi::Runtime &runtime, const jsi::Value &value) {
+    if (canStorePacked(value)) {
+      if (_storage == ArrayStorage::Numbers) {
+        _numbers.push_back(value.getNumber());
+      } else {
+        _bools.push_back(value.getBool());
+      }
+      return;
+    }
+    unpack(runtime);
+    _array.push_back(JsiWrapper::wrap(runtime, value, this));
+  }
+
+  /**
+   Converts a packed array to the generic layout
+   */
+  void unpack(jsi::Runtime &runtime) {
+    switch (_storage) {
+    case ArrayStorage::Numbers:
+      _array.reserve(_numbers.size());
+      for (auto number : _numbers) {
+        _array.push_back(JsiWrapper::wrap(runtime, jsi::Value(number), this));
+      }
+      _numbers.clear();
+      _numbers.shrink_to_fit();
+      break;
+    case ArrayStorage::Bools:
+      _array.reserve(_bools.size());
+      for (auto b : _bools) {
+        _array.push_back(
+            JsiWrapper::wrap(runtime, jsi::Value(static_cast<bool>(b)), this));
+      }
+      _bools.clear();
+      _bools.shrink_to_fit();
+      break;
+    case ArrayStorage::Generic:
+      break;
+    }
+    _storage = ArrayStorage::Generic;
+  }
+
   /**
    Creates a proxy for the host object so that we can make the runtime trust
    that this is a real JS array
    */
   jsi::Value getArrayProxy(jsi::Runtime &runtime,
                            std::shared_ptr<jsi::HostObject> hostObj) {
-    // return jsi::Object::createFromHostObject(runtime, hostObj);
-
-    auto createArrayProxy =
-        runtime.global().getProperty(runtime, WorkletArrayProxyName);
-    if (createArrayProxy.isUndefined()) {
-      // Install worklet proxy helper into runtime
-      static std::string code =
-          "function (obj) {"
-          "return new Proxy(obj, {"
-          "    ownKeys: function (target) {"
-          "      return Reflect.ownKeys(target).concat(['length']);"
-          "    },"
-          "    getPrototypeOf: function () {"
-          "      return Reflect.getPrototypeOf([]);"
-          "    },"
-          "    getOwnPropertyDescriptor: function (_, prop) {"
-          "      return {"
-          "        configurable: true,"
-          "        writable: true,"
-          "        enumerable: prop !== 'length',"
-          "      };"
-          "    },"
-          "    set: function(target, prop, value) { return "
-          "Reflect.set(target,prop,value); },"
-          "    get: function(target, prop) { return Reflect.get(target, prop); "
-          "}"
-          "  })"
-          "}";
-
-      auto codeBuffer =
-          std::make_shared<const jsi::StringBuffer>("(" + code + "\n)");
-      createArrayProxy =
-          runtime.evaluateJavaScript(codeBuffer, WorkletArrayProxyName);
-      runtime.global().setProperty(runtime, WorkletArrayProxyName,
-                                   createArrayProxy);
-    }
-
-    auto createProxyFunc =
-        createArrayProxy.asObject(runtime).asFunction(runtime);
-    return createProxyFunc.call(
-        runtime, jsi::Object::createFromHostObject(runtime, hostObj));
+    static std::string code =
+        "function (obj) {"
+        "return new Proxy(obj, {"
+        "    ownKeys: function (target) {"
+        "      return Reflect.ownKeys(target).concat(['length']);"
+        "    },"
+        "    getPrototypeOf: function () {"
+        "      return Reflect.getPrototypeOf([]);"
+        "    },"
+        "    getOwnPropertyDescriptor: function (_, prop) {"
+        "      return {"
+        "        configurable: true,"
+        "        writable: true,"
+        "        enumerable: prop !== 'length',"
+        "      };"
+        "    },"
+        "    set: function(target, prop, value) { return "
+        "Reflect.set(target,prop,value); },"
+        "    get: function(target, prop) { return Reflect.get(target, prop); "
+        "}"
+        "  })"
+        "}";
+
+    auto key = hostObj.get();
+    return JsiProxyCache::get(runtime)->getProxy(
+        runtime, key, WorkletArrayProxyName, code, std::move(hostObj));
   }
 
+  ArrayStorage _storage = ArrayStorage::Numbers;
+  std::vector<double> _numbers;
+  std::vector<bool> _bools;
   std::vector<std::shared_ptr<JsiWrapper>> _array;
 };
 } // namespace RNWorklet
@@ -7,7 +7,9 @@
 #include <string>
 #include <vector>
 
+#include "WKTJsiArrayBufferWrapper.h"
 #include "WKTJsiPromiseWrapper.h"
+#include "WKTJsiPropertyTable.h"
 #include "WKTJsiWorklet.h"
 #include "WKTJsiWrapper.h"
 
@@ -40,7 +42,12 @@ public:
                                              Symbol.toStringTag))
 
   bool canUpdateValue(jsi::Runtime &runtime, const jsi::Value &value) override {
-    return value.isObject() && !value.asObject(runtime).isArray(runtime);
+    if (!value.isObject()) {
+      return false;
+    }
+    auto object = value.asObject(runtime);
+    return !object.isArray(runtime) &&
+           !JsiArrayBufferWrapper::isArrayBufferOrView(runtime, object);
   }
 
   /**
@@ -57,13 +64,23 @@ public:
       setHostObjectValue(runtime, object);
     } else if (object.isFunction(runtime)) {
       setFunctionValue(runtime, value);
-    } else if (object.isArrayBuffer(runtime)) {
-      setArrayBufferValue(runtime, object);
     } else {
       setObjectValue(runtime, object);
     }
   }
 
+  bool updateValueInPlace(jsi::Runtime &runtime,
+                          const jsi::Value &value) override {
+    auto lock = writeLock();
+    auto object = value.asObject(runtime);
+    if (getType() == JsiWrapperType::Object && !object.isHostObject(runtime) &&
+        !object.isFunction(runtime)) {
+      return setObjectValue(runtime, object);
+    }
+    setValue(runtime, value);
+    return true;
+  }
+
   /**
    * Overridden get value where we convert from the internal representation to
    * a jsi value
@@ -97,10 +114,31 @@ public:
   void set(jsi::Runtime &runtime, const jsi::PropNameID &name,
            const jsi::Value &value) override {
     auto nameStr = name.utf8(runtime);
-    if (_properties.count(nameStr) == 0) {
-      _properties.emplace(nameStr, JsiWrapper::wrap(runtime, value, this));
-    } else {
-      _properties.at(nameStr)->updateValue(runtime, value);
+    std::shared_ptr<JsiWrapper> nested;
+    {
+      auto lock = writeLock();
+      auto properties = getProperties();
+      auto property = properties->get(nameStr);
+      if (property != nullptr && isNested(property) &&
+          property->canUpdateValue(runtime, value)) {
+        nested = property;
+      } else if (property == nullptr ||
+                 !property->hasSameValue(runtime, value)) {
+        // Values are replaced, not changed, so that readers holding the
+        // previous table keep seeing the previous value.
+        setProperties(
+            properties->set(nameStr, JsiWrapper::wrap(runtime, value, this)));
+      }
+      if (property == nullptr) {
+        return;
+      }
+    }
+
+    if (nested != nullptr) {
+      // Update outside of our lock, the property notifies us when done
+      nested->updateValue(runtime, value);
+    } else if (hasListeners()) {
+      notify(nameStr);
     }
   }
 
@@ -112,12 +150,12 @@ public:
    */
   jsi::Value get(jsi::Runtime &runtime, const jsi::PropNameID &name) override {
     auto nameStr = name.utf8(runtime);
-    if (_properties.count(nameStr) != 0) {
-      auto prop = _properties.at(nameStr);
+    auto prop = getProperties()->get(nameStr);
+    if (prop != nullptr) {
       return JsiWrapper::unwrap(runtime, prop);
     }
 
-    return JsiHostObject::get(runtime, name);
+    return JsiHostObject::getExported(runtime, name, nameStr);
   }
 
   /**
@@ -127,11 +165,12 @@ public:
    */
   std::vector<jsi::PropNameID>
   getPropertyNames(jsi::Runtime &runtime) override {
+    auto properties = getProperties();
     std::vector<jsi::PropNameID> retVal;
-    retVal.reserve(_properties.size());
-    for (auto it = _properties.begin(); it != _properties.end(); it++) {
-      retVal.push_back(jsi::PropNameID::forUtf8(runtime, it->first));
-    }
+    retVal.reserve(properties->size());
+    properties->forEach([&](const JsiPropertyTable::Entry &entry) {
+      retVal.push_back(jsi::PropNameID::forUtf8(runtime, entry.first));
+    });
     return retVal;
   }
 
@@ -156,6 +195,10 @@ public:
     }
   }
 
+  std::string getChildKey(const JsiWrapper *child) override {
+    return getProperties()->findName(child);
+  }
+
 protected:
   jsi::Value getAsProxyOrValue(jsi::Runtime &runtime) override {
     if (getType() == JsiWrapperType::Object) {
@@ -167,22 +210,66 @@ protected:
   }
 
 private:
-  void setArrayBufferValue(jsi::Runtime &runtime, jsi::Object &obj) {
-    throw jsi::JSError(runtime,
-                       "Array buffers are not supported as shared values.");
+  /**
+   Returns the current properties. The table is immutable, so it can be read
+   without locking while writers publish new tables.
+   */
+  std::shared_ptr<const JsiPropertyTable> getProperties() const {
+    return std::atomic_load(&_properties);
+  }
+
+  void setProperties(std::shared_ptr<const JsiPropertyTable> properties) {
+    std::atomic_store(&_properties, std::move(properties));
   }
 
-  void setObjectValue(jsi::Runtime &runtime, jsi::Object &obj) {
+  /**
+   Returns true for plain objects and arrays that are updated in place on
+   assignment
+   */
+  static bool isNested(const std::shared_ptr<JsiWrapper> &wrapper) {
+    return wrapper->getType() == JsiWrapperType::Object ||
+           wrapper->getType() == JsiWrapperType::Array;
+  }
+
+  /**
+   Sets the properties of a plain object, returns true if any changed
+   */
+  bool setObjectValue(jsi::Runtime &runtime, jsi::Object &obj) {
+    auto previous =
+        getType() == JsiWrapperType::Object ? getProperties() : nullptr;
     setType(JsiWrapperType::Object);
-    _properties.clear();
+
+    // Keep the wrappers of values that did not change, so that replacing a
+    // large object only allocates for the properties that changed.
+    JsiPropertyTable::Builder builder(previous);
     auto propNames = obj.getPropertyNames(runtime);
+    size_t keptCount = 0;
+    bool changed = previous == nullptr;
     for (size_t i = 0; i < propNames.size(runtime); i++) {
       auto nameString =
           propNames.getValueAtIndex(runtime, i).asString(runtime).utf8(runtime);
 
       auto value = obj.getProperty(runtime, nameString.c_str());
-      _properties.emplace(nameString, JsiWrapper::wrap(runtime, value, this));
+      auto property = previous != nullptr ? previous->get(nameString) : nullptr;
+      if (property != nullptr && property->hasSameValue(runtime, value)) {
+        builder.add(nameString, property);
+        keptCount++;
+      } else if (property != nullptr && isNested(property) &&
+                 property->canUpdateValue(runtime, value)) {
+        // Update nested objects and arrays in place without notifying, the
+        // assignment to this object is notified as a whole.
+        changed |= property->updateValueInPlace(runtime, value);
+        builder.add(nameString, property);
+        keptCount++;
+      } else {
+        builder.add(nameString, JsiWrapper::wrap(runtime, value, this));
+        changed = true;
+      }
     }
+    // Properties missing from the new object are removed
+    changed |= previous != nullptr && keptCount != previous->size();
+    setProperties(builder.build());
+    return changed;
   }
 
   void setHostObjectValue(jsi::Runtime &runtime, jsi::Object &obj) {
@@ -226,7 +313,8 @@ private:
     }
   }
 
-  std::map<std::string, std::shared_ptr<JsiWrapper>> _properties;
+  std::shared_ptr<const JsiPropertyTable> _properties =
+      std::make_shared<JsiPropertyTable>();
   std::shared_ptr<jsi::HostFunctionType> _hostFunction;
   std::shared_ptr<jsi::HostObject> _hostObject;
 };
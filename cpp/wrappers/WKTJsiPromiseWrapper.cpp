@@ -17,10 +17,95 @@ std::shared_ptr<JsiPromiseWrapper> JsiPromiseWrapper::createPromiseWrapper(
 
   // Create promise wrapper
   auto result = std::make_shared<JsiPromiseWrapper>(runtime);
+  result->countMemory(sizeof(JsiPromiseWrapper));
   result->runComputation(runtime, computation);
   return result;
 }
 
+jsi::Value
+JsiNativePromise::createPromise(jsi::Runtime &runtime,
+                                PromiseComputationFunction computation) {
+  auto promise = std::shared_ptr<JsiNativePromise>(new JsiNativePromise());
+  promise->_runtime = &runtime;
+  auto owningContext = JsiWorkletContext::getCurrent(runtime);
+  if (owningContext != nullptr) {
+    promise->_owningContext = owningContext->shared_from_this();
+  }
+
+  // The executor is called synchronously by the constructor
+  auto self = promise.get();
+  auto executor = jsi::Function::createFromHostFunction(
+      runtime, jsi::PropNameID::forAscii(runtime, "executor"), 2,
+      [self](jsi::Runtime &runtime, const jsi::Value &thisValue,
+             const jsi::Value *arguments, size_t count) -> jsi::Value {
+        self->_resolve = std::make_shared<jsi::Function>(
+            arguments[0].asObject(runtime).asFunction(runtime));
+        self->_reject = std::make_shared<jsi::Function>(
+            arguments[1].asObject(runtime).asFunction(runtime));
+        return jsi::Value::undefined();
+      });
+  auto result = runtime.global()
+                    .getPropertyAsFunction(runtime, "Promise")
+                    .callAsConstructor(runtime, executor);
+
+  try {
+    computation(runtime, promise);
+  } catch (const jsi::JSError &err) {
+    promise->reject(runtime,
+                    jsi::String::createFromUtf8(runtime, err.getMessage()));
+  } catch (const std::exception &err) {
+    promise->reject(runtime, jsi::String::createFromUtf8(runtime, err.what()));
+  } catch (...) {
+    promise->reject(runtime,
+                    jsi::String::createFromUtf8(
+                        runtime, "Unknown error in promise constructor."));
+  }
+  return result;
+}
+
+JsiNativePromise::~JsiNativePromise() {
+  if (_resolve == nullptr) {
+    return;
+  }
+  // Never settled, for example because the call was cancelled or its context
+  // went away. The functions must be released on the runtime's thread.
+  if (_owningContext == nullptr) {
+    JsiWorkletContext::getDefaultInstance()->invokeOnJsThread(
+        [resolve = std::move(_resolve),
+         reject = std::move(_reject)](jsi::Runtime &) mutable {
+          resolve = nullptr;
+          reject = nullptr;
+        });
+  } else {
+    _owningContext->invokeOnWorkletRuntime(
+        *_runtime, [resolve = std::move(_resolve), reject = std::move(_reject)](
+                       JsiWorkletContext *, jsi::Runtime &) mutable {
+          resolve = nullptr;
+          reject = nullptr;
+        });
+  }
+}
+
+void JsiNativePromise::resolve(jsi::Runtime &runtime,
+                               const jsi::Value &value) {
+  if (_resolve == nullptr) {
+    return;
+  }
+  auto resolve = std::move(_resolve);
+  _reject = nullptr;
+  resolve->call(runtime, value);
+}
+
+void JsiNativePromise::reject(jsi::Runtime &runtime,
+                              const jsi::Value &reason) {
+  if (_reject == nullptr) {
+    return;
+  }
+  auto reject = std::move(_reject);
+  _resolve = nullptr;
+  reject->call(runtime, reason);
+}
+
 void JsiPromiseWrapper::runComputation(jsi::Runtime &runtime,
                                        PromiseComputationFunction computation) {
   // Run the compute function to start resolving the promise
@@ -98,6 +183,7 @@ JsiPromiseWrapper::resolve(jsi::Runtime &runtime,
   auto retVal = std::make_shared<JsiPromiseWrapper>(
       runtime, jsi::Value::undefined(), nullptr);
   retVal->setType(JsiWrapperType::Promise);
+  retVal->countMemory(sizeof(JsiPromiseWrapper));
   retVal->onFulfilled(runtime, value->unwrap(runtime));
   return retVal;
 }
@@ -111,6 +197,7 @@ JsiPromiseWrapper::reject(jsi::Runtime &runtime,
   auto retVal = std::make_shared<JsiPromiseWrapper>(
       runtime, jsi::Value::undefined(), nullptr);
   retVal->setType(JsiWrapperType::Promise);
+  retVal->countMemory(sizeof(JsiPromiseWrapper));
   retVal->onRejected(runtime, reason->unwrap(runtime));
   return retVal;
 }
@@ -147,6 +234,7 @@ std::shared_ptr<JsiPromiseWrapper> JsiPromiseWrapper::then(
     const jsi::HostFunctionType &thenFn, const jsi::HostFunctionType &catchFn) {
 
   auto controlledPromise = std::make_shared<JsiPromiseWrapper>(runtime, this);
+  controlledPromise->countMemory(sizeof(JsiPromiseWrapper));
 
   _thenQueue.push_back({
       .controlledPromise = controlledPromise,
@@ -185,6 +273,7 @@ jsi::Value JsiPromiseWrapper::finally(jsi::Runtime &runtime,
   }
 
   auto controlledPromise = std::make_shared<JsiPromiseWrapper>(runtime, this);
+  controlledPromise->countMemory(sizeof(JsiPromiseWrapper));
 
   _finallyQueue.push_back({
       .controlledPromise = controlledPromise,
@@ -5,8 +5,10 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "WKTCancellationToken.h"
 #include "WKTJsiHostObject.h"
 #include "WKTJsiWorklet.h"
 #include "WKTJsiWrapper.h"
@@ -21,6 +23,7 @@ static const char *ThenPropName = "then";
 static const char *CatchPropName = "catch";
 
 class JsiPromiseWrapper;
+class JsiWorkletContext;
 
 struct PromiseQueueItem {
   std::shared_ptr<JsiPromiseWrapper> controlledPromise;
@@ -47,6 +50,38 @@ using PromiseRejectFunction =
 using PromiseComputationFunction = std::function<void(
     jsi::Runtime &runtime, std::shared_ptr<PromiseParameter> promise)>;
 
+/**
+ Engine-native promise created with the runtime's Promise constructor. Used
+ for promises that stay in the runtime they were created in, so that neither
+ the promise nor its then-chain allocate host objects. Must be settled on the
+ runtime's thread, a promise that is never settled releases its resolve and
+ reject functions there.
+ */
+class JsiNativePromise : public PromiseParameter {
+public:
+  /**
+   Creates a native promise and runs the computation that settles it
+   @param runtime Runtime to create the promise in
+   @param computation Function settling the promise
+   @return The promise
+   */
+  static jsi::Value createPromise(jsi::Runtime &runtime,
+                                  PromiseComputationFunction computation);
+
+  ~JsiNativePromise();
+
+  void resolve(jsi::Runtime &runtime, const jsi::Value &value) override;
+  void reject(jsi::Runtime &runtime, const jsi::Value &reason) override;
+
+private:
+  JsiNativePromise() {}
+
+  jsi::Runtime *_runtime = nullptr;
+  std::shared_ptr<JsiWorkletContext> _owningContext;
+  std::shared_ptr<jsi::Function> _resolve;
+  std::shared_ptr<jsi::Function> _reject;
+};
+
 /**
  Wraps a Promise so that it can be shared between multiple runtimes as arguments
  or return values.
@@ -107,10 +142,28 @@ public:
     return finally(runtime, thisValue, sideEffectsFn);
   }
 
+  JSI_HOST_FUNCTION(cancel) {
+    if (_cancellationToken == nullptr || _state != PromiseState::Pending) {
+      return false;
+    }
+    _cancellationToken->cancel();
+    onRejected(runtime, jsi::String::createFromUtf8(runtime, "Cancelled"));
+    return true;
+  }
+
   JSI_EXPORT_FUNCTIONS(JSI_EXPORT_FUNC_NAMED(JsiPromiseWrapper, _catch,
                                              "catch"),
                        JSI_EXPORT_FUNC(JsiPromiseWrapper, then),
-                       JSI_EXPORT_FUNC(JsiPromiseWrapper, finally))
+                       JSI_EXPORT_FUNC(JsiPromiseWrapper, finally),
+                       JSI_EXPORT_FUNC(JsiPromiseWrapper, cancel))
+
+  /**
+   Makes the promise cancellable. Cancelling rejects the promise and cancels
+   the token.
+   */
+  void setCancellationToken(std::shared_ptr<CancellationToken> token) {
+    _cancellationToken = std::move(token);
+  }
 
   /**
    Creates a wrapped promise that is resolved with the given value
@@ -181,5 +234,6 @@ private:
   std::shared_ptr<JsiWrapper> _reason;
   std::vector<PromiseQueueItem> _thenQueue;
   std::vector<FinallyQueueItem> _finallyQueue;
+  std::shared_ptr<CancellationToken> _cancellationToken;
 };
 } // namespace RNWorklet
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace RNWorklet {
+
+class JsiWrapper;
+
+/**
+ Immutable table of the properties of a wrapped object. Updates return a new
+ table sharing everything but the changed bucket with the old one, so
+ replacing one property in a large object copies a few dozen entries instead
+ of the whole object, and readers can keep using the table they have without
+ locking.
+ */
+class JsiPropertyTable {
+public:
+  typedef std::pair<std::string, std::shared_ptr<JsiWrapper>> Entry;
+  typedef std::vector<Entry> Bucket;
+
+  static constexpr size_t BucketCount = 64;
+
+  /**
+   Returns the wrapper for the property, or nullptr if not found
+   */
+  std::shared_ptr<JsiWrapper> get(const std::string &name) const {
+    auto &bucket = _buckets[getBucketIndex(name)];
+    if (bucket == nullptr) {
+      return nullptr;
+    }
+    auto it = find(*bucket, name);
+    if (it != bucket->end() && it->first == name) {
+      return it->second;
+    }
+    return nullptr;
+  }
+
+  /**
+   Returns a new table with the property set
+   */
+  std::shared_ptr<const JsiPropertyTable>
+  set(const std::string &name, std::shared_ptr<JsiWrapper> wrapper) const {
+    auto table = std::make_shared<JsiPropertyTable>(*this);
+    auto index = getBucketIndex(name);
+    auto bucket = _buckets[index] != nullptr
+                      ? std::make_shared<Bucket>(*_buckets[index])
+                      : std::make_shared<Bucket>();
+    auto it = find(*bucket, name);
+    if (it != bucket->end() && it->first == name) {
+      it->second = std::move(wrapper);
+    } else {
+      bucket->emplace(it, name, std::move(wrapper));
+      table->_size++;
+    }
+    table->_buckets[index] = std::move(bucket);
+    return table;
+  }
+
+  /**
+   Returns the number of properties
+   */
+  size_t size() const { return _size; }
+
+  /**
+   Calls the callback for each property, sorted by name
+   */
+  void forEach(const std::function<void(const Entry &)> &callback) const {
+    std::vector<const Entry *> entries;
+    entries.reserve(_size);
+    for (auto &bucket : _buckets) {
+      if (bucket != nullptr) {
+        for (auto &entry : *bucket) {
+          entries.push_back(&entry);
+        }
+      }
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry *a, const Entry *b) { return a->first < b->first; });
+    for (auto entry : entries) {
+      callback(*entry);
+    }
+  }
+
+  /**
+   Returns the name of the property holding the wrapper, or an empty string
+   */
+  std::string findName(const JsiWrapper *wrapper) const {
+    for (auto &bucket : _buckets) {
+      if (bucket != nullptr) {
+        for (auto &entry : *bucket) {
+          if (entry.second.get() == wrapper) {
+            return entry.first;
+          }
+        }
+      }
+    }
+    return "";
+  }
+
+  /**
+   Builds a table from scratch, reusing the buckets of a previous table when
+   their contents did not change.
+   */
+  class Builder {
+  public:
+    explicit Builder(std::shared_ptr<const JsiPropertyTable> previous)
+        : _previous(std::move(previous)) {}
+
+    void add(const std::string &name, std::shared_ptr<JsiWrapper> wrapper) {
+      _entries[getBucketIndex(name)].emplace_back(name, std::move(wrapper));
+    }
+
+    std::shared_ptr<const JsiPropertyTable> build() {
+      auto table = std::make_shared<JsiPropertyTable>();
+      for (size_t i = 0; i < BucketCount; i++) {
+        auto &entries = _entries[i];
+        if (entries.empty()) {
+          continue;
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry &a, const Entry &b) {
+                    return a.first < b.first;
+                  });
+        table->_size += entries.size();
+
+        auto &previous = _previous != nullptr ? _previous->_buckets[i]
+                                              : table->_buckets[i];
+        if (previous != nullptr && *previous == entries) {
+          table->_buckets[i] = previous;
+        } else {
+          table->_buckets[i] = std::make_shared<Bucket>(std::move(entries));
+        }
+      }
+      return table;
+    }
+
+  private:
+    std::shared_ptr<const JsiPropertyTable> _previous;
+    std::array<Bucket, BucketCount> _entries;
+  };
+
+private:
+  static size_t getBucketIndex(const std::string &name) {
+    return std::hash<std::string>()(name) & (BucketCount - 1);
+  }
+
+  static Bucket::iterator find(Bucket &bucket, const std::string &name) {
+    return std::lower_bound(
+        bucket.begin(), bucket.end(), name,
+        [](const Entry &entry, const std::string &n) { return entry.first < n; });
+  }
+
+  static Bucket::const_iterator find(const Bucket &bucket,
+                                     const std::string &name) {
+    return std::lower_bound(
+        bucket.begin(), bucket.end(), name,
+        [](const Entry &entry, const std::string &n) { return entry.first < n; });
+  }
+
+  static_assert((BucketCount & (BucketCount - 1)) == 0,
+                "BucketCount must be a power of two");
+
+  std::array<std::shared_ptr<const Bucket>, BucketCount> _buckets;
+  size_t _size = 0;
+};
+
+} // namespace RNWorklet
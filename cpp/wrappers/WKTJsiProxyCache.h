@@ -0,0 +1,182 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Proxy factories, the proxies created for wrappers and built-in functions
+ looked up from global in a single runtime.
+ Proxies are held weakly, so reading the same wrapper again returns the same
+ proxy for as long as JS keeps it alive. A live proxy keeps its wrapper alive
+ through its target, so an entry can't outlive the wrapper it was created
+ for. Caches must only be used on the runtime's thread, and must be cleared
+ before the runtime is destroyed.
+ */
+class JsiProxyCache {
+public:
+  /**
+   Returns the cache for the runtime
+   */
+  static std::shared_ptr<JsiProxyCache> get(jsi::Runtime &runtime) {
+    std::lock_guard<std::mutex> lock(getMutex());
+    auto &caches = getCaches();
+    auto it = caches.find(&runtime);
+    if (it == caches.end()) {
+      it = caches.emplace(&runtime, std::make_shared<JsiProxyCache>()).first;
+    }
+    return it->second;
+  }
+
+  /**
+   Drops the cache for the runtime
+   @param runtime Runtime to drop the cache for
+   @param releaseObjects Release the cached objects. Pass false if the
+   runtime might already be destroyed, the objects are leaked instead.
+   */
+  static void clear(jsi::Runtime &runtime, bool releaseObjects = true) {
+    std::shared_ptr<JsiProxyCache> cache;
+    {
+      std::lock_guard<std::mutex> lock(getMutex());
+      auto &caches = getCaches();
+      auto it = caches.find(&runtime);
+      if (it == caches.end()) {
+        return;
+      }
+      cache = it->second;
+      caches.erase(it);
+    }
+    if (!releaseObjects) {
+      for (auto &factory : cache->_factories) {
+        factory.second.release();
+      }
+      for (auto &proxy : cache->_proxies) {
+        proxy.second.release();
+      }
+      for (auto &function : cache->_functions) {
+        function.second.release();
+      }
+    }
+  }
+
+  /**
+   Returns the proxy for the host object, creating it with the factory
+   installed on global under factoryName if there is no live one.
+   @param key Identifies the value the proxy is created for
+   @param factoryName Global the factory is installed as
+   @param factoryCode Source of the factory, evaluated on first use
+   */
+  jsi::Value getProxy(jsi::Runtime &runtime, const void *key,
+                      const char *factoryName, const std::string &factoryCode,
+                      std::shared_ptr<jsi::HostObject> hostObj) {
+    auto it = _proxies.find(key);
+    if (it != _proxies.end()) {
+      auto proxy = it->second->lock(runtime);
+      if (proxy.isObject()) {
+        return proxy;
+      }
+      _proxies.erase(it);
+    }
+
+    auto proxy = getFactory(runtime, factoryName, factoryCode)
+                     .call(runtime, jsi::Object::createFromHostObject(
+                                        runtime, std::move(hostObj)));
+    if (proxy.isObject()) {
+      sweep(runtime);
+      _proxies.emplace(key, std::make_unique<jsi::WeakObject>(
+                                runtime, proxy.asObject(runtime)));
+    }
+    return proxy;
+  }
+
+  /**
+   Returns the function global[objectName][functionName], looked up on first
+   use only. Returns nullptr if there is no such function.
+   */
+  jsi::Function *getGlobalFunction(jsi::Runtime &runtime,
+                                   const char *objectName,
+                                   const char *functionName) {
+    auto key = std::string(objectName) + "." + functionName;
+    auto it = _functions.find(key);
+    if (it == _functions.end()) {
+      std::unique_ptr<jsi::Function> function;
+      auto object = runtime.global().getProperty(runtime, objectName);
+      if (object.isObject()) {
+        auto value =
+            object.asObject(runtime).getProperty(runtime, functionName);
+        if (value.isObject() && value.asObject(runtime).isFunction(runtime)) {
+          function = std::make_unique<jsi::Function>(
+              value.asObject(runtime).asFunction(runtime));
+        }
+      }
+      it = _functions.emplace(key, std::move(function)).first;
+    }
+    return it->second.get();
+  }
+
+private:
+  /**
+   Entries are swept for collected proxies whenever the map has doubled
+   */
+  static constexpr size_t MinSweepSize = 64;
+
+  jsi::Function &getFactory(jsi::Runtime &runtime, const char *factoryName,
+                            const std::string &factoryCode) {
+    auto &factory = _factories[factoryName];
+    if (factory == nullptr) {
+      auto function = runtime.global().getProperty(runtime, factoryName);
+      if (function.isUndefined()) {
+        // Install worklet proxy helper into runtime
+        auto codeBuffer = std::make_shared<const jsi::StringBuffer>(
+            "(" + factoryCode + "\n)");
+        function = runtime.evaluateJavaScript(codeBuffer, factoryName);
+        runtime.global().setProperty(runtime, factoryName, function);
+      }
+      factory = std::make_unique<jsi::Function>(
+          function.asObject(runtime).asFunction(runtime));
+    }
+    return *factory;
+  }
+
+  void sweep(jsi::Runtime &runtime) {
+    if (_proxies.size() < _sweepSize) {
+      return;
+    }
+    for (auto it = _proxies.begin(); it != _proxies.end();) {
+      if (it->second->lock(runtime).isObject()) {
+        ++it;
+      } else {
+        it = _proxies.erase(it);
+      }
+    }
+    _sweepSize = std::max(MinSweepSize, _proxies.size() * 2);
+  }
+
+  static std::mutex &getMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::map<jsi::Runtime *, std::shared_ptr<JsiProxyCache>> &
+  getCaches() {
+    static std::map<jsi::Runtime *, std::shared_ptr<JsiProxyCache>> caches;
+    return caches;
+  }
+
+  std::map<std::string, std::unique_ptr<jsi::Function>> _factories;
+  std::unordered_map<const void *, std::unique_ptr<jsi::WeakObject>> _proxies;
+  // Null for functions that were not found
+  std::map<std::string, std::unique_ptr<jsi::Function>> _functions;
+  size_t _sweepSize = MinSweepSize;
+};
+
+} // namespace RNWorklet
@@ -0,0 +1,329 @@
+#include "WKTJsiSerializer.h"
+#include "WKTJsiArrayBufferWrapper.h"
+#include "WKTJsiPromiseWrapper.h"
+
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+// Objects nested deeper than this are most likely cyclic
+static const size_t MaxSerializationDepth = 128;
+
+enum class SerializedTag : uint8_t {
+  Undefined,
+  Null,
+  True,
+  False,
+  Number,
+  String,
+  Array,
+  Object,
+  // Run of numbers inside an array: count followed by packed doubles
+  NumberRun,
+  // New object key: length and utf8 bytes, gets the next key index
+  KeyDef,
+  // Previously defined object key: key index
+  KeyRef,
+  // Value kept in the wrapper list: wrapper index
+  Wrapped
+};
+
+class JsiSerializedValues::Writer {
+public:
+  Writer(jsi::Runtime &runtime, std::vector<uint8_t> &buffer,
+         std::vector<std::shared_ptr<JsiWrapper>> &wrappers)
+      : _runtime(runtime), _buffer(buffer), _wrappers(wrappers) {}
+
+  void write(const jsi::Value &value, size_t depth) {
+    if (value.isUndefined()) {
+      writeTag(SerializedTag::Undefined);
+    } else if (value.isNull()) {
+      writeTag(SerializedTag::Null);
+    } else if (value.isBool()) {
+      writeTag(value.getBool() ? SerializedTag::True : SerializedTag::False);
+    } else if (value.isNumber()) {
+      writeTag(SerializedTag::Number);
+      writeNumber(value.getNumber());
+    } else if (value.isString()) {
+      writeTag(SerializedTag::String);
+      writeString(value.getString(_runtime).utf8(_runtime));
+    } else if (value.isObject()) {
+      if (depth > MaxSerializationDepth) {
+        throw jsi::JSError(_runtime,
+                           "Could not serialize value, the maximum depth of " +
+                               std::to_string(MaxSerializationDepth) +
+                               " was exceeded. Does the value contain cycles?");
+      }
+      writeObject(value, depth);
+    } else {
+      throw jsi::JSError(_runtime, "Value type not supported.");
+    }
+  }
+
+private:
+  void writeObject(const jsi::Value &value, size_t depth) {
+    auto obj = value.getObject(_runtime);
+    if (obj.isHostObject(_runtime) || obj.isFunction(_runtime) ||
+        JsiArrayBufferWrapper::isArrayBufferOrView(_runtime, obj) ||
+        JsiPromiseWrapper::isThenable(_runtime, obj)) {
+      // Can't be copied, keep as wrapper
+      writeTag(SerializedTag::Wrapped);
+      writeSize(_wrappers.size());
+      _wrappers.push_back(JsiWrapper::wrap(_runtime, value));
+      return;
+    }
+
+    if (obj.isArray(_runtime)) {
+      writeArray(obj.getArray(_runtime), depth);
+      return;
+    }
+
+    auto propNames = obj.getPropertyNames(_runtime);
+    auto size = propNames.size(_runtime);
+    writeTag(SerializedTag::Object);
+    writeSize(size);
+    for (size_t i = 0; i < size; i++) {
+      auto nameValue = propNames.getValueAtIndex(_runtime, i);
+      auto nameString = nameValue.getString(_runtime);
+      writeKey(nameString.utf8(_runtime));
+      write(obj.getProperty(_runtime, nameString), depth + 1);
+    }
+  }
+
+  void writeArray(const jsi::Array &arr, size_t depth) {
+    auto size = arr.size(_runtime);
+    writeTag(SerializedTag::Array);
+    writeSize(size);
+
+    // Consecutive numbers are written as a run, the run count is patched in
+    // when the run ends.
+    size_t runCountOffset = 0;
+    uint32_t runCount = 0;
+    for (size_t i = 0; i < size; i++) {
+      auto element = arr.getValueAtIndex(_runtime, i);
+      if (element.isNumber()) {
+        if (runCount == 0) {
+          writeTag(SerializedTag::NumberRun);
+          runCountOffset = _buffer.size();
+          writeUint32(0);
+        }
+        writeNumber(element.getNumber());
+        runCount++;
+        continue;
+      }
+      if (runCount > 0) {
+        patchUint32(runCountOffset, runCount);
+        runCount = 0;
+      }
+      write(element, depth + 1);
+    }
+    if (runCount > 0) {
+      patchUint32(runCountOffset, runCount);
+    }
+  }
+
+  void writeKey(const std::string &key) {
+    auto it = _keys.find(key);
+    if (it != _keys.end()) {
+      writeTag(SerializedTag::KeyRef);
+      writeSize(it->second);
+      return;
+    }
+    auto index = _keys.size();
+    _keys.emplace(key, index);
+    writeTag(SerializedTag::KeyDef);
+    writeString(key);
+  }
+
+  void writeTag(SerializedTag tag) {
+    _buffer.push_back(static_cast<uint8_t>(tag));
+  }
+
+  void writeNumber(double number) { writeBytes(&number, sizeof(number)); }
+
+  void writeUint32(uint32_t value) { writeBytes(&value, sizeof(value)); }
+
+  void patchUint32(size_t offset, uint32_t value) {
+    std::memcpy(_buffer.data() + offset, &value, sizeof(value));
+  }
+
+  // Sizes and indexes are written as LEB128 varints, most are tiny
+  void writeSize(size_t size) {
+    while (size >= 0x80) {
+      _buffer.push_back(static_cast<uint8_t>(size | 0x80));
+      size >>= 7;
+    }
+    _buffer.push_back(static_cast<uint8_t>(size));
+  }
+
+  void writeString(const std::string &str) {
+    writeSize(str.size());
+    writeBytes(str.data(), str.size());
+  }
+
+  void writeBytes(const void *data, size_t size) {
+    auto offset = _buffer.size();
+    _buffer.resize(offset + size);
+    if (size > 0) {
+      std::memcpy(_buffer.data() + offset, data, size);
+    }
+  }
+
+  jsi::Runtime &_runtime;
+  std::vector<uint8_t> &_buffer;
+  std::vector<std::shared_ptr<JsiWrapper>> &_wrappers;
+  std::unordered_map<std::string, size_t> _keys;
+};
+
+class JsiSerializedValues::Reader {
+public:
+  Reader(jsi::Runtime &runtime, const std::vector<uint8_t> &buffer,
+         const std::vector<std::shared_ptr<JsiWrapper>> &wrappers)
+      : _runtime(runtime), _data(buffer.data()), _end(buffer.data() +
+                                                     buffer.size()),
+        _wrappers(wrappers) {}
+
+  jsi::Value read() { return readValue(readTag()); }
+
+private:
+  jsi::Value readValue(SerializedTag tag) {
+    switch (tag) {
+    case SerializedTag::Undefined:
+      return jsi::Value::undefined();
+    case SerializedTag::Null:
+      return jsi::Value::null();
+    case SerializedTag::True:
+      return jsi::Value(true);
+    case SerializedTag::False:
+      return jsi::Value(false);
+    case SerializedTag::Number:
+      return jsi::Value(readNumber());
+    case SerializedTag::String: {
+      auto size = readSize();
+      auto data = readBytes(size);
+      return jsi::String::createFromUtf8(_runtime, data, size);
+    }
+    case SerializedTag::Array:
+      return readArray();
+    case SerializedTag::Object:
+      return readObject();
+    case SerializedTag::Wrapped:
+      return JsiWrapper::unwrap(_runtime, _wrappers.at(readSize()));
+    default:
+      throw jsi::JSError(_runtime, "Invalid serialized value.");
+    }
+  }
+
+  jsi::Value readArray() {
+    auto size = readSize();
+    auto arr = jsi::Array(_runtime, size);
+    size_t i = 0;
+    while (i < size) {
+      auto tag = readTag();
+      if (tag == SerializedTag::NumberRun) {
+        auto runCount = readUint32();
+        for (uint32_t n = 0; n < runCount; n++) {
+          arr.setValueAtIndex(_runtime, i++, jsi::Value(readNumber()));
+        }
+      } else {
+        arr.setValueAtIndex(_runtime, i++, readValue(tag));
+      }
+    }
+    return arr;
+  }
+
+  jsi::Value readObject() {
+    auto size = readSize();
+    auto obj = jsi::Object(_runtime);
+    for (size_t i = 0; i < size; i++) {
+      auto &key = readKey();
+      obj.setProperty(_runtime, key, read());
+    }
+    return obj;
+  }
+
+  const jsi::PropNameID &readKey() {
+    auto tag = readTag();
+    if (tag == SerializedTag::KeyRef) {
+      return _keys.at(readSize());
+    }
+    if (tag != SerializedTag::KeyDef) {
+      throw jsi::JSError(_runtime, "Invalid serialized object key.");
+    }
+    auto size = readSize();
+    auto data = readBytes(size);
+    _keys.push_back(jsi::PropNameID::forUtf8(_runtime, data, size));
+    return _keys.back();
+  }
+
+  SerializedTag readTag() { return static_cast<SerializedTag>(*readBytes(1)); }
+
+  double readNumber() {
+    double number;
+    std::memcpy(&number, readBytes(sizeof(number)), sizeof(number));
+    return number;
+  }
+
+  uint32_t readUint32() {
+    uint32_t value;
+    std::memcpy(&value, readBytes(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  size_t readSize() {
+    size_t size = 0;
+    size_t shift = 0;
+    uint8_t byte;
+    do {
+      byte = *readBytes(1);
+      size |= static_cast<size_t>(byte & 0x7F) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+    return size;
+  }
+
+  const uint8_t *readBytes(size_t size) {
+    if (static_cast<size_t>(_end - _data) < size) {
+      throw jsi::JSError(_runtime, "Invalid serialized value.");
+    }
+    auto data = _data;
+    _data += size;
+    return data;
+  }
+
+  jsi::Runtime &_runtime;
+  const uint8_t *_data;
+  const uint8_t *_end;
+  const std::vector<std::shared_ptr<JsiWrapper>> &_wrappers;
+  // References to keys must stay valid while reading the value
+  std::deque<jsi::PropNameID> _keys;
+};
+
+JsiSerializedValues::JsiSerializedValues(jsi::Runtime &runtime,
+                                         const jsi::Value *values,
+                                         size_t count)
+    : _count(count) {
+  _buffer.reserve(256);
+  Writer writer(runtime, _buffer, _wrappers);
+  for (size_t i = 0; i < count; i++) {
+    writer.write(values[i], 0);
+  }
+}
+
+std::vector<jsi::Value>
+JsiSerializedValues::deserialize(jsi::Runtime &runtime) const {
+  Reader reader(runtime, _buffer, _wrappers);
+  std::vector<jsi::Value> values(_count);
+  for (size_t i = 0; i < _count; i++) {
+    values[i] = reader.read();
+  }
+  return values;
+}
+
+} // namespace RNWorklet
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <jsi/jsi.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "WKTJsiWrapper.h"
+
+namespace RNWorklet {
+
+namespace jsi = facebook::jsi;
+
+/**
+ Values serialized into a single contiguous buffer so that they can be moved
+ between runtimes with a constant number of allocations. Primitives are
+ stored tagged, object keys are interned and runs of numbers in arrays are
+ stored as packed doubles.
+
+ Values that can't be copied - functions, host objects, promises and array
+ buffers - are kept as JsiWrappers in a side list and referenced by index
+ from the buffer.
+ */
+class JsiSerializedValues {
+public:
+  /**
+   Serializes the values
+   @param runtime Runtime the values belong to
+   @param values Values to serialize
+   @param count Number of values
+   */
+  JsiSerializedValues(jsi::Runtime &runtime, const jsi::Value *values,
+                      size_t count);
+
+  /**
+   Returns the number of serialized values
+   */
+  size_t getCount() const { return _count; }
+
+  /**
+   Returns the number of bytes used by the serialized values
+   */
+  size_t getByteSize() const { return _buffer.size(); }
+
+  /**
+   Deserializes the values into the given runtime. Can be called more than
+   once, each call creates new values.
+   */
+  std::vector<jsi::Value> deserialize(jsi::Runtime &runtime) const;
+
+private:
+  class Writer;
+  class Reader;
+
+  size_t _count;
+  std::vector<uint8_t> _buffer;
+  std::vector<std::shared_ptr<JsiWrapper>> _wrappers;
+};
+
+} // namespace RNWorklet
@@ -1,5 +1,7 @@
 #include "WKTJsiWrapper.h"
+#include "WKTJsiArrayBufferWrapper.h"
 #include "WKTJsiArrayWrapper.h"
+#include "WKTJsiBlockPool.h"
 #include "WKTJsiObjectWrapper.h"
 #include "WKTJsiPromiseWrapper.h"
 
@@ -7,17 +9,75 @@ namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
 
+namespace {
+
+/**
+ Wrappers are created and dropped for every argument passed between
+ contexts, so they are allocated from the block pool
+ */
+template <typename T>
+std::shared_ptr<JsiWrapper> createWrapper(jsi::Runtime &runtime,
+                                          const jsi::Value &value,
+                                          JsiWrapper *parent,
+                                          size_t &bytes) {
+  bytes = sizeof(T);
+  return std::allocate_shared<T>(JsiPoolAllocator<T>(), runtime, value,
+                                 parent);
+}
+
+} // namespace
+
+bool JsiWrapper::tryGetPrimitiveValue(jsi::Value &result) {
+  for (int i = 0; i < SeqLockRetries; i++) {
+    auto sequence = _sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      // Write in progress
+      continue;
+    }
+    auto type = _type.load(std::memory_order_relaxed);
+    auto boolValue = _boolValue.load(std::memory_order_relaxed);
+    auto numberValue = _numberValue.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_sequence.load(std::memory_order_relaxed) != sequence) {
+      continue;
+    }
+
+    switch (type) {
+    case JsiWrapperType::Undefined:
+      result = jsi::Value::undefined();
+      return true;
+    case JsiWrapperType::Null:
+      result = jsi::Value::null();
+      return true;
+    case JsiWrapperType::Bool:
+      result = jsi::Value(boolValue);
+      return true;
+    case JsiWrapperType::Number:
+      result = jsi::Value(numberValue);
+      return true;
+    default:
+      return false;
+    }
+  }
+  return false;
+}
+
 jsi::Value JsiWrapper::getValue(jsi::Runtime &runtime) {
-  std::unique_lock<std::mutex> lock(*_readWriteMutex);
-  switch (_type) {
+  jsi::Value result;
+  if (tryGetPrimitiveValue(result)) {
+    return result;
+  }
+
+  auto lock = readLock();
+  switch (getType()) {
   case JsiWrapperType::Undefined:
     return jsi::Value::undefined();
   case JsiWrapperType::Null:
     return jsi::Value::null();
   case JsiWrapperType::Bool:
-    return jsi::Value(_boolValue);
+    return jsi::Value(_boolValue.load(std::memory_order_relaxed));
   case JsiWrapperType::Number:
-    return jsi::Value(static_cast<double>(_numberValue));
+    return jsi::Value(_numberValue.load(std::memory_order_relaxed));
   case JsiWrapperType::String:
     return jsi::String::createFromUtf8(runtime, _stringValue);
   default:
@@ -30,19 +90,23 @@ std::shared_ptr<JsiWrapper> JsiWrapper::wrap(jsi::Runtime &runtime,
                                              const jsi::Value &value,
                                              JsiWrapper *parent) {
   std::shared_ptr<JsiWrapper> retVal = nullptr;
+  size_t bytes = 0;
 
   if (value.isUndefined() || value.isNull() || value.isBool() ||
       value.isNumber() || value.isString()) {
-    retVal = std::make_shared<JsiWrapper>(runtime, value, parent);
+    retVal = createWrapper<JsiWrapper>(runtime, value, parent, bytes);
   } else if (value.isObject()) {
     auto obj = value.asObject(runtime);
     if (obj.isArray(runtime)) {
-      retVal = std::make_shared<JsiArrayWrapper>(runtime, value, parent);
+      retVal = createWrapper<JsiArrayWrapper>(runtime, value, parent, bytes);
+    } else if (JsiArrayBufferWrapper::isArrayBufferOrView(runtime, obj)) {
+      retVal = createWrapper<JsiArrayBufferWrapper>(runtime, value, parent,
+                                                    bytes);
     } else if (!obj.isHostObject(runtime) &&
                JsiPromiseWrapper::isThenable(runtime, obj)) {
-      retVal = std::make_shared<JsiPromiseWrapper>(runtime, value, parent);
+      retVal = createWrapper<JsiPromiseWrapper>(runtime, value, parent, bytes);
     } else {
-      retVal = std::make_shared<JsiObjectWrapper>(runtime, value, parent);
+      retVal = createWrapper<JsiObjectWrapper>(runtime, value, parent, bytes);
     }
   }
 
@@ -52,35 +116,89 @@ std::shared_ptr<JsiWrapper> JsiWrapper::wrap(jsi::Runtime &runtime,
   }
 
   retVal->setValue(runtime, value);
+  retVal->countMemory(bytes);
   return retVal;
 }
 
 void JsiWrapper::setValue(jsi::Runtime &runtime, const jsi::Value &value) {
+  if (!value.isUndefined() && !value.isNull() && !value.isBool() &&
+      !value.isNumber() && !value.isString()) {
+    throw jsi::JSError(runtime, "Value type not supported.");
+  }
+
+  // Convert strings before entering the write section
+  std::string stringValue;
+  if (value.isString()) {
+    stringValue = value.asString(runtime).utf8(runtime);
+  }
+
+  auto sequence = _sequence.load(std::memory_order_relaxed);
+  _sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
   if (value.isUndefined()) {
-    _type = JsiWrapperType::Undefined;
+    _type.store(JsiWrapperType::Undefined, std::memory_order_relaxed);
   } else if (value.isNull()) {
-    _type = JsiWrapperType::Null;
+    _type.store(JsiWrapperType::Null, std::memory_order_relaxed);
   } else if (value.isBool()) {
-    _type = JsiWrapperType::Bool;
-    _boolValue = value.getBool();
+    _type.store(JsiWrapperType::Bool, std::memory_order_relaxed);
+    _boolValue.store(value.getBool(), std::memory_order_relaxed);
   } else if (value.isNumber()) {
-    _type = JsiWrapperType::Number;
-    _numberValue = value.getNumber();
-  } else if (value.isString()) {
-    _type = JsiWrapperType::String;
-    _stringValue = value.asString(runtime).utf8(runtime);
+    _type.store(JsiWrapperType::Number, std::memory_order_relaxed);
+    _numberValue.store(value.getNumber(), std::memory_order_relaxed);
   } else {
-    throw jsi::JSError(runtime, "Value type not supported.");
+    // Strings are read under the read lock
+    _type.store(JsiWrapperType::String, std::memory_order_relaxed);
+    _stringValue = std::move(stringValue);
   }
+
+  _sequence.store(sequence + 2, std::memory_order_release);
 }
 
 void JsiWrapper::updateValue(jsi::Runtime &runtime, const jsi::Value &value) {
-  std::unique_lock<std::mutex> lock(*_readWriteMutex);
-  setValue(runtime, value);
-  // Notify changes
+  {
+    auto lock = writeLock();
+    setValue(runtime, value);
+  }
+  // Notify changes outside of the lock so that listeners can read the value
   notify();
 }
 
+bool JsiWrapper::updateValueInPlace(jsi::Runtime &runtime,
+                                    const jsi::Value &value) {
+  if (hasSameValue(runtime, value)) {
+    return false;
+  }
+  auto lock = writeLock();
+  setValue(runtime, value);
+  return true;
+}
+
+bool JsiWrapper::hasSameValue(jsi::Runtime &runtime, const jsi::Value &value) {
+  switch (getType()) {
+  case JsiWrapperType::Undefined:
+    return value.isUndefined();
+  case JsiWrapperType::Null:
+    return value.isNull();
+  case JsiWrapperType::Bool:
+    return value.isBool() &&
+           value.getBool() == _boolValue.load(std::memory_order_relaxed);
+  case JsiWrapperType::Number:
+    return value.isNumber() &&
+           value.getNumber() == _numberValue.load(std::memory_order_relaxed);
+  case JsiWrapperType::String: {
+    if (!value.isString()) {
+      return false;
+    }
+    auto str = value.asString(runtime).utf8(runtime);
+    auto lock = readLock();
+    return getType() == JsiWrapperType::String && str == _stringValue;
+  }
+  default:
+    return false;
+  }
+}
+
 bool JsiWrapper::canUpdateValue(jsi::Runtime &runtime,
                                 const jsi::Value &value) {
   if (value.isUndefined() || value.isNull() || value.isBool() ||
@@ -92,23 +210,16 @@ bool JsiWrapper::canUpdateValue(jsi::Runtime &runtime,
 }
 
 std::string JsiWrapper::toString(jsi::Runtime &runtime) {
-  switch (_type) {
+  auto lock = readLock();
+  switch (getType()) {
   case JsiWrapperType::Undefined:
     return "undefined";
   case JsiWrapperType::Null:
     return "NULL";
   case JsiWrapperType::Bool:
-    return std::to_string(_boolValue);
-  case JsiWrapperType::Number: {
-    // check if fraction is empty
-    auto fraction = _numberValue - (long)_numberValue;
-    if (fraction == 0.0) {
-      return std::to_string(static_cast<long>(_numberValue));
-    }
-    std::string str = std::to_string(_numberValue);
-    str.erase(str.find_last_not_of('0') + 1, std::string::npos);
-    return str;
-  }
+    return std::to_string(_boolValue.load(std::memory_order_relaxed));
+  case JsiWrapperType::Number:
+    return numberToString(_numberValue.load(std::memory_order_relaxed));
   case JsiWrapperType::String:
     return _stringValue;
   case JsiWrapperType::Promise:
@@ -119,6 +230,17 @@ std::string JsiWrapper::toString(jsi::Runtime &runtime) {
   }
 }
 
+std::string JsiWrapper::numberToString(double number) {
+  // check if fraction is empty
+  auto fraction = number - (long)number;
+  if (fraction == 0.0) {
+    return std::to_string(static_cast<long>(number));
+  }
+  std::string str = std::to_string(number);
+  str.erase(str.find_last_not_of('0') + 1, std::string::npos);
+  return str;
+}
+
 jsi::Value JsiWrapper::callFunction(jsi::Runtime &runtime,
                                     const jsi::Function &func,
                                     const jsi::Value &thisValue,
@@ -1,19 +1,34 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 
 #include <jsi/jsi.h>
 
+#include "WKTJsiMemoryStats.h"
+#include "WKTJsiProxyCache.h"
+
 namespace RNWorklet {
 
 namespace jsi = facebook::jsi;
 
 static const char *WorkletObjectProxyName = "__createWorkletObjectProxy";
 
+/**
+ Listener for changes in a wrapped value. Called with the paths of the values
+ that changed, relative to the value the listener was added to - an empty
+ path is the value itself, nested values use dot separated keys and indexes
+ ("position.x", "items.2").
+ */
+typedef std::function<void(const std::vector<std::string> &changedPaths)>
+    JsiWrapperListener;
+
 enum JsiWrapperType {
   Undefined,
   Null,
@@ -24,9 +39,15 @@ enum JsiWrapperType {
   Object,
   Promise,
   HostObject,
-  HostFunction
+  HostFunction,
+  ArrayBuffer,
+  // Number of wrapper types, keep last
+  JsiWrapperTypeCount
 };
 
+static_assert(JsiMemoryStats::WrapperTypeCount == JsiWrapperTypeCount,
+              "JsiMemoryStats::WrapperTypeCount must match JsiWrapperType");
+
 class JsiWrapper {
 public:
   /**
@@ -51,6 +72,13 @@ public:
   JsiWrapper(jsi::Runtime &runtime, const jsi::Value &value, JsiWrapper *parent)
       : JsiWrapper(parent) {}
 
+  virtual ~JsiWrapper() {
+    if (_contextCounter != nullptr) {
+      JsiMemoryStats::getWrapperCounter(_countedType).remove(_countedBytes);
+      _contextCounter->remove(_countedBytes);
+    }
+  }
+
   /**
    * Returns a wrapper for the a jsi value
    * @param runtime Runtime to wrap value in
@@ -113,27 +141,46 @@ public:
    */
   virtual void updateValue(jsi::Runtime &runtime, const jsi::Value &value);
 
+  /**
+   Updates the value without notifying listeners. Used by parents updating
+   their children in place as part of their own update.
+   @return True if the value changed
+   */
+  virtual bool updateValueInPlace(jsi::Runtime &runtime,
+                                  const jsi::Value &value);
+
   /**
    Returns true if the value provided can be contained in the wrapped instance.
    */
   virtual bool canUpdateValue(jsi::Runtime &runtime, const jsi::Value &value);
 
+  /**
+   Returns true if the wrapper holds a primitive value equal to the value.
+   Always false for objects, arrays and other composite values.
+   */
+  bool hasSameValue(jsi::Runtime &runtime, const jsi::Value &value);
+
   /**
    * @return The type of wrapper
    */
-  JsiWrapperType getType() { return _type; }
+  JsiWrapperType getType() { return _type.load(std::memory_order_relaxed); }
 
   /**
    * Returns the object as a string
    */
   virtual std::string toString(jsi::Runtime &runtime);
 
+  /**
+   * Returns the number as a string, without trailing zeros in the fraction
+   */
+  static std::string numberToString(double number);
+
   /**
    * Add listener
    * @param listener callback to notify
    * @return id of the listener - used for removing the listener
    */
-  size_t addListener(std::shared_ptr<std::function<void()>> listener) {
+  size_t addListener(std::shared_ptr<JsiWrapperListener> listener) {
     auto id = _listenerId++;
     _listeners.emplace(id, listener);
     return id;
@@ -160,12 +207,57 @@ protected:
    * Call to notify parent that something has changed
    */
   void notify() {
+    // Resolving paths has a cost, skip it if nobody is listening
+    if (hasListeners()) {
+      notify(std::string());
+    }
+  }
+
+  /**
+   * Returns true if this wrapper or one of its parents has listeners
+   */
+  bool hasListeners() {
+    for (auto wrapper = this; wrapper != nullptr; wrapper = wrapper->_parent) {
+      if (!wrapper->_listeners.empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * Notifies listeners on this wrapper and its parents about a change
+   * @param path Path of the changed value, relative to this wrapper
+   */
+  void notify(const std::string &path) {
+    notify(std::vector<std::string>{path});
+  }
+
+  /**
+   * Notifies listeners on this wrapper and its parents about changes, each
+   * listener is called once with all paths
+   * @param paths Paths of the changed values, relative to this wrapper
+   */
+  void notify(const std::vector<std::string> &paths) {
     if (_parent != nullptr) {
-      _parent->notify();
+      auto key = _parent->getChildKey(this);
+      std::vector<std::string> parentPaths;
+      parentPaths.reserve(paths.size());
+      for (const auto &path : paths) {
+        parentPaths.push_back(path.empty() ? key : key + "." + path);
+      }
+      _parent->notify(parentPaths);
     }
-    notifyListeners();
+    notifyListeners(paths);
   }
 
+  /**
+   * Returns the key of a child wrapper in this wrapper, used for building the
+   * paths passed to listeners.
+   * @param child Child wrapper
+   */
+  virtual std::string getChildKey(const JsiWrapper *child) { return ""; }
+
   /**
    Returns self as a proxy object or a regular value, depending on wether the
    value needs to be a proxy.
@@ -178,7 +270,9 @@ protected:
    * Update the type
    * @param type Type to set
    */
-  void setType(JsiWrapperType type) { _type = type; }
+  void setType(JsiWrapperType type) {
+    _type.store(type, std::memory_order_relaxed);
+  }
 
   /**
    * @return The parent object
@@ -208,73 +302,112 @@ protected:
    */
   virtual jsi::Value getValue(jsi::Runtime &runtime);
 
+  /**
+   Takes the wrapper's lock for reading. Composite wrappers hold it while
+   reading their structure, readers don't block each other.
+   */
+  std::shared_lock<std::shared_mutex> readLock() const {
+    return std::shared_lock<std::shared_mutex>(_readWriteMutex);
+  }
+
+  /**
+   Takes the wrapper's lock for writing. Never call notify while holding it,
+   listeners are free to read the value.
+   */
+  std::unique_lock<std::shared_mutex> writeLock() const {
+    return std::unique_lock<std::shared_mutex>(_readWriteMutex);
+  }
+
+  /**
+   Counts the wrapper in the memory stats under its current type and the
+   context of the calling thread until it is destroyed
+   @param bytes Size of the wrapper instance
+   */
+  void countMemory(size_t bytes) {
+    _contextCounter = JsiMemoryStats::getCurrentContextCounter();
+    _countedType = getType();
+    _countedBytes = bytes;
+    JsiMemoryStats::getWrapperCounter(_countedType).add(bytes);
+    _contextCounter->add(bytes);
+  }
+
   /**
    Creates a proxy for the host object so that we can make the runtime trust
    that this is a real JS object
    */
   jsi::Value getObjectAsProxy(jsi::Runtime &runtime,
                               std::shared_ptr<jsi::HostObject> hostObj) {
-    auto createObjProxy =
-        runtime.global().getProperty(runtime, WorkletObjectProxyName);
-    if (createObjProxy.isUndefined()) {
-      // Install worklet proxy helper into runtime
-      static std::string code =
-          "function (obj) {"
-          "  return new Proxy(obj, {"
-          "    getOwnPropertyDescriptor: function () {"
-          "      return { configurable: true, enumerable: true, writable: true "
-          "};"
-          "    },"
-          " set: function(target, prop, value) { return Reflect.set(target, "
-          "prop, value); },"
-          " get: function(target, prop) { return Reflect.get(target, prop); }"
-          "  });"
-          "}";
-
-      auto codeBuffer =
-          std::make_shared<const jsi::StringBuffer>("(" + code + "\n)");
-      createObjProxy =
-          runtime.evaluateJavaScript(codeBuffer, WorkletObjectProxyName);
-      runtime.global().setProperty(runtime, WorkletObjectProxyName,
-                                   createObjProxy);
-    }
-
-    auto createProxyFunc = createObjProxy.asObject(runtime).asFunction(runtime);
-    auto retVal = createProxyFunc.call(
-        runtime, jsi::Object::createFromHostObject(runtime, hostObj));
-
-    return retVal;
+    static std::string code =
+        "function (obj) {"
+        "  return new Proxy(obj, {"
+        "    getOwnPropertyDescriptor: function () {"
+        "      return { configurable: true, enumerable: true, writable: true "
+        "};"
+        "    },"
+        " set: function(target, prop, value) { return Reflect.set(target, "
+        "prop, value); },"
+        " get: function(target, prop) { return Reflect.get(target, prop); }"
+        "  });"
+        "}";
+
+    auto key = hostObj.get();
+    return JsiProxyCache::get(runtime)->getProxy(
+        runtime, key, WorkletObjectProxyName, code, std::move(hostObj));
   }
 
 private:
   /**
    * Notify listeners that the value has changed
    */
-  void notifyListeners() {
+  void notifyListeners(const std::vector<std::string> &changedPaths) {
+    if (_listeners.empty()) {
+      return;
+    }
     for (auto listener : _listeners) {
-      (*listener.second)();
+      (*listener.second)(changedPaths);
     }
   }
 
+  /**
+   * Reads undefined, null, bool and number values without locking. Returns
+   * false if the value is of another type or a writer keeps changing it.
+   * @param result Receives the value
+   */
+  bool tryGetPrimitiveValue(jsi::Value &result);
+
   /**
    * Base Constructor
    * @param parent Parent wrapper
    */
-  explicit JsiWrapper(JsiWrapper *parent) : _parent(parent) {
-    _readWriteMutex = new std::mutex();
-  }
+  explicit JsiWrapper(JsiWrapper *parent) : _parent(parent) {}
 
-  std::mutex *_readWriteMutex;
-  JsiWrapper *_parent;
+  /**
+   * Wrapper and context the instance is counted under, see countMemory
+   */
+  JsiMemoryCounter *_contextCounter = nullptr;
+  JsiWrapperType _countedType = JsiWrapperType::Undefined;
+  size_t _countedBytes = 0;
 
-  JsiWrapperType _type;
+  /**
+   * Number of tries for reading a primitive value before falling back to
+   * the lock
+   */
+  static constexpr int SeqLockRetries = 64;
+
+  mutable std::shared_mutex _readWriteMutex;
+  JsiWrapper *_parent;
 
-  bool _boolValue;
-  double _numberValue;
+  // Primitive values are guarded by a sequence lock: writers (serialized by
+  // the write lock) make the sequence odd while updating, readers retry if
+  // the sequence changed while they read.
+  std::atomic<uint32_t> _sequence = {0};
+  std::atomic<JsiWrapperType> _type = {JsiWrapperType::Undefined};
+  std::atomic<bool> _boolValue = {false};
+  std::atomic<double> _numberValue = {0};
   std::string _stringValue;
 
   size_t _listenerId = 1000;
-  std::map<size_t, std::shared_ptr<std::function<void()>>> _listeners;
+  std::map<size_t, std::shared_ptr<JsiWrapperListener>> _listeners;
 };
 
 } // namespace RNWorklet
@@ -256,6 +256,68 @@ function shouldGenerateSourceMap() {
   return true;
 }
 
+function findHermesCompiler(options) {
+  if (typeof options === "object" && options.hermesc) {
+    return options.hermesc;
+  }
+  const path = require("path");
+  const osBin = {
+    darwin: "osx-bin",
+    linux: "linux64-bin",
+    win32: "win64-bin",
+  }[process.platform];
+  if (!osBin) {
+    return undefined;
+  }
+  try {
+    const reactNativeDir = path.dirname(
+      require.resolve("react-native/package.json")
+    );
+    const hermesc = path.join(
+      reactNativeDir,
+      "sdks",
+      "hermesc",
+      osBin,
+      process.platform === "win32" ? "hermesc.exe" : "hermesc"
+    );
+    return fs.existsSync(hermesc) ? hermesc : undefined;
+  } catch (e) {
+    return undefined;
+  }
+}
+
+// Compiles the worklet code to Hermes bytecode and returns it as base64, or
+// undefined if the code could not be compiled. The code is wrapped the same
+// way the native side wraps it before evaluating.
+function compileHermesBytecode(funString, options) {
+  const hermesc = findHermesCompiler(options);
+  if (!hermesc) {
+    return undefined;
+  }
+  const os = require("os");
+  const path = require("path");
+  const { spawnSync } = require("child_process");
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), "worklet-"));
+  const sourceFile = path.join(dir, "worklet.js");
+  const bytecodeFile = path.join(dir, "worklet.hbc");
+  try {
+    fs.writeFileSync(sourceFile, "(" + funString + "\n)");
+    const result = spawnSync(hermesc, [
+      "-emit-binary",
+      "-O",
+      "-out",
+      bytecodeFile,
+      sourceFile,
+    ]);
+    if (result.status !== 0 || !fs.existsSync(bytecodeFile)) {
+      return undefined;
+    }
+    return fs.readFileSync(bytecodeFile).toString("base64");
+  } finally {
+    fs.rmSync(dir, { recursive: true, force: true });
+  }
+}
+
 function buildWorkletString(t, fun, closureVariables, name, inputMap) {
   function prependClosureVariablesIfNecessary() {
     const closureDeclaration = t.variableDeclaration("const", [
@@ -511,6 +573,15 @@ function makeWorklet(t, fun, state) {
     t.objectProperty(t.identifier("location"), t.stringLiteral(location)),
   ]);
 
+  if (state.opts && state.opts.hermesBytecode) {
+    const bytecode = compileHermesBytecode(funString, state.opts.hermesBytecode);
+    if (bytecode) {
+      initDataObjectExpression.properties.push(
+        t.objectProperty(t.identifier("bytecode"), t.stringLiteral(bytecode))
+      );
+    }
+  }
+
   if (sourceMapString) {
     initDataObjectExpression.properties.push(
       t.objectProperty(
@@ -1,7 +1,82 @@
 export interface ISharedValue<T> {
   get value(): T;
   set value(v: T);
-  addListener(listener: () => void): () => void;
+  /**
+   * Adds a listener that is called when the value changes. The listener
+   * receives the paths of the changed values, relative to the shared value -
+   * an empty string for the value itself, or keys and indexes separated by
+   * dots for nested values ("position.x", "items.2"). Assigning an array
+   * only reports the elements that changed, as indexes or inclusive index
+   * ranges ("items.2-5"), including elements added or removed.
+   *
+   * Batched listeners are called once per tick on the thread the listener was
+   * added on, with all paths changed since the last call.
+   * @returns A function for removing the listener
+   */
+  addListener(
+    listener: (changedPaths: string[]) => void,
+    options?: ListenerOptions
+  ): () => void;
+}
+
+/**
+ * A number shared between runtimes, read and written atomically without
+ * allocating. Use it for values written at frame rate.
+ */
+export interface ISharedNumber {
+  value: number;
+}
+
+/**
+ * A fixed length vector of 32-bit floats shared between runtimes. Reading
+ * `value` always returns the elements of a single write.
+ */
+export interface ISharedFloat32Vector {
+  readonly length: number;
+  /**
+   * Copy of the elements. Assign an array of numbers or a Float32Array of
+   * the same length to set all elements at once.
+   */
+  get value(): number[];
+  set value(v: number[] | Float32Array);
+  get(index: number): number;
+  set(index: number, value: number): void;
+}
+
+export interface ListenerOptions {
+  /**
+   * Coalesce changes and call the listener once per tick instead of on every
+   * change.
+   */
+  batched?: boolean;
+}
+
+/**
+ * Methods available on arrays passed to worklets or stored in shared values.
+ * The worklet runs on chunks of the array in parallel, in the given pooled
+ * context or in a shared context with one thread per core. The promise is
+ * resolved in the calling runtime with the results in order.
+ */
+export interface IParallelArray<T> {
+  parallelMap: <R>(
+    worklet: (value: T, index: number) => R,
+    context?: IWorkletContext
+  ) => Promise<R[]>;
+  parallelFilter: (
+    worklet: (value: T, index: number) => boolean,
+    context?: IWorkletContext
+  ) => Promise<T[]>;
+  /**
+   * Each chunk is reduced starting from its first element. The chunk results
+   * are then combined in order with the combiner (or the reducer if not
+   * given), starting from the initial value if given.
+   */
+  parallelReduce: <R = T>(
+    reducer: (acc: R, value: T, index: number) => R,
+    combiner?: (acc: R, chunkResult: R) => R,
+    initialValue?: R,
+    context?: IWorkletContext
+  ) => Promise<R>;
 }
 
 export interface IWorklet {
@@ -21,6 +96,22 @@ export interface IWorklet {
 */
 export interface IWorkletContext {
   readonly name: string;
+  /**
+   * Max number of evaluated worklets cached in each of the context's worklet
+   * runtimes. Worklets with the same code (same worklet hash) share the
+   * evaluated function, so re-creating a worklet does not parse and evaluate
+   * its code again. Set to 0 to disable the cache.
+   */
+  workletCacheSize: number;
+  /**
+   * Latency of calls into the context, per stage of the call. Only recorded
+   * while `Worklets.tracingEnabled` is set.
+   */
+  readonly latency: Record<WorkletTraceStage | "total", LatencyHistogram>;
+  /**
+   * Resets the latency histograms
+   */
+  resetLatency: () => void;
   /**
    * Adds an object to the worklet context. The object will be available in all worklets
    * on the global object by referencing to the propertyName
@@ -30,6 +121,39 @@ export interface IWorkletContext {
   addDecorator: <T>(propertyName: string, propertyObject: T) => void;
 }
 
+export type WorkletTraceStage =
+  | "argumentWrap"
+  | "queueWait"
+  | "execution"
+  | "resultResolve";
+
+export type ConsoleLevel = "log" | "info" | "warn" | "error" | "none";
+
+/**
+ * Latency statistics in milliseconds. Percentiles are approximate.
+ */
+export interface LatencyHistogram {
+  count: number;
+  mean: number;
+  p50: number;
+  p90: number;
+  p99: number;
+  max: number;
+}
+
+/**
+ * Traced stage of a call between contexts, returned from
+ * `performance.getWorkletEntries()` in worklet contexts.
+ */
+export interface WorkletPerformanceEntry {
+  name: WorkletTraceStage | "total";
+  entryType: "worklet";
+  startTime: number;
+  duration: number;
+  callId: number;
+  contextId: number;
+}
+
 export type ContextType = {
   [key: string]:
     | number
@@ -38,25 +162,276 @@ export type ContextType = {
     | undefined
     | null
     | ISharedValue<any>
+    | ISharedNumber
+    | ISharedFloat32Vector
     | ContextType
     | ContextType[]
     | number[]
     | string[]
     | boolean[]
+    | ArrayBuffer
+    | ArrayBufferView
     | IWorklet;
 };
 
+export interface ContextOptions {
+  /**
+   * Number of threads and worklet runtimes in the context, defaults to 1
+   */
+  poolSize?: number;
+  /**
+   * Name of the context's threads, pooled threads get their index appended.
+   * Android keeps the first 15 characters.
+   */
+  threadName?: string;
+  /**
+   * Quality of service of the context's threads. Sets the pthread QoS class
+   * on iOS and the thread's nice value on Android.
+   */
+  qos?:
+    | "background"
+    | "utility"
+    | "default"
+    | "userInitiated"
+    | "userInteractive";
+  /**
+   * Nice value of the context's threads on Android, overrides `qos`
+   */
+  nice?: number;
+  /**
+   * Stack size of the context's threads in bytes
+   */
+  stackSize?: number;
+  /**
+   * Indexes of the cores the context's threads may run on. Android only, iOS
+   * has no affinity API.
+   */
+  affinity?: number[];
+}
+
+export interface CallOptions {
+  /**
+   * How arguments and return values are passed between contexts.
+   *
+   * - `wrap` (default): values are wrapped and can be read lazily.
+   * - `serialize`: values are copied into one buffer, which is faster for
+   *   large plain objects and arrays. Functions, host objects, promises and
+   *   array buffers are still passed by reference.
+   */
+  transfer?: "wrap" | "serialize";
+  /**
+   * Max time in milliseconds a synchronous call blocks the calling thread.
+   * Only used by `createRunInContextSyncFn`, defaults to 1000.
+   */
+  timeout?: number;
+  /**
+   * Calls that never leave the calling runtime (JS to JS, or within the same
+   * context) return the result directly instead of a promise, and throw
+   * instead of rejecting. Cross-context calls still return a promise.
+   */
+  rawResult?: boolean;
+  /**
+   * Cross-context calls return an engine-native promise instead of a
+   * `CancellablePromise`. It is created and resolved directly in the calling
+   * runtime, which is cheaper, but can not be cancelled.
+   */
+  nativePromise?: boolean;
+  /**
+   * Priority lane the call is queued in. Queued calls with a higher priority
+   * run first, calls with the same priority run in order. Defaults to
+   * `normal`.
+   */
+  priority?: "high" | "normal" | "low";
+}
+
+/**
+ * Promise returned from calls between contexts. Calls that stay in the
+ * calling runtime run right away and return a plain promise without `cancel`.
+ */
+export interface CancellablePromise<T> extends Promise<T> {
+  /**
+   * Rejects the promise with "Cancelled". A call still waiting in the queue
+   * is skipped, a running call can check `Worklets.isCancelled()`. Returns
+   * false if the promise was already settled.
+   */
+  cancel: () => boolean;
+}
+
+export interface PipelineStageOptions {
+  /**
+   * Max number of values waiting in the stage's queue, defaults to 1.
+   */
+  capacity?: number;
+  /**
+   * What to do with values pushed while the queue is full.
+   *
+   * - `dropOldest` (default): the oldest queued value is dropped.
+   * - `dropNewest`: the pushed value is dropped.
+   * - `block`: the pushing thread waits until there is room, at most
+   *   `timeout` milliseconds, then the pushed value is dropped.
+   */
+  overflow?: "dropOldest" | "dropNewest" | "block";
+  /**
+   * How values are passed into the stage, see `CallOptions.transfer`.
+   */
+  transfer?: "wrap" | "serialize";
+  /**
+   * Max time in milliseconds a push blocks with the `block` policy, defaults
+   * to 1000.
+   */
+  timeout?: number;
+}
+
+export interface PipelineStageStats {
+  received: number;
+  processed: number;
+  dropped: number;
+  errors: number;
+  queued: number;
+  /**
+   * Processed values per second since the stage was created or the stats
+   * were reset
+   */
+  throughput: number;
+}
+
+export interface MemoryCounter {
+  count: number;
+  /**
+   * Size of the instances, not including the strings and buffers they own
+   */
+  bytes: number;
+}
+
+export interface MemoryStats {
+  /**
+   * Live wrappers of shared values and values passed between contexts, by
+   * the type they were created with
+   */
+  wrappers: MemoryCounter & {
+    byType: Record<
+      | "undefined"
+      | "null"
+      | "bool"
+      | "number"
+      | "string"
+      | "array"
+      | "object"
+      | "promise"
+      | "hostObject"
+      | "hostFunction"
+      | "arrayBuffer",
+      MemoryCounter
+    >;
+  };
+  /**
+   * Live native objects exposed to JS, including wrappers and contexts
+   */
+  hostObjects: { count: number };
+  /**
+   * Live wrappers by the context that created them, wrappers created on the
+   * JS thread count as "js"
+   */
+  contexts: Array<MemoryCounter & { contextId: number; name: string }>;
+  /**
+   * Free blocks kept for reuse by wrapper allocations and how often
+   * allocations were served from them
+   */
+  pool: {
+    pooledBlocks: number;
+    pooledBytes: number;
+    hits: number;
+    misses: number;
+  };
+}
+
+/**
+ * A stage in a pipeline of worklets, see `createPipelineStage`.
+ */
+export interface IPipelineStage<T, R> {
+  /**
+   * Queues a value for the stage. Returns false if the value was dropped.
+   */
+  push: (value: T) => boolean;
+  /**
+   * Sends the stage's results to the next stage, or disconnects the stage
+   * when called without a stage. Returns the next stage.
+   */
+  connect: <N>(next?: IPipelineStage<R, N>) => IPipelineStage<R, N>;
+  readonly stats: PipelineStageStats;
+  readonly capacity: number;
+  resetStats: () => void;
+}
+
+/**
+ * Bounded channel for streaming values between contexts, see
+ * `createChannel`.
+ */
+export interface IChannel<T> {
+  /**
+   * Adds a value to the channel. Returns false if the channel is full.
+   */
+  push: (value: T) => boolean;
+  /**
+   * Removes and returns the oldest value, or `undefined` if the channel is
+   * empty.
+   */
+  tryPop: () => T | undefined;
+  /**
+   * Removes and returns up to `maxCount` values, all values if not set.
+   */
+  popBatch: (maxCount?: number) => T[];
+  /**
+   * Sets a worklet that is woken up in the given context (or on the JS thread
+   * if no context is given) when values are pushed. It receives all values
+   * pushed since its last call. Call without a worklet to remove it.
+   */
+  setConsumer: (
+    consumer?: (values: T[]) => void,
+    context?: IWorkletContext
+  ) => void;
+  readonly size: number;
+  readonly capacity: number;
+  /**
+   * Number of values dropped because the channel was full
+   */
+  readonly dropped: number;
+}
+
 export interface IWorkletNativeApi {
   /**
    * Creates a new worklet context with the given name. The name identifies the
    * name of the worklet runtime a worklet will be executed in when you call the
    * worklet.runOnWorkletThread();
+   *
+   * When poolSize is larger than one the context is backed by a pool of
+   * threads, each with its own worklet runtime. Calls to the context are
+   * spread over the threads, so worklets running in a pooled context can not
+   * rely on global state being shared between calls.
+   *
+   * Pass an options object instead of the pool size to also set how the
+   * context's threads are scheduled.
    */
-  createContext: (name: string) => IWorkletContext;
+  createContext: (
+    name: string,
+    poolSizeOrOptions?: number | ContextOptions
+  ) => IWorkletContext;
   /**
    * Creates a value that can be shared between runtimes
    */
   createSharedValue: <T>(value: T) => ISharedValue<T>;
+  /**
+   * Creates a shared number, defaults to 0
+   */
+  createSharedNumber: (value?: number) => ISharedNumber;
+  /**
+   * Creates a shared vector of `length` floats, initialized to zeros or to
+   * the given values
+   */
+  createSharedFloat32Vector: (
+    length: number,
+    values?: number[] | Float32Array
+  ) => ISharedFloat32Vector;
   /**
    * Creates a function that will be executed in the worklet context. The function
    * will return a promise that will be resolved when the function has been
@@ -65,12 +440,32 @@ export interface IWorkletNativeApi {
    * Used to create a function to call from the JS thread to the worklet thread.
    * @param worklet Decorated function that will be called in the context
    * @param context Context to call function in, or default context if not set.
+   * @param options Options for calling the function
    * @returns A function that will be called in the worklet context
    */
   createRunInContextFn: <C extends ContextType, T, A extends Array<unknown>>(
     fn: (this: C, ...args: A) => T,
-    context?: IWorkletContext
-  ) => (...args: A) => Promise<T>;
+    context?: IWorkletContext,
+    options?: CallOptions
+  ) => (...args: A) => CancellablePromise<T>;
+  /**
+   * Like `createRunInContextFn`, but the returned function blocks the calling
+   * thread until the worklet has run in the context and returns its result
+   * directly. Calls within the same context run inline.
+   *
+   * Throws if the call times out, or if the target context is already waiting
+   * for the calling context (directly or through other contexts), which would
+   * deadlock. Pooled contexts count as one context for that check.
+   * @param worklet Decorated function that will be called in the context
+   * @param context Context to call function in, or default context if not set.
+   * @param options Options for calling the function
+   * @returns A function that will be called in the worklet context
+   */
+  createRunInContextSyncFn: <C extends ContextType, T, A extends Array<unknown>>(
+    fn: (this: C, ...args: A) => T,
+    context?: IWorkletContext,
+    options?: CallOptions
+  ) => (...args: A) => T;
   /**
    * Creates a function that will be executed in the javascript context.
    *
@@ -80,7 +475,64 @@ export interface IWorkletNativeApi {
    */
   createRunInJsFn: <C extends ContextType, T, A extends Array<unknown>>(
     fn: (this: C, ...args: A) => T
-  ) => (...args: A) => Promise<T>;
+  ) => (...args: A) => CancellablePromise<T>;
+
+  /**
+   * Creates a pipeline stage running the worklet on each value pushed to it,
+   * in the given context or on the JS thread if no context is given. Values
+   * wait in a bounded queue, see `PipelineStageOptions`. Results other than
+   * `undefined` go straight to the connected stage without passing through
+   * the JS thread.
+   */
+  createPipelineStage: <T, R>(
+    worklet: (value: T) => R | undefined,
+    context?: IWorkletContext,
+    options?: PipelineStageOptions
+  ) => IPipelineStage<T, R>;
+
+  /**
+   * Creates a lock-free channel holding up to `capacity` values (rounded up
+   * to a power of two). Values are serialized on push.
+   *
+   * - `mpmc` (default): any number of threads can push and pop.
+   * - `spsc`: one thread pushes and one thread pops at a time, which is
+   *   cheaper. Consumers must then run in a single threaded context.
+   */
+  createChannel: <T>(capacity: number, mode?: "spsc" | "mpmc") => IChannel<T>;
+
+  /**
+   * Creates worklet contexts in the background, with their runtimes built and
+   * decorated on their own threads. The next `count` calls to `createContext`
+   * without a pool size get one of these instead of starting a new context.
+   */
+  prewarmContexts: (count: number) => void;
+  /**
+   * Runs the function and delays shared value listeners until it returns.
+   * Each listener is called once with all paths changed in the function.
+   */
+  batch: <T>(fn: () => T) => T;
+  /**
+   * Returns true in a worklet whose call has been cancelled, see
+   * `CancellablePromise.cancel`.
+   */
+  isCancelled: () => boolean;
+  /**
+   * Returns counters of live native objects, cheap enough to poll.
+   */
+  getMemoryStats: () => MemoryStats;
+
+  /**
+   * Enables tracing of calls between contexts. Traced calls record their
+   * stages in the contexts' `latency` histograms and in a ring buffer that is
+   * read with `performance.getWorkletEntries()` in worklet contexts.
+   */
+  tracingEnabled: boolean;
+
+  /**
+   * Lowest level logged by `console` in worklet contexts, defaults to "log".
+   * Messages below it are dropped before their arguments are formatted.
+   */
+  consoleLevel: ConsoleLevel;
 
   /**
    * Get the default Worklet context.